@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include <new>
+#include "balancer.h"
+#include "common.h"
+
+ConnBalancer g_balancer;
+
+//------------------------------------------------------------------------------
+ConnBalancer::ConnBalancer() : m_pThreadsBuf(NULL), m_pThreads(NULL), m_threads_num(0) {}
+
+//------------------------------------------------------------------------------
+ConnBalancer::~ConnBalancer() { cleanup(); }
+
+//------------------------------------------------------------------------------
+int ConnBalancer::init(int threads_num) {
+#ifdef __windows__
+    (void)threads_num;
+    log_err("--tcp-rebalance is not supported on this platform");
+    return SOCKPERF_ERR_UNSUPPORTED;
+#else
+    static_assert(sizeof(Thread) % CACHE_LINE_SIZE == 0, "Thread must fill whole cache lines");
+
+    m_pThreadsBuf = (char *)MALLOC(threads_num * sizeof(Thread) + CACHE_LINE_SIZE);
+    if (!m_pThreadsBuf) {
+        log_err("Failed to allocate memory for connection balancer");
+        return SOCKPERF_ERR_NO_MEMORY;
+    }
+    m_pThreads = (Thread *)(m_pThreadsBuf + CACHE_LINE_SIZE -
+                            (uintptr_t)m_pThreadsBuf % CACHE_LINE_SIZE);
+    m_threads_num = threads_num;
+    INIT_CRITICAL(&m_lock);
+    for (int i = 0; i < threads_num; i++) {
+        new (&m_pThreads[i]) Thread();
+    }
+
+    for (int i = 0; i < threads_num; i++) {
+        Thread &t = m_pThreads[i];
+        int fds[2] = { -1, -1 };
+
+        t.slots = (Slot *)MALLOC(BALANCER_QUEUE_SIZE * sizeof(Slot));
+        if (!t.slots) {
+            log_err("Failed to allocate memory for connection balancer");
+            return SOCKPERF_ERR_NO_MEMORY;
+        }
+        for (int j = 0; j < BALANCER_QUEUE_SIZE; j++) {
+            new (&t.slots[j]) Slot();
+            t.slots[j].seq.store(j, std::memory_order_relaxed);
+        }
+        if (pipe(fds) || fcntl(fds[0], F_SETFL, O_NONBLOCK) ||
+            fcntl(fds[1], F_SETFL, O_NONBLOCK)) {
+            log_err("Failed to create wakeup pipe of connection balancer");
+            return SOCKPERF_ERR_FATAL;
+        }
+        t.wakeup_rd = fds[0];
+        t.wakeup_wr = fds[1];
+        if (t.wakeup_rd >= max_fds_num) {
+            log_err("Wakeup pipe of connection balancer exceeds max_fds_num");
+            return SOCKPERF_ERR_FATAL;
+        }
+    }
+    m_sampleTime.setNowNonInline();
+
+    return SOCKPERF_ERR_NONE;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void ConnBalancer::cleanup() {
+    if (!m_pThreads) {
+        return;
+    }
+#ifndef __windows__
+    for (int i = 0; i < m_threads_num; i++) {
+        Thread &t = m_pThreads[i];
+        if (t.wakeup_rd >= 0) {
+            close(t.wakeup_rd);
+            close(t.wakeup_wr);
+        }
+        if (t.slots) {
+            FREE(t.slots);
+        }
+    }
+#endif
+    FREE(m_pThreadsBuf);
+    m_pThreads = NULL;
+    DELETE_CRITICAL(&m_lock);
+    m_threads_num = 0;
+}
+
+//------------------------------------------------------------------------------
+/* Thread with the lowest message rate over the last sample period. Connections picked since
+ * the sample are counted at the average rate of a connection, so a burst of accepts is spread.
+ */
+int ConnBalancer::pickThread(int self) {
+    TicksTime now = TicksTime::now();
+    int64_t elapsed = 0;
+    double total_rate = 0;
+    int total_connections = 0;
+    int best = self;
+
+    ENTER_CRITICAL(&m_lock);
+    elapsed = (now - m_sampleTime).toNsec();
+    if (elapsed >= (int64_t)BALANCER_SAMPLE_MSEC * NSEC_IN_MSEC) {
+        for (int i = 0; i < m_threads_num; i++) {
+            Thread &t = m_pThreads[i];
+            uint64_t messages = t.messages.load(std::memory_order_relaxed);
+            t.rate = (double)(messages - t.sampled) * NSEC_IN_SEC / elapsed;
+            t.sampled = messages;
+        }
+        m_sampleTime = now;
+    }
+
+    for (int i = 0; i < m_threads_num; i++) {
+        total_rate += m_pThreads[i].rate;
+        total_connections += m_pThreads[i].connections.load(std::memory_order_relaxed);
+        if (m_pThreads[i].rate < m_pThreads[best].rate) {
+            best = i;
+        }
+    }
+    m_pThreads[best].rate += _max(1.0, total_rate / _max(1, total_connections));
+    m_pThreads[best].connections.fetch_add(1, std::memory_order_relaxed);
+    LEAVE_CRITICAL(&m_lock);
+
+    return best;
+}
+
+//------------------------------------------------------------------------------
+/* The connection stays with the accepting thread when the queue is full */
+bool ConnBalancer::handOver(int self, int thread, int fd) {
+    Thread &t = m_pThreads[thread];
+    uint64_t pos = t.tail.load(std::memory_order_relaxed);
+    Slot *slot = NULL;
+
+    for (;;) {
+        slot = &t.slots[pos & (BALANCER_QUEUE_SIZE - 1)];
+        int64_t diff = (int64_t)slot->seq.load(std::memory_order_acquire) - (int64_t)pos;
+        if (!diff) {
+            if (t.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed,
+                                             std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            t.connections.fetch_sub(1, std::memory_order_relaxed);
+            m_pThreads[self].connections.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = t.tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->fd = fd;
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+#ifndef __windows__
+    char c = 0;
+    if (write(t.wakeup_wr, &c, 1) < 0) {
+        /* pipe is full so the thread is going to be woken up anyway */
+        errno = 0;
+    }
+#endif
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void ConnBalancer::drainWakeup(int thread) {
+#ifndef __windows__
+    char buf[64];
+    while (read(m_pThreads[thread].wakeup_rd, buf, sizeof(buf)) > 0) {
+    }
+    errno = 0;
+#else
+    (void)thread;
+#endif
+}
+
+//------------------------------------------------------------------------------
+int ConnBalancer::adopt(int thread) {
+    Thread &t = m_pThreads[thread];
+    Slot &slot = t.slots[t.head & (BALANCER_QUEUE_SIZE - 1)];
+
+    if (slot.seq.load(std::memory_order_acquire) != t.head + 1) {
+        return -1;
+    }
+    int fd = slot.fd;
+    slot.seq.store(t.head + BALANCER_QUEUE_SIZE, std::memory_order_release);
+    t.head++;
+
+    return fd;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#ifndef BALANCER_H_
+#define BALANCER_H_
+
+#include <stdint.h> // for uint64_t
+#include <atomic>
+#include "defs.h"
+#include "ticks.h"
+
+#define BALANCER_QUEUE_SIZE 1024 /* connections waiting for a thread (power of 2) */
+#define BALANCER_SAMPLE_MSEC 100 /* period of message rate sampling */
+
+/*
+ * ConnBalancer distributes accepted TCP connections between threads of the server
+ * (--tcp-rebalance). Every thread counts messages it handles; the accepting thread samples
+ * these counters to get recent message rate of every thread and hands a new connection over
+ * to the least loaded one through its lock-free queue, then wakes it up by a pipe that is
+ * watched by the iomux of that thread.
+ * Only the accepting thread fills free entries of active_fd_list of its listen socket and only
+ * the owner of a connection clears its entry, so the list is shared without a lock.
+ */
+class ConnBalancer {
+public:
+    ConnBalancer();
+    ~ConnBalancer();
+
+    int init(int threads_num);
+    void cleanup();
+
+    inline bool enabled() const { return m_threads_num > 0; }
+    inline int wakeupFd(int thread) const { return m_pThreads[thread].wakeup_rd; }
+
+    // called by the owner thread for every handled message
+    inline void countMessage(int thread) {
+        Thread &t = m_pThreads[thread];
+        t.messages.store(t.messages.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // accepting thread
+    int pickThread(int self);
+    bool handOver(int self, int thread, int fd);
+
+    // owner thread
+    inline void connectionClosed(int thread) {
+        m_pThreads[thread].connections.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // once the wakeup fd is ready
+    void drainWakeup(int thread);
+    int adopt(int thread);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        int fd;
+    };
+
+    // fills whole cache lines, the array is cache line aligned
+    struct Thread {
+        std::atomic<uint64_t> messages; // written by the owner thread only
+        char pad[CACHE_LINE_SIZE - sizeof(uint64_t)];
+        std::atomic<uint64_t> tail; // producers (accepting threads)
+        char pad2[CACHE_LINE_SIZE - sizeof(uint64_t)];
+        uint64_t head; // consumer (owner thread)
+        Slot *slots;
+        int wakeup_rd;
+        int wakeup_wr;
+        std::atomic<int> connections;
+        int pad3;
+        // sampling state, protected by m_lock
+        uint64_t sampled;
+        double rate;
+        char pad4[CACHE_LINE_SIZE - 3 * sizeof(uint64_t) - sizeof(Slot *) - 4 * sizeof(int)];
+
+        Thread()
+            : messages(0), tail(0), head(0), slots(NULL), wakeup_rd(-1), wakeup_wr(-1),
+              connections(0), sampled(0), rate(0) {}
+    };
+
+    char *m_pThreadsBuf; // allocation that holds m_pThreads
+    Thread *m_pThreads;
+    int m_threads_num;
+    os_mutex_t m_lock;
+    TicksTime m_sampleTime;
+};
+
+extern ConnBalancer g_balancer;
+
+#endif /* BALANCER_H_ */
@@ -31,8 +31,15 @@
 #include "client.h"
 #include "iohandlers.h"
 #include "packet.h"
+#include "histogram.h"
+#ifndef __windows__
+#include "full_log.h"
+#endif // __windows__
 
 #include <math.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif // __linux__
 #include <map>
 
 TicksTime s_startTime, s_endTime;
@@ -262,33 +269,92 @@ void printHistogram(uint32_t binSize, std::map<uint32_t, uint32_t> &activeBins,
 }
 
 //------------------------------------------------------------------------------
-/* Sparse fixed bin histogram with outlier bins outside given range */
-void makeHistogram(TicksDuration *sortedpLat, size_t size) {
-    const uint32_t leftOutlierBinIndex = getLeftOutlierBinIndexReserved();
-    const uint32_t rightOutlierBinIndex = getRightOutlierBinIndexReserved();
+/* Observations of a latency metric: always recorded into a streaming histogram and,
+ * with --exact-stats, also kept one by one for exact (sort based) statistics */
+struct LatencyStats {
+    LatencyHistogram hist;
+    std::vector<TicksDuration> samples; // --exact-stats only
+
+    inline void record(const TicksDuration &value) {
+        int64_t nsec = value.toNsec();
+        hist.record(nsec > 0 ? (uint64_t)nsec : 0);
+        if (s_user_params.b_exact_stats) {
+            samples.push_back(value);
+        }
+    }
+
+    inline size_t size() const { return (size_t)hist.count(); }
+
+    void sort() {
+        if (!samples.empty()) TicksDuration::sort(samples.data(), samples.size());
+    }
+
+    // value at position 'rank' of the sorted observations (sort() is required for exact stats)
+    TicksDuration atRank(size_t rank) const {
+        if (!samples.empty()) return samples[rank];
+        return TicksDuration((int64_t)hist.valueAtRank(rank));
+    }
+
+    TicksDuration stdDev() {
+        if (!samples.empty()) return TicksDuration::stdDev(samples.data(), samples.size());
+        return TicksDuration((int64_t)(hist.stdDev() + 0.5));
+    }
+
+    TicksDuration mad() {
+        if (!samples.empty()) return TicksDuration::mad(samples.data(), samples.size());
+        return TicksDuration((int64_t)hist.mad());
+    }
+
+    TicksDuration medianad() {
+        if (!samples.empty()) return TicksDuration::medianad(samples.data(), samples.size());
+        return TicksDuration((int64_t)hist.medianad());
+    }
+
+    TicksDuration siqr() {
+        if (!samples.empty()) return TicksDuration::siqr(samples.data(), samples.size());
+        return TicksDuration((int64_t)hist.siqr());
+    }
+};
+
+//------------------------------------------------------------------------------
+static inline void addToHistogramBin(std::map<uint32_t, uint32_t> &activeBins, double value,
+                                     uint32_t count) {
     const uint32_t lowerRange = s_user_params.histogram_lower_range;
     const uint32_t upperRange = s_user_params.histogram_upper_range;
     const uint32_t binSize = s_user_params.histogram_bin_size;
     uint32_t binIndex = 0;
-    uint32_t minValue = static_cast<uint32_t>(sortedpLat[0].toDecimalUsec());
-    uint32_t maxValue = static_cast<uint32_t>(sortedpLat[size - 1].toDecimalUsec());
-    double value = 0;
+
+    if (value < lowerRange) {
+        activeBins[getLeftOutlierBinIndexReserved()] += count;
+    } else if (value >= upperRange) {
+        activeBins[getRightOutlierBinIndexReserved()] += count;
+    } else {
+        binIndex = static_cast<uint32_t>(1 + (value - lowerRange) / binSize);
+        activeBins[binIndex] += count;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Sparse fixed bin histogram with outlier bins outside given range */
+void makeHistogram(const LatencyStats &lat) {
+    const uint32_t binSize = s_user_params.histogram_bin_size;
+    const size_t size = lat.size();
+    uint32_t minValue = static_cast<uint32_t>(lat.atRank(0).toDecimalUsec());
+    uint32_t maxValue = static_cast<uint32_t>(lat.atRank(size - 1).toDecimalUsec());
     std::map<uint32_t, uint32_t> activeBins;
-    size_t i = 0;
 
     // build histogram
-    for (; i < size; i++) {
-        value = sortedpLat[i].toDecimalUsec();
-        if (value < lowerRange) {
-            activeBins[leftOutlierBinIndex]++;
-            continue;
+    if (!lat.samples.empty()) {
+        for (size_t i = 0; i < size; i++) {
+            addToHistogramBin(activeBins, lat.samples[i].toDecimalUsec(), 1);
         }
-        if (value >= upperRange) {
-            activeBins[rightOutlierBinIndex]++;
-            continue;
+    } else {
+        for (size_t i = 0; i < lat.hist.bucketNum(); i++) {
+            if (lat.hist.bucketCount(i)) {
+                addToHistogramBin(activeBins, (double)lat.hist.bucketValue(i) / 1000,
+                                  (uint32_t)lat.hist.bucketCount(i));
+            }
         }
-        binIndex = static_cast<uint32_t>(1 + (value - lowerRange) / binSize);
-        activeBins[binIndex]++;
     }
 
     printHistogram(binSize, activeBins, minValue, maxValue);
@@ -298,31 +364,51 @@ void makeHistogram(TicksDuration *sortedpLat, size_t size) {
 }
 
 //------------------------------------------------------------------------------
-void printPercentiles(FILE *f, TicksDuration *sortedpLat, size_t size) {
+void printPercentiles(FILE *f, const LatencyStats &lat) {
     const double percentile[] = { 0.99999, 0.9999, 0.999, 0.99, 0.90, 0.75, 0.50, 0.25 };
     int num = sizeof(percentile) / sizeof(percentile[0]);
+    size_t size = lat.size();
     double observationsInPercentile = (double)size / 100;
 
     log_msg_file2(f, MAGNETA "Total %lu observations" ENDCOLOR
                              "; each percentile contains %.2lf observations",
                   (long unsigned)size, observationsInPercentile);
 
-    log_msg_file2(f, "---> <MAX> observation = %8.3lf", sortedpLat[size - 1].toDecimalUsec());
+    log_msg_file2(f, "---> <MAX> observation = %8.3lf", lat.atRank(size - 1).toDecimalUsec());
     for (int i = 0; i < num; i++) {
         int index = (int)(0.5 + percentile[i] * size) - 1;
         if (index >= 0) {
             log_msg_file2(f, "---> percentile %6.3lf = %8.3lf", 100 * percentile[i],
-                          sortedpLat[index].toDecimalUsec());
+                          lat.atRank(index).toDecimalUsec());
         }
     }
-    log_msg_file2(f, "---> <MIN> observation = %8.3lf", sortedpLat[0].toDecimalUsec());
+    log_msg_file2(f, "---> <MIN> observation = %8.3lf", lat.atRank(0).toDecimalUsec());
 }
 
 //------------------------------------------------------------------------------
-typedef TicksTime RecordLog[2];
+/* Print percentiles of an additional latency metric */
+static void printMetricPercentiles(FILE *f, const char *name, const char *desc,
+                                   LatencyStats &lat, TicksDuration sum) {
+    const size_t size = lat.size();
+    if (!size) {
+        log_msg_file2(f, "%s: no observations", name);
+        return;
+    }
+
+    lat.sort();
+    log_msg_file2(f, MAGNETA "====> avg-%s=%.3lf (%s)" ENDCOLOR, name,
+                  (sum / (int)size).toDecimalUsec(), desc);
+    printPercentiles(f, lat);
+}
 
 //------------------------------------------------------------------------------
-void dumpFullLog(int serverNo, RecordLog *pFullLog, size_t size) {
+struct RecordLog {
+    TicksTime txTime;
+    TicksTime rxTime;
+};
+
+//------------------------------------------------------------------------------
+void dumpFullLog(int serverNo, const RecordLog *pFullLog, size_t size) {
     FILE *f = g_pApp->m_const_params.fileFullLog;
     uint32_t denominator = g_pApp->m_const_params.full_rtt ? 1 : 2;
     if (!f || !size) return;
@@ -331,8 +417,8 @@ void dumpFullLog(int serverNo, RecordLog *pFullLog, size_t size) {
     fprintf(f, "packet, txTime(sec), rxTime(sec), %s(usec)\n",
             round_trip_str[g_pApp->m_const_params.full_rtt]);
     for (size_t i = 0; i < size; i++) {
-        double tx = (double)pFullLog[i][0].debugToNsec() / 1000 / 1000 / 1000;
-        double rx = (double)pFullLog[i][1].debugToNsec() / 1000 / 1000 / 1000;
+        double tx = (double)pFullLog[i].txTime.debugToNsec() / 1000 / 1000 / 1000;
+        double rx = (double)pFullLog[i].rxTime.debugToNsec() / 1000 / 1000 / 1000;
         double result = (rx - tx) * (USEC_PER_SEC / denominator);
         fprintf(f, "%zu, %.9lf, %.9lf, %.3lf\n", i, tx, rx, result);
     }
@@ -369,12 +455,238 @@ double NormalCDFInverse(double p) {
     }
 }
 
+//------------------------------------------------------------------------------
+/* Observations of one server collected from PacketTimes blocks as they are retired */
+struct ServerStats {
+    LatencyStats latency;
+    std::vector<RecordLog> fullLog; // --full-log only
+    LatencyStats userToWire;        // --timestamping only
+    LatencyStats wireToUser;        // --timestamping only
+    LatencyStats fromIntended;      // --intended-time only
+    TicksDuration sumRtt;
+    TicksDuration sumUserToWire;
+    TicksDuration sumWireToUser;
+    TicksDuration sumFromIntended;
+    TicksTime prevRxTime;
+    TicksTime startValidTime;
+    TicksTime endValidTime;
+    uint64_t startValidSeqNo = 0;
+    uint64_t endValidSeqNo = 0;
+};
+
+static ServerStats *s_pServerStats = NULL;
+
+// latency of every playback stream, for all servers together
+struct StreamStats {
+    uint64_t replies = 0;
+    uint64_t dropped = 0;
+    TicksDuration sum;
+    TicksDuration min;
+    TicksDuration max;
+};
+static std::vector<StreamStats> s_streamStats;
+static TicksTime s_testStart; // known when the first pong request is retired
+static TicksTime s_testEnd;   // known when the test is over (TICKS0 till then)
+#ifndef __windows__
+static FullLogWriter *s_pFullLogBin = NULL; // --full-log-bin
+#endif // __windows__
+
+//------------------------------------------------------------------------------
+/* PacketTimes consumer: account a pong request that is retired from the window.
+ * Called by the sender thread during the test and by client_retire_packets() at its end.
+ */
+static void client_consume_packet(uint64_t seqNo, const TicksTime *times,
+                                  const TicksTime *kernelTimes, const TicksTime *intendedTime,
+                                  int stream) {
+    const TicksTime &txTime = times[0];
+    const uint64_t replyEvery = g_pApp->m_const_params.reply_every;
+    const uint32_t denominator = g_pApp->m_const_params.full_rtt ? 1 : 2;
+
+    if (txTime == TicksTime::TICKS0) {
+        return; // send was skipped
+    }
+
+    /*
+     * There are few reasons to ignore warmup/cooldown packets:
+     *
+     * 1. At the head of the test the load is not real, since only few packets were sent so far.
+     * 2. At the tail of the test the load is not real since the sender stopped sending; hence,
+     *    the receiver accept packets without load
+     * 3. The sender thread starts sending packets and generating load, before the receiver
+     *    thread has started, and before its code was cached to memory/cpu.
+     * 4. There are some packets that were sent close to s_end time; the legitimate replies to
+     *    them will arrive after s_end time and may be lost.  Hence, your fix may cause us to
+     *    report on those packets as dropped packets.
+     */
+    if (s_testStart == TicksTime::TICKS0) {
+        s_testStart = txTime; // first pong request packet
+        if (!g_pApp->m_const_params.pPlaybackReader && // no warmup in playback mode
+            g_pApp->m_const_params.measurement == TIME_BASED) {
+            s_testStart += TicksDuration::TICKS1MSEC * TEST_START_WARMUP_MSEC;
+        }
+    }
+
+    if (g_pApp->m_const_params.measurement == NUMBER_BASED) {
+        uint64_t startSearchHere = 1 + g_pApp->m_const_params.warmup_num;
+        uint64_t endNumberSearchHere = startSearchHere + g_pApp->m_const_params.number_test_target;
+        if (seqNo / replyEvery < startSearchHere || seqNo >= endNumberSearchHere) {
+            return;
+        }
+    }
+
+    if ((txTime < s_testStart) || (s_testEnd != TicksTime::TICKS0 && txTime > s_testEnd)) {
+        return;
+    }
+
+    StreamStats *streamStats = NULL;
+    if (stream >= 0) {
+        if ((size_t)stream >= s_streamStats.size()) {
+            s_streamStats.resize(stream + 1);
+        }
+        streamStats = &s_streamStats[stream];
+    }
+
+    for (int serverNo = 0; serverNo < g_pApp->m_const_params.client_work_with_srv_num;
+         serverNo++) {
+        ServerStats &stats = s_pServerStats[serverNo];
+        const TicksTime &rxTime = times[1 + serverNo];
+
+        if (stats.startValidSeqNo == 0) {
+            stats.startValidSeqNo = seqNo;
+            stats.startValidTime = txTime;
+        }
+
+#ifndef __windows__
+        if (s_pFullLogBin) {
+            FullLogRecord record = { seqNo, (int64_t)txTime.toTicks(), (int64_t)rxTime.toTicks(),
+                                     (uint32_t)serverNo, 0 };
+            s_pFullLogBin->append(record);
+        }
+#endif // __windows__
+
+        if (rxTime == TicksTime::TICKS0) {
+            g_pPacketTimes->incDroppedCount(serverNo);
+            if (streamStats) {
+                streamStats->dropped++;
+            }
+            if (stats.endValidTime < txTime) {
+                stats.endValidSeqNo = seqNo;
+                stats.endValidTime = txTime;
+            }
+            continue;
+        }
+
+        if (rxTime < stats.prevRxTime) {
+            g_pPacketTimes->incOooCount(serverNo);
+            continue;
+        }
+
+        if (g_pApp->m_const_params.fileFullLog) {
+            RecordLog record = { txTime, rxTime };
+            stats.fullLog.push_back(record);
+        }
+
+        stats.endValidSeqNo = seqNo;
+        stats.endValidTime = rxTime;
+
+        TicksDuration rtt = rxTime - txTime;
+        stats.sumRtt += rtt;
+        stats.latency.record(rtt / denominator);
+        stats.prevRxTime = rxTime;
+
+        if (streamStats) {
+            TicksDuration latency = rtt / denominator;
+            if (!streamStats->replies || latency < streamStats->min) {
+                streamStats->min = latency;
+            }
+            if (!streamStats->replies || latency > streamStats->max) {
+                streamStats->max = latency;
+            }
+            streamStats->replies++;
+            streamStats->sum += latency;
+        }
+
+        if (intendedTime) {
+            TicksDuration fromIntended = rxTime - *intendedTime;
+            stats.sumFromIntended += fromIntended;
+            stats.fromIntended.record(fromIntended / denominator);
+        }
+
+        if (kernelTimes) {
+            const TicksTime &kernelTxTime = kernelTimes[0];
+            const TicksTime &kernelRxTime = kernelTimes[1 + serverNo];
+            if (kernelTxTime != TicksTime::TICKS0) {
+                stats.userToWire.record(kernelTxTime - txTime);
+                stats.sumUserToWire += kernelTxTime - txTime;
+            }
+            if (kernelRxTime != TicksTime::TICKS0) {
+                stats.wireToUser.record(rxTime - kernelRxTime);
+                stats.sumWireToUser += rxTime - kernelRxTime;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void client_stats_init() {
+    s_pServerStats = new ServerStats[g_pApp->m_const_params.client_work_with_srv_num];
+    g_pPacketTimes->setConsumer(client_consume_packet);
+
+#ifndef __windows__
+    if (g_pApp->m_const_params.full_log_bin_fd >= 0) {
+        FullLogHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FULL_LOG_MAGIC, sizeof(FULL_LOG_MAGIC));
+        header.version = FULL_LOG_VERSION;
+        header.header_size = sizeof(FullLogHeader);
+        header.record_size = sizeof(FullLogRecord);
+        header.reply_every = g_pApp->m_const_params.reply_every;
+        header.ticks_per_sec = TicksBase::getTicksPerSec();
+        header.msg_size = g_pApp->m_const_params.msg_size;
+        header.mps = g_pApp->m_const_params.cycleDuration > TicksDuration::TICKS0
+                         ? g_pApp->m_const_params.mps
+                         : 0;
+        header.server_num = g_pApp->m_const_params.client_work_with_srv_num;
+        header.full_rtt = g_pApp->m_const_params.full_rtt;
+
+        s_pFullLogBin = new FullLogWriter(g_pApp->m_const_params.full_log_bin_fd);
+        s_pFullLogBin->writeHeader(header);
+    }
+#endif // __windows__
+}
+
+//------------------------------------------------------------------------------
+/* Account pong requests that are still in the window once the test is over */
+static void client_retire_packets() {
+    // last pong request packet
+    s_testEnd = g_pPacketTimes->getTxTime(g_pPacketTimes->getLastSeqNo());
+    if (s_testEnd == TicksTime::TICKS0) {
+        s_testEnd = TicksTime::now();
+    }
+    if (!g_pApp->m_const_params.pPlaybackReader && // no cooldown in playback mode
+        g_pApp->m_const_params.measurement == TIME_BASED) {
+        s_testEnd -= TicksDuration::TICKS1MSEC * TEST_END_COOLDOWN_MSEC;
+    }
+    g_pPacketTimes->flush();
+#ifndef __windows__
+    if (s_pFullLogBin) {
+        delete s_pFullLogBin;
+        s_pFullLogBin = NULL;
+    }
+#endif // __windows__
+    log_dbg("testStart: %.9lf sec testEnd: %.9lf sec",
+            (double)s_testStart.debugToNsec() / 1000 / 1000 / 1000,
+            (double)s_testEnd.debugToNsec() / 1000 / 1000 / 1000);
+}
+
 //------------------------------------------------------------------------------
 void client_statistics(int serverNo, Message *pMsgRequest) {
-    const uint64_t receiveCount = g_receiveCount;
+    thread_stats_t total;
+    thread_stats_total(total);
+    const uint64_t receiveCount = total.receiveCount;
+    const uint64_t skipCount = total.skipCount;
+    // every UDP GSO segment is a separate message with its own sequence number
     const uint64_t sendCount = pMsgRequest->getSequenceCounter();
-    const uint64_t replyEvery = g_pApp->m_const_params.reply_every;
-    const size_t SIZE = receiveCount;
     const int SERVER_NO = serverNo;
 
     FILE *f = g_pApp->m_const_params.fileFullLog;
@@ -387,19 +699,19 @@ void client_statistics(int serverNo, Message *pMsgRequest) {
     /* Print total statistic that is independent on server count */
     if (SERVER_NO == 0) {
         TicksDuration totalRunTime = s_endTime - s_startTime;
-        if (g_skipCount) {
+        if (skipCount) {
             if (g_pApp->m_const_params.measurement == TIME_BASED) {
                 log_msg_file2(f, "[Total Run] RunTime=%.3lf sec; Warm up time=%" PRIu32
                                 " msec; SentMessages=%" PRIu64 "; ReceivedMessages=%" PRIu64
                                 "; SkippedMessages=%" PRIu64 "",
                             totalRunTime.toDecimalUsec() / 1000000,
-                            g_pApp->m_const_params.warmup_msec, sendCount, receiveCount, g_skipCount);
+                            g_pApp->m_const_params.warmup_msec, sendCount, receiveCount, skipCount);
             } else {
                 log_msg_file2(f, "[Total Run] RunTime=%.3lf sec; Warm up packets=%" PRIu64
                              "; SentMessages=%" PRIu64 "; ReceivedMessages=%" PRIu64
                              "; SkippedMessages=%" PRIu64 "",
                           totalRunTime.toDecimalUsec() / 1000000,
-                          g_pApp->m_const_params.warmup_num, sendCount, receiveCount, g_skipCount);
+                          g_pApp->m_const_params.warmup_num, sendCount, receiveCount, skipCount);
             }
         } else {
             if (g_pApp->m_const_params.measurement == TIME_BASED) {
@@ -420,129 +732,33 @@ void client_statistics(int serverNo, Message *pMsgRequest) {
     /* Print server related statistic */
     log_msg_file2(f, "========= Printing statistics for Server No: %d", SERVER_NO);
 
-    /*
-     * There are few reasons to ignore warmup/cooldown packets:
-     *
-     * 1. At the head of the test the load is not real, since only few packets were sent so far.
-     * 2. At the tail of the test the load is not real since the sender stopped sending; hence,
-     *    the receiver accept packets without load
-     * 3. The sender thread starts sending packets and generating load, before the receiver
-     *    thread has started, and before its code was cached to memory/cpu.
-     * 4. There are some packets that were sent close to s_end time; the legitimate replies to
-     *    them will arrive after s_end time and may be lost.  Hence, your fix may cause us to
-     *    report on those packets as dropped packets.
-     */
-
-    TicksTime testStart = g_pPacketTimes->getTxTime(replyEvery); // first pong request packet
-    TicksTime testEnd =
-        g_pPacketTimes->getTxTime(sendCount); // will be "truncated" to last pong request packet
-
-    if (!g_pApp->m_const_params.pPlaybackVector) { // no warmup in playback mode
-        if (g_pApp->m_const_params.measurement == TIME_BASED) {
-            testStart += TicksDuration::TICKS1MSEC * TEST_START_WARMUP_MSEC;
-            testEnd -= TicksDuration::TICKS1MSEC * TEST_END_COOLDOWN_MSEC;
-        }
-    }
-    log_dbg("testStart: %.9lf sec testEnd: %.9lf sec",
-            (double)testStart.debugToNsec() / 1000 / 1000 / 1000,
-            (double)testEnd.debugToNsec() / 1000 / 1000 / 1000);
-    if (testEnd < testStart) {
+    if (s_testEnd < s_testStart) {
         log_msg_file2(f, "Test end before test start. Ending statistics early");
         return;
     }
 
-    TicksDuration *pLat = new TicksDuration[SIZE];
-    RecordLog *pFullLog = g_pApp->m_const_params.fileFullLog ? new RecordLog[SIZE] : NULL;
-
-    TicksDuration rtt;
-    TicksDuration sumRtt(0);
-    size_t counter = 0;
-    TicksTime prevRxTime;
-    TicksTime startValidTime;
-    TicksTime endValidTime;
-    uint32_t denominator = g_pApp->m_const_params.full_rtt ? 1 : 2;
-    uint64_t startValidSeqNo = 0;
-    uint64_t endValidSeqNo = 0;
-    uint64_t startSearchHere = 1;
-    uint64_t endNumberSearchHere = -1;
-
-    if (g_pApp->m_const_params.measurement == NUMBER_BASED) {
-        startSearchHere += g_pApp->m_const_params.warmup_num;
-        endNumberSearchHere = startSearchHere + g_pApp->m_const_params.number_test_target;
-    }
-
-    for (uint64_t i = startSearchHere; (counter < SIZE); i++) {
-        uint64_t seqNo = i * replyEvery;
-        const TicksTime &txTime = g_pPacketTimes->getTxTime(seqNo);
-        const TicksTime &rxTime = g_pPacketTimes->getRxTimeArray(seqNo)[SERVER_NO];
-
-        if ((txTime > testEnd) || (txTime == TicksTime::TICKS0)) {
-            break;
-        }
-
-        if (g_pApp->m_const_params.measurement == NUMBER_BASED && seqNo >= endNumberSearchHere) {
-            break;
-        }
-
-        if (txTime < testStart) {
-            continue;
-        }
-
-        if (startValidSeqNo == 0) {
-            startValidSeqNo = seqNo;
-            startValidTime = txTime;
-        }
-
-        if (rxTime == TicksTime::TICKS0) {
-            g_pPacketTimes->incDroppedCount(SERVER_NO);
-            if (endValidTime < txTime) {
-                endValidSeqNo = seqNo;
-                endValidTime = txTime;
-            }
-            continue;
-        }
-
-        if (rxTime < prevRxTime) {
-            g_pPacketTimes->incOooCount(SERVER_NO);
-            continue;
-        }
-
-        if (g_pApp->m_const_params.fileFullLog) {
-            pFullLog[counter][0] = txTime;
-            pFullLog[counter][1] = rxTime;
-        }
-
-        endValidSeqNo = seqNo;
-        endValidTime = rxTime;
-
-        rtt = rxTime - txTime;
-
-        sumRtt += rtt;
-        pLat[counter] = rtt / denominator;
-
-        prevRxTime = rxTime;
-        counter++;
-    }
+    ServerStats &stats = s_pServerStats[SERVER_NO];
+    const size_t counter = stats.latency.size();
+    TicksDuration sumRtt = stats.sumRtt;
 
     if (!counter) {
         log_msg_file2(
             f, "No valid observations found. Try tune parameters: "
                "--time/--number-of-packets/--mps/--reply-every");
     } else {
-        TicksDuration validRunTime = endValidTime - startValidTime;
+        TicksDuration validRunTime = stats.endValidTime - stats.startValidTime;
         log_msg_file2(f, "[Valid Duration] RunTime=%.3lf sec; SentMessages=%" PRIu64
                          "; ReceivedMessages=%" PRIu64 "",
-                      validRunTime.toDecimalUsec() / 1000000, (endValidSeqNo - startValidSeqNo + 1),
-                      (uint64_t)counter);
+                      validRunTime.toDecimalUsec() / 1000000,
+                      (stats.endValidSeqNo - stats.startValidSeqNo + 1), (uint64_t)counter);
 
-        TicksDuration::sort(pLat, counter);
-        TicksDuration *sortedpLat = &pLat[0]; // alias for pLat after being sorted
+        stats.latency.sort();
         TicksDuration avgRtt = counter ? sumRtt / (int)counter : TicksDuration::TICKS0;
         TicksDuration avgLatency = avgRtt / 2;
-        TicksDuration stdDev = TicksDuration::stdDev(pLat, counter);
-        TicksDuration mad = TicksDuration::mad(pLat, counter);
-        TicksDuration medianad = TicksDuration::medianad(pLat, counter);
-        TicksDuration siqr = TicksDuration::siqr(pLat, counter);
+        TicksDuration stdDev = stats.latency.stdDev();
+        TicksDuration mad = stats.latency.mad();
+        TicksDuration medianad = stats.latency.medianad();
+        TicksDuration siqr = stats.latency.siqr();
         double usecAvarage = g_pApp->m_const_params.full_rtt ? avgRtt.toDecimalUsec() : avgLatency.toDecimalUsec();
         double coefficientOfVariance = stdDev.toDecimalUsec() / usecAvarage;
         double standardError = stdDev.toDecimalUsec() / sqrt(counter);
@@ -572,16 +788,69 @@ void client_statistics(int serverNo, Message *pMsgRequest) {
 
         if (usecAvarage) print_average_results(usecAvarage);
 
-        printPercentiles(f, sortedpLat, counter);
+        printPercentiles(f, stats.latency);
 
-        dumpFullLog(SERVER_NO, pFullLog, counter);
+        if (g_pApp->m_const_params.b_intended_time) {
+            TicksDuration sum = stats.sumFromIntended / (g_pApp->m_const_params.full_rtt ? 1 : 2);
+            printMetricPercentiles(f, g_pApp->m_const_params.full_rtt ? "rtt-from-intended"
+                                                                      : "latency-from-intended",
+                                   "measured from intended send time", stats.fromIntended, sum);
+        }
+
+        if (g_pPacketTimes->hasKernelTimes()) {
+            printMetricPercentiles(f, "user-to-wire", "send() call till kernel TX timestamp",
+                                   stats.userToWire, stats.sumUserToWire);
+            printMetricPercentiles(f, "wire-to-user", "kernel RX timestamp till reply is handled",
+                                   stats.wireToUser, stats.sumWireToUser);
+        }
+
+        dumpFullLog(SERVER_NO, stats.fullLog.data(), stats.fullLog.size());
+
+        if (s_user_params.b_histogram) makeHistogram(stats.latency);
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Playback streams are reported only if there are several of them */
+static void client_stream_statistics(const std::vector<int> &streamFds) {
+    FILE *f = g_pApp->m_const_params.fileFullLog;
 
-        if (s_user_params.b_histogram) makeHistogram(sortedpLat, counter);
+    if (s_streamStats.size() < 2) {
+        return;
+    }
+    log_msg_file2(f, "========= Printing statistics per playback stream");
+    for (size_t stream = 0; stream < s_streamStats.size(); stream++) {
+        const StreamStats &stats = s_streamStats[stream];
+        std::string addr = stream < streamFds.size()
+                               ? sockaddr_to_hostport(g_fds_array[streamFds[stream]]->server_addr)
+                               : std::string("?");
+        if (!stats.replies) {
+            log_msg_file2(f, "stream #%d (%s): replies=0; dropped=%" PRIu64, (int)stream,
+                          addr.c_str(), stats.dropped);
+            continue;
+        }
+        log_msg_file2(f, "stream #%d (%s): replies=%" PRIu64 "; dropped=%" PRIu64
+                         "; avg-%s=%.3lf; min=%.3lf; max=%.3lf usec",
+                      (int)stream, addr.c_str(), stats.replies, stats.dropped,
+                      round_trip_str[g_pApp->m_const_params.full_rtt],
+                      (stats.sum / (int)stats.replies).toDecimalUsec(),
+                      stats.min.toDecimalUsec(), stats.max.toDecimalUsec());
     }
+}
 
-    delete[] pLat;
-    delete[] pFullLog;
+#ifdef __linux__
+//------------------------------------------------------------------------------
+static void zcopy_statistics() {
+    if (!g_pApp->m_const_params.is_zcopy_send) return;
+
+    thread_stats_t total;
+    thread_stats_total(total);
+    log_msg("Summary: MSG_ZEROCOPY sends %" PRIu64 ", completed %" PRIu64 " (%" PRIu64
+            " copied by kernel), waits for completion %" PRIu64,
+            (uint64_t)total.zcopySendCount, (uint64_t)total.zcopyDoneCount,
+            (uint64_t)total.zcopyCopiedCount, (uint64_t)total.zcopyWaitCount);
 }
+#endif // __linux__
 
 //------------------------------------------------------------------------------
 void stream_statistics(Message *pMsgRequest) {
@@ -590,12 +859,15 @@ void stream_statistics(Message *pMsgRequest) {
     if (totalRunTime <= TicksDuration::TICKS0) return;
     if (!g_pApp->m_const_params.b_stream) return;
 
+    // every UDP GSO segment is a separate message with its own sequence number
     const uint64_t sendCount = pMsgRequest->getSequenceCounter();
+    thread_stats_t total;
+    thread_stats_total(total);
 
     // Send only mode!
-    if (g_skipCount) {
+    if (total.skipCount) {
         log_msg("Total of %" PRIu64 " messages sent in %.3lf sec (%" PRIu64 " messages skipped)\n",
-                sendCount, totalRunTime.toDecimalUsec() / 1000000, g_skipCount);
+                sendCount, totalRunTime.toDecimalUsec() / 1000000, (uint64_t)total.skipCount);
     } else {
         log_msg("Total of %" PRIu64 " messages sent in %.3lf sec\n", sendCount,
                 totalRunTime.toDecimalUsec() / 1000000);
@@ -644,6 +916,14 @@ void stream_statistics(Message *pMsgRequest) {
     } else {
         log_msg("Summary: BandWidth is %.3f MBps (%.3f Mbps)", MBps, MBps * 8);
     }
+#ifdef __linux__
+    if (g_pApp->m_const_params.is_udp_gso) {
+        log_msg("Summary: UDP GSO sends of %u segments (%" PRIu64 " sends)",
+                g_pApp->m_const_params.burst_size,
+                sendCount / g_pApp->m_const_params.burst_size);
+    }
+    zcopy_statistics();
+#endif // __linux__
 }
 
 //------------------------------------------------------------------------------
@@ -697,11 +977,153 @@ ClientBase::~ClientBase() {
     delete m_pMsgRequest;
 }
 
+//------------------------------------------------------------------------------
+static inline double pacing_uniform() {
+    return ((double)rand() + 0.5) / ((double)RAND_MAX + 1);
+}
+
+//------------------------------------------------------------------------------
+static LatencyHistogram s_pacingErrors; // nsec of wakeup after deadline (sender thread only)
+
+uint64_t PacingSleep::wait(const TicksTime &_deadline) {
+    static const TicksDuration s_spin((int64_t)g_pApp->m_const_params.pacing_spin_usec *
+                                      NSEC_IN_USEC);
+    TicksTime now = TicksTime::now();
+    uint64_t loops = 0;
+
+#ifndef __windows__
+    if (now + s_spin < _deadline) {
+        int64_t nsec = (_deadline - now - s_spin).toNsec();
+        struct timespec ts = { (time_t)(nsec / NSEC_IN_SEC), (long)(nsec % NSEC_IN_SEC) };
+#ifdef __linux__
+        clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+#else
+        nanosleep(&ts, NULL);
+#endif // __linux__
+        now = TicksTime::now();
+        loops++;
+    }
+#endif // __windows__
+    while (!g_b_exit && now < _deadline) {
+        now = TicksTime::now();
+        loops++;
+    }
+    if (now >= _deadline) {
+        s_pacingErrors.record((uint64_t)(now - _deadline).toNsec());
+    }
+    return loops;
+}
+
+void PacingSleep::print_summary() {
+    if (!s_pacingErrors.count()) {
+        return;
+    }
+    log_msg("Pacing error (wakeup after deadline, spin %" PRIu32 " usec): p50=%.3lf p99=%.3lf "
+            "p99.9=%.3lf max=%.3lf usec over %" PRIu64 " sends",
+            g_pApp->m_const_params.pacing_spin_usec, s_pacingErrors.percentile(0.5) / 1000.0,
+            s_pacingErrors.percentile(0.99) / 1000.0, s_pacingErrors.percentile(0.999) / 1000.0,
+            s_pacingErrors.max() / 1000.0, s_pacingErrors.count());
+}
+
+//------------------------------------------------------------------------------
+/* Gaps between cycles are drawn from --pacing distribution in advance and scaled to the mean
+ * of cycleDuration, so no random numbers are generated while the test runs */
+SwitchOnCyclePattern::SwitchOnCyclePattern() : m_gapsNum(0), m_next(0) {
+    const double cycleNsec = (double)g_pApp->m_const_params.cycleDuration.toNsec();
+    std::vector<double> gaps; // in cycleDuration units
+
+    switch (g_pApp->m_const_params.pacing) {
+    case PACING_POISSON:
+        gaps.resize(PACING_GAPS_NUM);
+        for (size_t i = 0; i < gaps.size(); i++) {
+            gaps[i] = -log(pacing_uniform());
+        }
+        break;
+    case PACING_UNIFORM: {
+        const double jitter = (double)g_pApp->m_const_params.pacing_jitter / 100;
+        gaps.resize(PACING_GAPS_NUM);
+        for (size_t i = 0; i < gaps.size(); i++) {
+            gaps[i] = 1 + jitter * (2 * pacing_uniform() - 1);
+        }
+        break;
+    }
+    case PACING_ONOFF: {
+        /* all cycles of a period are sent during ON time, last one waits for OFF time too */
+        const double onNsec = (double)g_pApp->m_const_params.pacing_on_msec * NSEC_IN_MSEC;
+        const double offNsec = (double)g_pApp->m_const_params.pacing_off_msec * NSEC_IN_MSEC;
+        const size_t num = (size_t)((onNsec + offNsec) / cycleNsec);
+        gaps.assign(num, onNsec / num / cycleNsec);
+        gaps[num - 1] += offNsec / cycleNsec;
+        break;
+    }
+    default:
+        gaps.assign(1, 1.0);
+        break;
+    }
+
+    /* keep mean rate of --mps */
+    double sum = 0;
+    for (size_t i = 0; i < gaps.size(); i++) {
+        sum += gaps[i];
+    }
+    const double scale = cycleNsec * gaps.size() / sum;
+    m_gaps.resize(gaps.size());
+    for (size_t i = 0; i < gaps.size(); i++) {
+        m_gaps[i] = TicksDuration((int64_t)(gaps[i] * scale + 0.5));
+    }
+    m_gapsNum = m_gaps.size();
+}
+
 //------------------------------------------------------------------------------
 template <class IoType, class SwitchCycleDuration, class PongModeCare>
 Client<IoType, SwitchCycleDuration, PongModeCare>::Client(int _fd_min, int _fd_max, int _fd_num)
     : ClientBase(), m_ioHandler(_fd_min, _fd_max, _fd_num), m_pongModeCare(m_pMsgRequest) {
     os_thread_init(&m_receiverTid);
+
+    if (g_pPacketTimes) {
+        client_stats_init();
+    }
+
+#ifdef __linux__
+    if (g_pApp->m_const_params.is_sendmmsg) {
+        const unsigned int count = g_pApp->m_const_params.burst_size;
+
+        m_batchMsgs.resize(count);
+        m_batchIov.resize(2 * count);
+        m_batchHeaders.resize(count * MsgHeader::EFFECTIVE_SIZE);
+        m_batchPong.resize(count);
+        for (unsigned int i = 0; i < count; i++) {
+            m_batchIov[2 * i].iov_base = &m_batchHeaders[i * MsgHeader::EFFECTIVE_SIZE];
+            m_batchIov[2 * i].iov_len = MsgHeader::EFFECTIVE_SIZE;
+            m_batchMsgs[i].msg_hdr.msg_iov = &m_batchIov[2 * i];
+            m_batchMsgs[i].msg_hdr.msg_iovlen = 2;
+        }
+    }
+    memset(&m_gsoMsg, 0, sizeof(m_gsoMsg));
+    if (g_pApp->m_const_params.is_udp_gso) {
+        const unsigned int count = g_pApp->m_const_params.burst_size;
+        const int msg_size = m_pMsgRequest->getLength();
+
+        m_gsoBuf.resize((size_t)count * msg_size);
+        m_batchPong.resize(count);
+        for (unsigned int i = 0; i < count; i++) {
+            memcpy(&m_gsoBuf[(size_t)i * msg_size], m_pMsgRequest->getBuf(), msg_size);
+        }
+        m_gsoIov.iov_base = m_gsoBuf.data();
+        m_gsoIov.iov_len = m_gsoBuf.size();
+        m_gsoMsg.msg_hdr.msg_iov = &m_gsoIov;
+        m_gsoMsg.msg_hdr.msg_iovlen = 1;
+        m_gsoMsg.msg_hdr.msg_control = m_gsoControl.buf;
+        m_gsoMsg.msg_hdr.msg_controllen = sizeof(m_gsoControl.buf);
+
+        /* the kernel splits the buffer into datagrams of msg_size bytes */
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&m_gsoMsg.msg_hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        *reinterpret_cast<uint16_t *>(CMSG_DATA(cmsg)) = (uint16_t)msg_size;
+    }
+#endif // __linux__
 }
 
 //------------------------------------------------------------------------------
@@ -734,10 +1156,32 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::cleanupAfterLoop() {
                                           // bytes" in pthread_create
         os_thread_close(&m_receiverTid);
     }
+    if (g_pIntervalReport) {
+        g_pIntervalReport->stop();
+    }
 
     if (g_b_errorOccured)
         return; // cleanup started in other thread and triggerd termination of this thread
 
+#ifdef __linux__
+    /* collect notifications of the last sends */
+    if (g_pApp->m_const_params.is_zcopy_send) {
+        for (int ifd = m_ioHandler.m_fd_min; ifd <= m_ioHandler.m_fd_max; ifd++) {
+            if (g_fds_array[ifd] && g_fds_array[ifd]->zcopy.hdrs) {
+                zcopy_reap(ifd);
+            }
+        }
+    }
+    /* collect TX timestamps that were not reaped on arrival of replies */
+    if (g_pApp->m_const_params.tstamp_mode != TSTAMP_NONE) {
+        for (int ifd = m_ioHandler.m_fd_min; ifd <= m_ioHandler.m_fd_max; ifd++) {
+            if (g_fds_array[ifd] && g_fds_array[ifd]->tstamp.keys) {
+                tstamp_reap(ifd);
+            }
+        }
+    }
+#endif // __linux__
+
     log_msg("Test ended");
 
     if (!m_pMsgRequest->getSequenceCounter()) {
@@ -771,14 +1215,23 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::cleanupAfterLoop() {
             fprintf(f, "------------------------------\n");
         }
 
+        client_retire_packets();
         for (int i = 0; i < g_pApp->m_const_params.client_work_with_srv_num; i++) {
             client_statistics(i, m_pMsgRequest);
         }
+        client_stream_statistics(m_streamFds);
+#ifdef __linux__
+        zcopy_statistics();
+#endif // __linux__
     }
 
     if (g_pApp->m_const_params.fileFullLog) fclose(g_pApp->m_const_params.fileFullLog);
 
-    if (g_pApp->m_const_params.cycleDuration > TicksDuration::TICKS0 && !g_cycle_wait_loop_counter)
+    thread_stats_t total;
+    thread_stats_total(total);
+    spin_wait_statistics(total);
+    PacingSleep::print_summary();
+    if (g_pApp->m_const_params.cycleDuration > TicksDuration::TICKS0 && !total.cycleWaitLoopCounter)
         log_msg("Info: The requested message-per-second rate is too high. Try tuning --mps or "
                 "--burst arguments");
 }
@@ -973,6 +1426,16 @@ int Client<IoType, SwitchCycleDuration, PongModeCare>::initBeforeLoop() {
                 rc = SOCKPERF_ERR_SOCKET;
                 break;
             }
+#ifdef __linux__
+            /*
+             * TX timestamp keys of TCP socket count bytes starting from the moment
+             * the option is set, that is allowed only for connected socket
+             */
+            if (s_user_params.tstamp_mode != TSTAMP_NONE && sock_set_timestamping(ifd, data)) {
+                rc = SOCKPERF_ERR_SOCKET;
+                break;
+            }
+#endif // __linux__
         }
     }
 
@@ -998,6 +1461,15 @@ int Client<IoType, SwitchCycleDuration, PongModeCare>::initBeforeLoop() {
             if (g_b_exit) return rc;
 
             rc = set_affinity_list(os_getthread(), g_pApp->m_const_params.sender_affinity);
+#ifdef __linux__
+            if (rc == SOCKPERF_ERR_NONE && (g_pApp->m_const_params.mem_prep & MEM_PREP_NUMA)) {
+                mem_prefault_fds(m_ioHandler.m_fd_min, m_ioHandler.m_fd_max);
+            }
+            if (rc == SOCKPERF_ERR_NONE && g_pApp->m_const_params.b_sleep_pacing) {
+                // default slack of 50 usec would delay every wakeup of the sender
+                prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+            }
+#endif // __linux__
             if (rc == SOCKPERF_ERR_NONE) {
                 if (!g_pApp->m_const_params.b_client_ping_pong &&
                     !g_pApp->m_const_params.b_stream) { // latency_under_load
@@ -1013,7 +1485,7 @@ int Client<IoType, SwitchCycleDuration, PongModeCare>::initBeforeLoop() {
                 if (rc == SOCKPERF_ERR_NONE) {
                     log_msg("Starting test...");
 
-                    if (!g_pApp->m_const_params.pPlaybackVector) {
+                    if (!g_pApp->m_const_params.pPlaybackReader) {
                         struct itimerval timer;
                         if (g_pApp->m_const_params.measurement == TIME_BASED) {
                             set_client_timer(&timer);
@@ -1028,6 +1500,9 @@ int Client<IoType, SwitchCycleDuration, PongModeCare>::initBeforeLoop() {
                         s_startTime.setNowNonInline();
                         g_lastTicks = s_startTime;
                         g_cycleStartTime = s_startTime - g_pApp->m_const_params.cycleDuration;
+                        if (g_pIntervalReport) {
+                            rc = g_pIntervalReport->start();
+                        }
                     }
                 }
             }
@@ -1061,7 +1536,7 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::doSendThenReceiveLoop()
             client_send_then_receive(curr_fds);
 
             // Packet not recorded, nothing to validate
-            if (g_receiveCount == seqNo) {
+            if (thread_stats().receiveCount == seqNo) {
                 continue;
             }
 
@@ -1102,6 +1577,51 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::doSendThenReceiveLoop()
     }
 }
 
+//------------------------------------------------------------------------------
+/* --outstanding: every connection keeps its window of requests in flight. Replies received by
+ * a pass of the loop free slots of windows (see handle_message()) and the next pass fills them.
+ */
+template <class IoType, class SwitchCycleDuration, class PongModeCare>
+void Client<IoType, SwitchCycleDuration, PongModeCare>::doPipelineLoop() {
+    const uint32_t window = g_pApp->m_const_params.outstanding;
+    bool has_udp = false;
+    int curr_fds = m_ioHandler.m_fd_min;
+    TicksTime expireTime = TicksTime::now() + TicksDuration::TICKS1MSEC;
+
+    m_pipeline.resize(m_ioHandler.m_fd_max + 1);
+    for (int i = 0; i < m_ioHandler.m_fd_num; i++) {
+        PipelineConn &conn = m_pipeline[curr_fds];
+        conn.seqs.assign(window, 0);
+        conn.head = conn.count = 0;
+        conn.refill = window;
+        m_pipelineFds.push_back(curr_fds);
+        m_pipelineRefillFds.push_back(curr_fds);
+        has_udp |= (g_fds_array[curr_fds]->sock_type == SOCK_DGRAM);
+        curr_fds = g_fds_array[curr_fds]->next_fd;
+    }
+    m_pipelineInFlight = 0;
+
+    while (!g_b_exit) {
+        pipeline_send();
+
+        // nothing to wait for while all sends of the window are skipped
+        if (m_pipelineInFlight) {
+            int numReady = m_ioHandler.waitArrival();
+            if (numReady && !g_b_exit) {
+                client_receive_ready(numReady);
+            }
+        }
+
+        if (has_udp) {
+            TicksTime now = TicksTime::now();
+            if (now >= expireTime) {
+                pipeline_expire(now);
+                expireTime = now + TicksDuration::TICKS1MSEC;
+            }
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 template <class IoType, class SwitchCycleDuration, class PongModeCare>
 void Client<IoType, SwitchCycleDuration, PongModeCare>::doSendLoop() {
@@ -1115,11 +1635,7 @@ static inline void playbackCycleDurationWait(const TicksDuration &i_cycleDuratio
     static TicksTime s_cycleStartTime = TicksTime().setNowNonInline(); // will only be executed once
 
     TicksTime nextCycleStartTime = s_cycleStartTime + i_cycleDuration;
-    while (!g_b_exit) {
-        if (TicksTime::now() >= nextCycleStartTime) {
-            break;
-        }
-    }
+    cycle_wait(nextCycleStartTime);
     s_cycleStartTime = nextCycleStartTime;
 }
 
@@ -1129,31 +1645,64 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::doPlayback() {
     static const bool is_exec_activity_info =
         (g_pApp->m_const_params.packetrate_stats_print_ratio > 0);
 
+    PlaybackReader &reader = *g_pApp->m_const_params.pPlaybackReader;
+    const PlaybackItem *pItem;
+    size_t nextStream = 0; // of round robin
+    bool streamWarned = false;
+
+    m_streamFds.clear();
+    for (int ifd = m_ioHandler.m_fd_min; m_streamFds.size() < (size_t)m_ioHandler.m_fd_num;
+         ifd = g_fds_array[ifd]->next_fd) {
+        m_streamFds.push_back(ifd);
+    }
+
+    if (reader.start() != SOCKPERF_ERR_NONE) { // loader parses ahead while items are sent
+        g_b_exit = true;
+        return;
+    }
     usleep(100 * 1000); // wait for receiver thread to start (since we don't use warmup) //TODO:
                         // configure!
     s_startTime.setNowNonInline(); // reduce code size by calling non inline func from slow path
-    const PlaybackVector &pv = *g_pApp->m_const_params.pPlaybackVector;
-
-    size_t i = 0;
-    const size_t size = pv.size();
 
-    // cycle through all set fds in the array (with wrap around to beginning)
-    for (int ifd = m_ioHandler.m_fd_min; i < size && !g_b_exit;
-         ifd = g_fds_array[ifd]->next_fd, ++i) {
+    // send every item to the socket of its stream, streams beyond the feed file wrap around
+    while (!g_b_exit && (pItem = reader.next()) != NULL) {
+        size_t stream;
+        if (pItem->stream == PLAYBACK_ANY_STREAM) {
+            stream = nextStream;
+            nextStream = (nextStream + 1 < m_streamFds.size()) ? nextStream + 1 : 0;
+        } else {
+            stream = (size_t)pItem->stream;
+            if (unlikely(stream >= m_streamFds.size())) {
+                if (!streamWarned) {
+                    log_msg("WARNING: stream %d of the playback file is beyond the %d sockets of "
+                            "the feed file, such streams are sent to socket (stream %% %d)",
+                            pItem->stream, (int)m_streamFds.size(), (int)m_streamFds.size());
+                    streamWarned = true;
+                }
+                stream %= m_streamFds.size();
+            }
+        }
 
-        m_pMsgRequest->setLength(pv[i].size);
+        m_pMsgRequest->setLength(pItem->size);
 
         // idle
-        playbackCycleDurationWait(pv[i].duration);
+        playbackCycleDurationWait(pItem->duration);
 
         // send
-        client_send_packet(ifd);
+        uint64_t seqNo = m_pMsgRequest->getSequenceCounter() + 1;
+        client_send_packet(m_streamFds[stream]);
+        g_pPacketTimes->setStream(seqNo, (int)stream);
 
         if (unlikely(is_exec_activity_info)) {
             m_switchActivityInfo.execute(m_pMsgRequest->getSequenceCounter());
         }
     }
-    g_cycle_wait_loop_counter++; // for silenting waring at the end
+    reader.stop();
+    if (reader.failed()) {
+        exit_with_log("Playback stopped at a broken item of the data file, results are not valid",
+                      SOCKPERF_ERR_INCORRECT);
+    }
+    thread_stats().cycleWaitLoopCounter++; // for silenting waring at the end
     s_endTime.setNowNonInline(); // reduce code size by calling non inline func from slow path
     usleep(20 * 1000);           // wait for reply of last packet //TODO: configure!
     g_b_exit = true;
@@ -1167,8 +1716,10 @@ void Client<IoType, SwitchCycleDuration, PongModeCare>::doHandler() {
     rc = initBeforeLoop();
 
     if (rc == SOCKPERF_ERR_NONE) {
-        if (g_pApp->m_const_params.pPlaybackVector)
+        if (g_pApp->m_const_params.pPlaybackReader)
             doPlayback();
+        else if (g_pApp->m_const_params.outstanding)
+            doPipelineLoop();
         else if (g_pApp->m_const_params.b_client_ping_pong)
             doSendThenReceiveLoop();
         else
@@ -1206,6 +1757,9 @@ void client_handler(int _fd_min, int _fd_max, int _fd_num) {
         if (g_pApp->m_const_params.dummy_mps) {
             client_handler<IoType, SwitchOnDummySend>(
                 _fd_min, _fd_max, _fd_num);
+        } else if (g_pApp->m_const_params.pacing != PACING_FIXED) {
+            client_handler<IoType, SwitchOnCyclePattern>(
+                _fd_min, _fd_max, _fd_num);
         } else {
             client_handler<IoType, SwitchOnCycleDuration>(
                 _fd_min, _fd_max, _fd_num);
@@ -1241,6 +1795,12 @@ void client_handler(handler_info *p_info) {
             client_handler<IoEpoll>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
             break;
         }
+#ifdef USING_IOURING
+        case IOURING: {
+            client_handler<IoUring>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            break;
+        }
+#endif // USING_IOURING
 #endif // !__FreeBSD__ && !defined(__APPLE__)
 #if defined(__FreeBSD__) || defined(__APPLE__)
         case KQUEUE: {
@@ -33,6 +33,7 @@
 #include "common.h"
 #include "input_handlers.h"
 #include "packet.h"
+#include "interval_report.h"
 #include "switches.h"
 
 //==============================================================================
@@ -63,6 +64,33 @@ private:
     SwitchOnMsgSize m_switchMsgSize;
     PongModeCare m_pongModeCare; // has msg_sendto() method and can be one of: PongModeNormal,
                                  // PongModeAlways, PongModeNever
+    std::vector<int> m_streamFds; // playback streams: sockets in the order of feed file
+    // --outstanding: requests in flight of a connection, oldest first
+    struct PipelineConn {
+        std::vector<uint64_t> seqs; // ring of --outstanding sequence numbers
+        uint32_t head;
+        uint32_t count;
+        uint32_t refill; // requests to send to fill the window again
+    };
+    std::vector<PipelineConn> m_pipeline; // indexed by fd
+    std::vector<int> m_pipelineFds;       // connections of the client
+    std::vector<int> m_pipelineRefillFds; // connections with requests to send
+    uint64_t m_pipelineInFlight;
+#ifdef __linux__
+    // --sendmmsg: every message of a burst has its own header slot and shares the payload
+    std::vector<struct mmsghdr> m_batchMsgs;
+    std::vector<struct iovec> m_batchIov;
+    std::vector<uint8_t> m_batchHeaders;
+    std::vector<uint8_t> m_batchPong; // tx time was taken for the message
+    // --udp-gso: messages of a burst are laid out back to back in a single buffer
+    std::vector<uint8_t> m_gsoBuf;
+    struct mmsghdr m_gsoMsg;
+    struct iovec m_gsoIov;
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } m_gsoControl;
+#endif // __linux__
 
     class ClientMessageHandlerCallback {
         Client<IoType, SwitchCycleDuration, PongModeCare> &m_client;
@@ -104,6 +132,7 @@ public:
 private:
     int initBeforeLoop();
     void doSendThenReceiveLoop();
+    void doPipelineLoop();
     void doSendLoop();
     void doPlayback();
     void cleanupAfterLoop();
@@ -145,7 +174,7 @@ private:
     }
 
     //------------------------------------------------------------------------------
-    inline void client_send_packet(int ifd) {
+    inline bool client_send_packet(int ifd) {
         int ret = 0;
 
         m_pMsgRequest->incSequenceCounter();
@@ -154,7 +183,7 @@ private:
 
         /* return on success */
         if (likely(ret > 0)) {
-            return;
+            return true;
         }
         /* check dead peer case */
         else if (ret == RET_SOCKET_SHUTDOWN) {
@@ -165,11 +194,198 @@ private:
         }
         /* check skip send operation case */
         else if (ret == RET_SOCKET_SKIPPED) {
-            g_skipCount++;
+            thread_stats().skipCount++;
             m_pMsgRequest->decSequenceCounter();
+            return false;
+        }
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /* --outstanding: send requests that fill the windows of connections again; a connection
+     * whose send was skipped stays in the list for the next pass of the loop
+     */
+    inline void pipeline_send() {
+        static const bool is_exec_activity_info =
+            (g_pApp->m_const_params.packetrate_stats_print_ratio > 0);
+
+        static const bool is_exec_msg_size =
+            (g_pApp->m_const_params.msg_size_range > 0);
+
+        size_t waiting = 0;
+        for (size_t i = 0; i < m_pipelineRefillFds.size(); i++) {
+            int ifd = m_pipelineRefillFds[i];
+            PipelineConn &conn = m_pipeline[ifd];
+            const uint32_t window = (uint32_t)conn.seqs.size();
+
+            while (conn.refill && !g_b_exit) {
+                if (unlikely(is_exec_msg_size)) {
+                    m_switchMsgSize.execute(m_pMsgRequest);
+                }
+                if (!client_send_packet(ifd)) {
+                    break;
+                }
+                uint32_t tail = conn.head + conn.count;
+                conn.seqs[tail < window ? tail : tail - window] =
+                    m_pMsgRequest->getSequenceCounter();
+                conn.count++;
+                conn.refill--;
+                m_pipelineInFlight++;
+
+                if (unlikely(is_exec_activity_info)) {
+                    m_switchActivityInfo.execute(m_pMsgRequest->getSequenceCounter());
+                }
+            }
+            if (conn.refill) {
+                m_pipelineRefillFds[waiting++] = ifd;
+            }
         }
+        m_pipelineRefillFds.resize(waiting);
     }
 
+    //------------------------------------------------------------------------------
+    /* --outstanding: the oldest _num requests of the connection are done, their slots of the
+     * window are filled by pipeline_send()
+     */
+    inline void pipeline_ack(int ifd, uint32_t _num) {
+        PipelineConn &conn = m_pipeline[ifd];
+        const uint32_t window = (uint32_t)conn.seqs.size();
+
+        conn.head += _num;
+        if (conn.head >= window) {
+            conn.head -= window;
+        }
+        conn.count -= _num;
+        m_pipelineInFlight -= _num;
+        if (!conn.refill) {
+            m_pipelineRefillFds.push_back(ifd);
+        }
+        conn.refill += _num;
+    }
+
+    //------------------------------------------------------------------------------
+    /* --outstanding: a reply acknowledges its request and the older requests of the connection
+     * that it has overtaken (lost or reordered datagrams). Reply of a request that is not in the
+     * window any more does not change the window.
+     */
+    inline void pipeline_reply(int ifd, uint64_t seqNo) {
+        PipelineConn &conn = m_pipeline[ifd];
+        const uint32_t window = (uint32_t)conn.seqs.size();
+        uint32_t pos = conn.head;
+
+        for (uint32_t i = 0; i < conn.count; i++) {
+            if (conn.seqs[pos] == seqNo) {
+                pipeline_ack(ifd, i + 1);
+                return;
+            }
+            pos = (pos + 1 < window ? pos + 1 : 0);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /* --outstanding: UDP requests without reply for OUTSTANDING_LOSS_MSEC are considered lost */
+    inline void pipeline_expire(const TicksTime &_now) {
+        static const TicksDuration s_lossTimeout =
+            TicksDuration::TICKS1MSEC * OUTSTANDING_LOSS_MSEC;
+
+        for (size_t i = 0; i < m_pipelineFds.size(); i++) {
+            int ifd = m_pipelineFds[i];
+            PipelineConn &conn = m_pipeline[ifd];
+            const uint32_t window = (uint32_t)conn.seqs.size();
+            uint32_t pos = conn.head;
+            uint32_t expired = 0;
+
+            if (g_fds_array[ifd]->sock_type != SOCK_DGRAM) {
+                continue;
+            }
+            while (expired < conn.count) {
+                const TicksTime &txTime = g_pPacketTimes->getTxTime(conn.seqs[pos]);
+                if (txTime != TicksTime::TICKS0 && _now - txTime < s_lossTimeout) {
+                    break;
+                }
+                expired++;
+                pos = (pos + 1 < window ? pos + 1 : 0);
+            }
+            if (expired) {
+                pipeline_ack(ifd, expired);
+            }
+        }
+    }
+
+#ifdef __linux__
+    //------------------------------------------------------------------------------
+    inline void client_send_batch(int ifd) {
+        const unsigned int count = g_pApp->m_const_params.burst_size;
+        const size_t payload_len = m_pMsgRequest->getLength() - MsgHeader::EFFECTIVE_SIZE;
+        fds_data *l_fds_ifd = g_fds_array[ifd];
+        int ret = 0;
+
+        for (unsigned int i = 0; i < count; i++) {
+            m_pMsgRequest->incSequenceCounter();
+            m_batchPong[i] = m_pongModeCare.msg_header_copy(&m_batchHeaders[i * MsgHeader::EFFECTIVE_SIZE]);
+
+            struct msghdr &hdr = m_batchMsgs[i].msg_hdr;
+            hdr.msg_name = &l_fds_ifd->server_addr;
+            hdr.msg_namelen = l_fds_ifd->server_addr_len;
+            m_batchIov[2 * i + 1].iov_base = m_pMsgRequest->getData();
+            m_batchIov[2 * i + 1].iov_len = payload_len;
+        }
+
+        ret = msg_sendmmsg(ifd, m_batchMsgs.data(), count);
+
+        /* return on success */
+        if (likely(ret == (int)count)) {
+            return;
+        }
+        /* messages that were not sent (partial send, EAGAIN, EINTR or error) are handled as
+         * skipped send operation, otherwise they would be counted as dropped
+         */
+        else {
+            unsigned int sent = (ret > 0 ? (unsigned int)ret : 0);
+            for (unsigned int i = count; i > sent; i--) {
+                if (m_batchPong[i - 1]) {
+                    g_pPacketTimes->clearTxTime(m_pMsgRequest->getSequenceCounter());
+                }
+                m_pMsgRequest->decSequenceCounter();
+                thread_stats().skipCount++;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    inline void client_send_gso(int ifd) {
+        const unsigned int count = g_pApp->m_const_params.burst_size;
+        const int msg_size = m_pMsgRequest->getLength();
+        fds_data *l_fds_ifd = g_fds_array[ifd];
+        int ret = 0;
+
+        /* every segment carries its own header, payload was copied once */
+        for (unsigned int i = 0; i < count; i++) {
+            m_pMsgRequest->incSequenceCounter();
+            m_batchPong[i] = m_pongModeCare.msg_header_copy(&m_gsoBuf[i * msg_size]);
+        }
+        m_gsoMsg.msg_hdr.msg_name = &l_fds_ifd->server_addr;
+        m_gsoMsg.msg_hdr.msg_namelen = l_fds_ifd->server_addr_len;
+
+        ret = msg_sendmmsg(ifd, &m_gsoMsg, 1);
+
+        /* return on success */
+        if (likely(ret == 1)) {
+            return;
+        }
+        /* segments of not sent buffer are handled as skipped send operations */
+        else {
+            for (unsigned int i = count; i > 0; i--) {
+                if (m_batchPong[i - 1]) {
+                    g_pPacketTimes->clearTxTime(m_pMsgRequest->getSequenceCounter());
+                }
+                m_pMsgRequest->decSequenceCounter();
+                thread_stats().skipCount++;
+            }
+        }
+    }
+#endif // __linux__
+
     //------------------------------------------------------------------------------
     template <class InputHandler>
     inline unsigned int client_receive_from_selected_(int ifd) {
@@ -190,7 +406,18 @@ private:
                                   l_fds_ifd);
                 }
             }
-            else /* (ret < 0) */ return 0;
+            else /* (ret < 0) */ {
+#ifdef __linux__
+                /* iomux reports pending MSG_ZEROCOPY notifications as an error event */
+                if (l_fds_ifd->zcopy.hdrs) {
+                    zcopy_reap(ifd);
+                }
+                if (l_fds_ifd->tstamp.keys) {
+                    tstamp_reap(ifd);
+                }
+#endif // __linux__
+                return 0;
+            }
         }
 
         ClientMessageHandlerCallback callback(*this, ifd, recvfrom_addr, recvfrom_len);
@@ -216,10 +443,19 @@ private:
     }
 #endif
 
+#ifdef USING_IOURING
+    template <typename T = IoType>
+    inline std::enable_if_t<is_iouring_bufftype<T>::value, unsigned int>
+    client_receive_from_selected(int ifd) {
+        return client_receive_from_selected_<UringInputHandler>(ifd);
+    }
+#endif // USING_IOURING
+
     template <typename T = IoType>
     inline std::enable_if_t<!(
         is_vma_bufftype<T>{} ||
-        is_xlio_bufftype<T>{}), unsigned int>
+        is_xlio_bufftype<T>{} ||
+        is_iouring_bufftype<T>{}), unsigned int>
         client_receive_from_selected(int ifd) {
 #ifdef USING_VMA_EXTRA_API // VMA
         if (g_pApp->m_const_params.is_zcopyread && g_vma_api) {
@@ -231,12 +467,21 @@ private:
             return client_receive_from_selected_<XlioZCopyReadInputHandler>(ifd);
         }
 #endif // USING_XLIO_EXTRA_API
+#ifdef __linux__
+        if (g_fds_array[ifd]->recv.mmsg_num) {
+            return client_receive_from_selected_<RecvMmsgInputHandler>(ifd);
+        }
+        if (g_fds_array[ifd]->tstamp.keys) {
+            return client_receive_from_selected_<RecvTstampInputHandler>(ifd);
+        }
+#endif // __linux__
         return client_receive_from_selected_<RecvFromInputHandler>(ifd);
     }
 
     inline bool handle_message(int ifd, struct sockaddr_store_t &recvfrom_addr, socklen_t recvfrom_addrlen, int &receiveCount)
     {
         static const bool is_exec_data_integrity = g_pApp->m_const_params.data_integrity;
+        static const bool is_exec_pipeline = (g_pApp->m_const_params.outstanding > 0);
 
         int serverNo = 0;
 
@@ -289,10 +534,32 @@ private:
         if (unlikely(serverNo < 0)) {
             exit_with_log("Number of servers more than expected", SOCKPERF_ERR_FATAL);
         } else {
-            g_pPacketTimes->setRxTime(m_pMsgReply->getSequenceCounter(), rxTime, serverNo);
+            bool isStored =
+                g_pPacketTimes->setRxTime(m_pMsgReply->getSequenceCounter(), rxTime, serverNo);
+            // duplicated or too late reply is not a sample of the interval
+            if (unlikely(g_pIntervalReport) && isStored) {
+                const TicksTime &txTime =
+                    g_pPacketTimes->getTxTime(m_pMsgReply->getSequenceCounter());
+                if (txTime != TicksTime::TICKS0) {
+                    g_pIntervalReport->push(m_pMsgReply->getSequenceCounter(),
+                                            (rxTime - txTime) /
+                                                (g_pApp->m_const_params.full_rtt ? 1 : 2));
+                }
+            }
+#ifdef __linux__
+            if (unlikely(g_fds_array[ifd]->tstamp.keys)) {
+                g_pPacketTimes->setKernelRxTime(m_pMsgReply->getSequenceCounter(),
+                                                g_fds_array[ifd]->tstamp.rx_time, serverNo);
+                /* TX timestamp of the request is already queued when its reply is here */
+                tstamp_reap(ifd);
+            }
+#endif // __linux__
             if (unlikely(is_exec_data_integrity)) {
                 m_switchDataIntegrity.execute(m_pMsgRequest, m_pMsgReply);
             }
+            if (is_exec_pipeline) {
+                pipeline_reply(ifd, m_pMsgReply->getSequenceCounter());
+            }
         }
 
         return true;
@@ -309,6 +576,11 @@ private:
 
         if (g_b_exit) return 0;
 
+        return client_receive_ready(numReady);
+    }
+
+    //------------------------------------------------------------------------------
+    inline unsigned int client_receive_ready(int numReady) {
         // check errors
         if (unlikely(numReady < 0)) {
             exit_with_log(handler2str(g_pApp->m_const_params.fd_handler_type), SOCKPERF_ERR_FATAL);
@@ -346,6 +618,11 @@ private:
         static const bool is_exec_msg_size =
             (g_pApp->m_const_params.msg_size_range > 0);
 
+#ifdef __linux__
+        static const bool is_exec_sendmmsg = g_pApp->m_const_params.is_sendmmsg;
+        static const bool is_exec_udp_gso = g_pApp->m_const_params.is_udp_gso;
+#endif // __linux__
+
         // init
         if (unlikely(is_exec_msg_size)) {
             m_switchMsgSize.execute(m_pMsgRequest);
@@ -355,14 +632,27 @@ private:
         m_switchCycleDuration.execute(m_pMsgRequest, ifd);
 
         // send
-        for (unsigned i = 0; i < g_pApp->m_const_params.burst_size && !g_b_exit; i++) {
-            client_send_packet(ifd);
-#ifdef USING_EXTRA_API // For VMA socketxtreme Only
-            if (g_pApp->m_const_params.fd_handler_type == SOCKETXTREME &&
-                !g_pApp->m_const_params.b_client_ping_pong) {
-                m_ioHandler.waitArrival();
+#ifdef __linux__
+        if (is_exec_sendmmsg && g_fds_array[ifd]->sock_type == SOCK_DGRAM) {
+            if (!g_b_exit) {
+                client_send_batch(ifd);
             }
+        } else if (is_exec_udp_gso && g_fds_array[ifd]->sock_type == SOCK_DGRAM) {
+            if (!g_b_exit) {
+                client_send_gso(ifd);
+            }
+        } else
+#endif // __linux__
+        {
+            for (unsigned i = 0; i < g_pApp->m_const_params.burst_size && !g_b_exit; i++) {
+                client_send_packet(ifd);
+#ifdef USING_EXTRA_API // For VMA socketxtreme Only
+                if (g_pApp->m_const_params.fd_handler_type == SOCKETXTREME &&
+                    !g_pApp->m_const_params.b_client_ping_pong) {
+                    m_ioHandler.waitArrival();
+                }
 #endif // USING_EXTRA_API
+            }
         }
 
         if (unlikely(is_exec_activity_info)) {
@@ -27,6 +27,15 @@
  */
 
 #include "common.h"
+#include "packet.h"
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <ifaddrs.h>
+#include <sys/mman.h>
+#endif // __linux__
 
 extern void cleanup();
 
@@ -237,6 +246,9 @@ const char *handler2str(fd_block_handler_t type) {
                                                             "poll",
 #ifdef __linux__
                                                             "epoll",
+#ifdef USING_IOURING
+                                                            "io_uring",
+#endif // USING_IOURING
 #elif defined(__APPLE__) || defined(__FreeBSD__)
                                                             "kqueue",
 #endif // defined(__APPLE__) || defined(__FreeBSD__)
@@ -273,3 +285,457 @@ int sock_set_rate_limit(int fd, uint32_t rate_limit) {
     }
     return rc;
 }
+
+//------------------------------------------------------------------------------
+void spin_wait_statistics(const thread_stats_t &total) {
+    uint64_t messages = total.spinMessages + total.blockMessages;
+
+    if (!g_pApp->m_const_params.spin_wait_usec || !messages) {
+        return;
+    }
+    log_msg("Spin wait of %" PRIu32 " usec: %.2lf%% of messages caught while spinning, "
+            "%.2lf%% after blocking",
+            g_pApp->m_const_params.spin_wait_usec, 100.0 * total.spinMessages / messages,
+            100.0 * total.blockMessages / messages);
+}
+
+#ifdef __linux__
+/* recvmmsg() slots of a thread. A batch is handled before the next recvmmsg() call and a
+ * partial message is copied to the buffer of its socket, so all sockets of the thread share
+ * the slots and the memory does not grow with the number of sockets.
+ */
+struct RecvmmsgSlots {
+    struct mmsghdr *msgs = nullptr;
+    int num = 0;
+    int max_size = 0;
+    ~RecvmmsgSlots() {
+        if (msgs) {
+            FREE(msgs);
+        }
+    }
+};
+
+static thread_local RecvmmsgSlots s_recvmmsgSlots;
+
+/* Request <num> recvmmsg() slots for a socket, they are attached by the thread that receives
+ * from it (see recvmmsg_thread_slots()).
+ */
+int recvmmsg_slots_alloc(SocketRecvData &recv, int num) {
+    recv.mmsg = nullptr;
+    recv.mmsg_num = num;
+    return SOCKPERF_ERR_NONE;
+}
+
+void recvmmsg_slots_free(SocketRecvData &recv) {
+    recv.mmsg = nullptr;
+    recv.mmsg_num = 0;
+}
+
+/* Slots of the calling thread for <num> messages of up to <max_size> bytes, allocated on the
+ * first call. Headers, iovecs, peer addresses and data buffers share one memory block.
+ */
+struct mmsghdr *recvmmsg_thread_slots(int num, int max_size) {
+    RecvmmsgSlots &slots = s_recvmmsgSlots;
+    if (likely(slots.msgs)) {
+        if (num > slots.num || max_size > slots.max_size) {
+            exit_with_log("recvmmsg() slots of a thread are smaller than requested",
+                          SOCKPERF_ERR_FATAL);
+        }
+        return slots.msgs;
+    }
+
+    size_t hdr_size = sizeof(struct mmsghdr) * num;
+    size_t iov_size = sizeof(struct iovec) * num;
+    size_t addr_size = sizeof(struct sockaddr_store_t) * num;
+    size_t buf_offset = (hdr_size + iov_size + addr_size + 63) & ~(size_t)63;
+    size_t size = buf_offset + (size_t)max_size * num;
+    uint8_t *block = (uint8_t *)MALLOC(size);
+
+    if (!block) {
+        exit_with_log("Failed to allocate memory for recvmmsg() slots", SOCKPERF_ERR_NO_MEMORY);
+    }
+
+    struct mmsghdr *msgs = reinterpret_cast<struct mmsghdr *>(block);
+    struct iovec *iov = reinterpret_cast<struct iovec *>(block + hdr_size);
+    struct sockaddr_store_t *addrs =
+        reinterpret_cast<struct sockaddr_store_t *>(block + hdr_size + iov_size);
+    uint8_t *bufs = block + buf_offset;
+
+    memset(block, 0, buf_offset);
+    for (int i = 0; i < num; i++) {
+        iov[i].iov_base = bufs + (size_t)max_size * i;
+        iov[i].iov_len = max_size;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_store_t);
+    }
+    if (s_user_params.mem_prep & MEM_PREP_PREFAULT) {
+        mem_prefault(bufs, size - buf_offset); // by the thread that receives into them
+    }
+    slots.msgs = msgs;
+    slots.num = num;
+    slots.max_size = max_size;
+
+    return msgs;
+}
+
+/* Allocate <num> message header slots for MSG_ZEROCOPY sends of a socket.
+ */
+int zcopy_slots_alloc(SocketZcopyData &zcopy, int num) {
+    size_t end_size = (sizeof(uint32_t) * num + 63) & ~(size_t)63;
+    uint8_t *block = (uint8_t *)MALLOC(end_size + (size_t)MsgHeader::EFFECTIVE_SIZE * num);
+
+    if (!block) {
+        log_err("Failed to allocate memory with malloc()");
+        return SOCKPERF_ERR_NO_MEMORY;
+    }
+
+    memset(block, 0, end_size);
+    zcopy.hdr_end = reinterpret_cast<uint32_t *>(block);
+    zcopy.hdrs = block + end_size;
+    zcopy.slot_num = num;
+    zcopy.slot_next = 0;
+    zcopy.next_id = 0;
+    zcopy.done_num = 0;
+
+    return SOCKPERF_ERR_NONE;
+}
+
+void zcopy_slots_free(SocketZcopyData &zcopy) {
+    if (zcopy.hdr_end) {
+        FREE(zcopy.hdr_end);
+        zcopy.hdr_end = nullptr;
+    }
+    zcopy.hdrs = nullptr;
+    zcopy.slot_num = 0;
+}
+
+/* Drain MSG_ZEROCOPY completion notifications from the socket error queue.
+ * It can be called by sender and receiver threads concurrently.
+ * Returns number of sends that were completed.
+ */
+int zcopy_reap(int fd) {
+    SocketZcopyData &zcopy = g_fds_array[fd]->zcopy;
+    uint8_t control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    struct msghdr msg;
+    int saved_errno = errno;
+    int done = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    while (true) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            const struct sock_extended_err *serr =
+                reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            /* notification covers the range of send ids [ee_info, ee_data] */
+            uint32_t num = serr->ee_data - serr->ee_info + 1;
+            __atomic_fetch_add(&zcopy.done_num, num, __ATOMIC_RELEASE);
+            thread_stats().zcopyDoneCount += num;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                thread_stats().zcopyCopiedCount += num;
+            }
+            done += (int)num;
+        }
+    }
+    errno = saved_errno;
+
+    return done;
+}
+
+/* Find the name of the interface that sends to <addr> by the local address that the routing
+ * table chooses for it.
+ */
+static int hw_timestamping_ifname(const struct sockaddr *addr, socklen_t addr_len,
+                                  char ifname[IFNAMSIZ]) {
+    struct sockaddr_store_t local;
+    socklen_t local_len = sizeof(local);
+    if (addr->sa_family != AF_INET && addr->sa_family != AF_INET6) {
+        log_msg("Hardware timestamps are supported only with IPv4/IPv6 sockets");
+        return SOCKPERF_ERR_UNSUPPORTED;
+    }
+    int fd = socket(addr->sa_family, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, addr, addr_len) ||
+        getsockname(fd, reinterpret_cast<struct sockaddr *>(&local), &local_len)) {
+        log_err("Can't find the route to %s", sockaddr_to_hostport(addr).c_str());
+        if (fd >= 0) {
+            close(fd);
+        }
+        return SOCKPERF_ERR_SOCKET;
+    }
+    close(fd);
+
+    struct ifaddrs *ifas = NULL;
+    if (getifaddrs(&ifas)) {
+        log_err("getifaddrs() failed");
+        return SOCKPERF_ERR_SOCKET;
+    }
+    int rc = SOCKPERF_ERR_NOT_EXIST;
+    for (struct ifaddrs *ifa = ifas; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != local.addr.sa_family) {
+            continue;
+        }
+        bool match = false;
+        if (local.addr.sa_family == AF_INET) {
+            match = !memcmp(&reinterpret_cast<struct sockaddr_in *>(ifa->ifa_addr)->sin_addr,
+                            &local.addr4.sin_addr, sizeof(struct in_addr));
+        } else {
+            match = !memcmp(&reinterpret_cast<struct sockaddr_in6 *>(ifa->ifa_addr)->sin6_addr,
+                            &local.addr6.sin6_addr, sizeof(struct in6_addr));
+        }
+        if (match) {
+            strncpy(ifname, ifa->ifa_name, IFNAMSIZ - 1);
+            ifname[IFNAMSIZ - 1] = '\0';
+            rc = SOCKPERF_ERR_NONE;
+            break;
+        }
+    }
+    freeifaddrs(ifas);
+    if (rc) {
+        log_msg("Can't find the interface of address %s", sockaddr_to_hostport(&local).c_str());
+    }
+    return rc;
+}
+
+/* NIC reports timestamps only when device timestamping is enabled (SIOCSHWTSTAMP), which is
+ * kept if the privileges to change it are missing but someone (e.g. ptp4l) has enabled it.
+ * The timestamps are taken by the clock of the NIC (PHC), so it must be synchronized with the
+ * system clock (e.g. by phc2sys) to compare them with the time of the application.
+ */
+static int hw_timestamping_enable(const struct sockaddr *addr, socklen_t addr_len) {
+    static char s_ifname[IFNAMSIZ] = ""; // last enabled interface
+    char ifname[IFNAMSIZ];
+    int rc = hw_timestamping_ifname(addr, addr_len, ifname);
+    if (rc || !strcmp(ifname, s_ifname)) {
+        return rc;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        log_err("socket() failed");
+        return SOCKPERF_ERR_SOCKET;
+    }
+    struct hwtstamp_config config;
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    memcpy(ifr.ifr_name, ifname, IFNAMSIZ);
+    ifr.ifr_data = reinterpret_cast<char *>(&config);
+
+    memset(&config, 0, sizeof(config));
+    config.tx_type = HWTSTAMP_TX_ON;
+    config.rx_filter = HWTSTAMP_FILTER_ALL;
+    if (ioctl(fd, SIOCSHWTSTAMP, &ifr) < 0) {
+        int err = errno;
+        memset(&config, 0, sizeof(config));
+        if (ioctl(fd, SIOCGHWTSTAMP, &ifr) < 0 || config.tx_type != HWTSTAMP_TX_ON ||
+            config.rx_filter != HWTSTAMP_FILTER_ALL) {
+            errno = err;
+            log_err("Can't enable hardware timestamps of all packets on interface %s "
+                    "(SIOCSHWTSTAMP), it requires NIC support and CAP_NET_ADMIN",
+                    ifname);
+            rc = SOCKPERF_ERR_SOCKET;
+        }
+    } else if (config.rx_filter != HWTSTAMP_FILTER_ALL) {
+        log_msg("Interface %s can't timestamp all received packets", ifname);
+        rc = SOCKPERF_ERR_SOCKET;
+    }
+    close(fd);
+
+    if (!rc) {
+        memcpy(s_ifname, ifname, IFNAMSIZ);
+        log_msg("Hardware timestamps are enabled on interface %s, its clock must be "
+                "synchronized with the system clock (e.g. by phc2sys)",
+                ifname);
+    }
+    return rc;
+}
+
+/* Enable kernel RX and TX timestamps of a client socket.
+ * TX timestamps are reported without packet payload and identified by send key.
+ */
+int sock_set_timestamping(int fd, struct fds_data *p_data) {
+    int rc = SOCKPERF_ERR_NONE;
+    int opt = SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+    if (s_user_params.tstamp_mode == TSTAMP_HARDWARE) {
+        rc = hw_timestamping_enable(reinterpret_cast<struct sockaddr *>(&p_data->server_addr),
+                                    p_data->server_addr_len);
+        if (rc) {
+            return rc;
+        }
+        opt |= SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+               SOF_TIMESTAMPING_TX_HARDWARE;
+    } else {
+        opt |= SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+               SOF_TIMESTAMPING_TX_SOFTWARE;
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &opt, sizeof(opt)) < 0) {
+        log_err("setsockopt(SO_TIMESTAMPING) failed. It could be that this option is not "
+                "supported in your system or by the socket type");
+        rc = SOCKPERF_ERR_SOCKET;
+    } else if (!p_data->tstamp.keys) {
+        rc = tstamp_slots_alloc(p_data->tstamp, TSTAMP_TX_SLOTS);
+    }
+    return rc;
+}
+
+/* Allocate <num> slots (power of 2) for pong requests waiting for TX timestamp.
+ */
+int tstamp_slots_alloc(SocketTstampData &tstamp, int num) {
+    size_t keys_size = (sizeof(uint32_t) * num + 63) & ~(size_t)63;
+    uint8_t *block = (uint8_t *)MALLOC(keys_size + sizeof(uint64_t) * num);
+
+    if (!block) {
+        log_err("Failed to allocate memory with malloc()");
+        return SOCKPERF_ERR_NO_MEMORY;
+    }
+
+    tstamp.keys = reinterpret_cast<uint32_t *>(block);
+    tstamp.seqs = reinterpret_cast<uint64_t *>(block + keys_size);
+    tstamp.slot_num = num;
+    tstamp.head = 0;
+    tstamp.tail = 0;
+    tstamp.next_key = 0;
+
+    return SOCKPERF_ERR_NONE;
+}
+
+void tstamp_slots_free(SocketTstampData &tstamp) {
+    if (tstamp.keys) {
+        FREE(tstamp.keys);
+        tstamp.keys = nullptr;
+    }
+    tstamp.seqs = nullptr;
+    tstamp.slot_num = 0;
+}
+
+/* Drain TX timestamps from the socket error queue and store them for queued pong requests.
+ * Timestamps come in send order, so pong requests without a timestamp (the kernel failed
+ * to report it) are dropped and timestamps of other sends are ignored.
+ * It must be called by a single thread (the one that receives replies).
+ * Returns number of pong requests that got TX timestamp.
+ */
+int tstamp_reap(int fd) {
+    SocketTstampData &tstamp = g_fds_array[fd]->tstamp;
+    const int ts_index = (s_user_params.tstamp_mode == TSTAMP_HARDWARE ? 2 : 0);
+    uint8_t control[CMSG_SPACE(sizeof(struct timespec) * 3) +
+                    CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    struct msghdr msg;
+    int saved_errno = errno;
+    int done = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    while (true) {
+        const struct timespec *ts = NULL;
+        const struct sock_extended_err *serr = NULL;
+
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+                ts = reinterpret_cast<const struct timespec *>(CMSG_DATA(cmsg)) + ts_index;
+            } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                       (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                serr = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+            }
+        }
+        if (!ts || !serr || serr->ee_origin != SO_EE_ORIGIN_TIMESTAMPING ||
+            serr->ee_info != SCM_TSTAMP_SND || (!ts->tv_sec && !ts->tv_nsec)) {
+            continue;
+        }
+
+        uint32_t head = tstamp.head;
+        uint32_t tail = __atomic_load_n(&tstamp.tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            uint32_t slot = head & (tstamp.slot_num - 1);
+            int32_t diff = (int32_t)(tstamp.keys[slot] - serr->ee_data);
+            if (diff > 0) {
+                break; // timestamp of a send that is not a pong request
+            }
+            if (diff == 0) {
+                g_pPacketTimes->setKernelTxTime(tstamp.seqs[slot], TicksTime::fromRealtime(*ts));
+                done++;
+            }
+            head++;
+            if (diff == 0) {
+                break;
+            }
+        }
+        __atomic_store_n(&tstamp.head, head, __ATOMIC_RELEASE);
+    }
+    errno = saved_errno;
+
+    return done;
+}
+
+//------------------------------------------------------------------------------
+/* Write every page of the buffer so that page faults are taken now and not during the test */
+void mem_prefault(void *addr, size_t size) {
+    static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    volatile uint8_t *p = (volatile uint8_t *)addr;
+
+    for (size_t offset = 0; offset < size; offset += page_size) {
+        p[offset] = p[offset];
+    }
+    if (size) {
+        p[size - 1] = p[size - 1];
+    }
+}
+
+//------------------------------------------------------------------------------
+void mem_prefault_fds(int fd_min, int fd_max) {
+    for (int ifd = fd_min; ifd <= fd_max; ifd++) {
+        if (!g_fds_array[ifd]) {
+            continue;
+        }
+        SocketRecvData &recv = g_fds_array[ifd]->recv;
+        if (recv.buf) {
+            mem_prefault(recv.buf, 2 * (size_t)recv.max_size); // double size is reserved
+        }
+        // recvmmsg() slots are prefaulted by recvmmsg_thread_slots()
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Anonymous memory for a large array (--mem-prep=hugepages): huge pages of the hugetlbfs pool
+ * when it is configured, otherwise the mapping is advised to use transparent huge pages.
+ * The memory is zeroed, it is released by mem_free_huge() with the same size.
+ */
+void *mem_alloc_huge(size_t size) {
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+    void *addr =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            return NULL;
+        }
+        if (madvise(addr, size, MADV_HUGEPAGE)) {
+            log_dbg("madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+        }
+        errno = 0;
+    }
+    return addr;
+}
+
+//------------------------------------------------------------------------------
+void mem_free_huge(void *addr, size_t size) {
+    if (addr) {
+        munmap(addr, (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1));
+    }
+}
+#endif // __linux__
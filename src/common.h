@@ -61,8 +61,139 @@ int set_affinity_list(os_thread_t thread, const char *cpu_list);
 void hexdump(void *ptr, int buflen);
 const char *handler2str(fd_block_handler_t type);
 int read_int_from_sys_file(const char *path);
+void spin_wait_statistics(const thread_stats_t &total);
+#ifdef __linux__
+int recvmmsg_slots_alloc(SocketRecvData &recv, int num);
+void recvmmsg_slots_free(SocketRecvData &recv);
+struct mmsghdr *recvmmsg_thread_slots(int num, int max_size);
+int zcopy_slots_alloc(SocketZcopyData &zcopy, int num);
+void zcopy_slots_free(SocketZcopyData &zcopy);
+int zcopy_reap(int fd);
+int sock_set_timestamping(int fd, struct fds_data *p_data);
+int tstamp_slots_alloc(SocketTstampData &tstamp, int num);
+void tstamp_slots_free(SocketTstampData &tstamp);
+int tstamp_reap(int fd);
+void mem_prefault(void *addr, size_t size);
+void mem_prefault_fds(int fd_min, int fd_max);
+void *mem_alloc_huge(size_t size);
+void mem_free_huge(void *addr, size_t size);
+#endif // __linux__
 
 // inline functions
+#ifdef __linux__
+//------------------------------------------------------------------------------
+/* Send a message using MSG_ZEROCOPY.
+ * Payload is referenced in place, so it must not change until the send is completed
+ * (true for the client request whose payload is filled once). Message header is
+ * copied into a slot of the socket that is reused after the kernel released it.
+ * Return values are the same as for msg_sendto().
+ */
+static inline int msg_sendto_zcopy(int fd, uint8_t *buf, int nbytes,
+                                   const struct sockaddr *sendto_addr, socklen_t addrlen) {
+    SocketZcopyData &zcopy = g_fds_array[fd]->zcopy;
+    uint32_t &hdr_end = zcopy.hdr_end[zcopy.slot_next];
+    uint8_t *hdr = zcopy.hdrs + zcopy.slot_next * MsgHeader::EFFECTIVE_SIZE;
+    int hdr_size = _min(nbytes, (int)MsgHeader::EFFECTIVE_SIZE);
+    int flags = MSG_NOSIGNAL | MSG_ZEROCOPY;
+    int size = nbytes;
+    int ret = 0;
+
+    if (g_pApp->m_const_params.is_nonblocked_send) {
+        flags |= MSG_DONTWAIT;
+    }
+    if (g_fds_array[fd]->sock_type == SOCK_STREAM) {
+        sendto_addr = NULL;
+        addrlen = 0;
+    }
+
+    /* wait until previous sends that used this header slot are completed */
+    if (unlikely((int32_t)(hdr_end - __atomic_load_n(&zcopy.done_num, __ATOMIC_ACQUIRE)) > 0)) {
+        ++thread_stats().zcopyWaitCount;
+        do {
+            if (!zcopy_reap(fd)) {
+                /* sleep until a notification is queued (POLLERR), the timeout covers reaping
+                 * by the receiver thread; closed connection fails the send below */
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = 0;
+                pfd.revents = 0;
+                if (poll(&pfd, 1, ZCOPY_POLL_MSEC) > 0 && (pfd.revents & (POLLHUP | POLLNVAL))) {
+                    break;
+                }
+            }
+        } while ((int32_t)(hdr_end - __atomic_load_n(&zcopy.done_num, __ATOMIC_ACQUIRE)) > 0 &&
+                 !g_b_exit);
+        if (unlikely(g_b_exit)) {
+            /* the same as interrupted send */
+            return -1;
+        }
+    }
+    memcpy(hdr, buf, hdr_size);
+
+    struct iovec iov[2];
+    struct msghdr msg;
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = hdr_size;
+    iov[1].iov_base = buf + hdr_size;
+    iov[1].iov_len = nbytes - hdr_size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void *)sendto_addr;
+    msg.msg_namelen = addrlen;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (iov[1].iov_len ? 2 : 1);
+
+    while (nbytes) {
+        ret = sendmsg(fd, &msg, flags);
+
+#if defined(LOG_TRACE_SEND) && (LOG_TRACE_SEND == TRUE)
+        LOG_TRACE("raw", "%s [fd=%d id=%u ret=%d] %s", __FUNCTION__, fd, zcopy.next_id, ret,
+                  strerror(errno));
+#endif /* LOG_TRACE_SEND */
+
+        if (likely(ret > 0)) {
+            hdr_end = ++zcopy.next_id;
+            ++thread_stats().zcopySendCount;
+            nbytes -= ret;
+            /* skip the part that was sent (stream sockets only) */
+            while (nbytes && ret >= (int)msg.msg_iov->iov_len) {
+                ret -= (int)msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            }
+            if (nbytes) {
+                msg.msg_iov->iov_base = (uint8_t *)msg.msg_iov->iov_base + ret;
+                msg.msg_iov->iov_len -= ret;
+            }
+            ret = size;
+        } else if (ret == 0 || errno == EPIPE || os_err_conn_reset()) {
+            errno = 0;
+            ret = RET_SOCKET_SHUTDOWN;
+            break;
+        } else if (ret < 0 && errno == ENOBUFS) {
+            /* pinned pages are charged to the socket option memory limit */
+            errno = 0;
+            zcopy_reap(fd);
+        } else if (ret < 0 && (os_err_eagain() || errno == EWOULDBLOCK)) {
+            errno = 0;
+            if (nbytes < size) continue;
+
+            ret = RET_SOCKET_SKIPPED;
+            break;
+        } else if (ret < 0 && (errno == EINTR)) {
+            errno = 0;
+            break;
+        } else {
+            sendtoError(fd, nbytes, sendto_addr);
+            errno = 0;
+            break;
+        }
+    }
+    zcopy.slot_next = (zcopy.slot_next + 1) % zcopy.slot_num;
+
+    return ret;
+}
+#endif // __linux__
+
 //------------------------------------------------------------------------------
 static inline int msg_sendto(int fd, uint8_t *buf, int nbytes,
                      const struct sockaddr *sendto_addr, socklen_t addrlen) {
@@ -74,6 +205,12 @@ static inline int msg_sendto(int fd, uint8_t *buf, int nbytes,
     hexdump(buf, MsgHeader::EFFECTIVE_SIZE);
 #endif /* LOG_TRACE_SEND */
 
+#ifdef __linux__
+    if (unlikely(g_fds_array[fd]->zcopy.hdrs)) {
+        return msg_sendto_zcopy(fd, buf, nbytes, sendto_addr, addrlen);
+    }
+#endif // __linux__
+
 /*
  * MSG_NOSIGNAL:
  * When writing onto a connection-oriented socket that has been shut down
@@ -161,9 +298,99 @@ static inline int msg_sendto(int fd, uint8_t *buf, int nbytes,
         }
     }
 
+#ifdef __linux__
+    /* follow SOF_TIMESTAMPING_OPT_ID key that the kernel assigns to every send */
+    if (unlikely(g_fds_array[fd]->tstamp.keys) && ret == size) {
+        g_fds_array[fd]->tstamp.next_key += (g_fds_array[fd]->sock_type == SOCK_STREAM ? size : 1);
+    }
+#endif // __linux__
+
     return ret;
 }
 
+#ifdef __linux__
+//------------------------------------------------------------------------------
+/* Queue a pong request for matching with its TX timestamp before it is sent,
+ * since the timestamp can be reaped by receiver thread as soon as the send is done.
+ * The request is not tracked when the queue is full.
+ * Returns true if the request was queued.
+ */
+static inline bool tstamp_tx_push(int fd, uint64_t seqNo, int nbytes) {
+    SocketTstampData &tstamp = g_fds_array[fd]->tstamp;
+    uint32_t tail = tstamp.tail;
+
+    if (tail - __atomic_load_n(&tstamp.head, __ATOMIC_ACQUIRE) < tstamp.slot_num) {
+        uint32_t slot = tail & (tstamp.slot_num - 1);
+        /* key of the send is the one of its last datagram/byte */
+        tstamp.keys[slot] =
+            tstamp.next_key + (g_fds_array[fd]->sock_type == SOCK_STREAM ? nbytes : 1) - 1;
+        tstamp.seqs[slot] = seqNo;
+        __atomic_store_n(&tstamp.tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
+
+/* Remove the last queued pong request that failed to be sent.
+ * Its key was not used by the kernel, so receiver thread could not match or drop it.
+ */
+static inline void tstamp_tx_cancel(int fd) {
+    SocketTstampData &tstamp = g_fds_array[fd]->tstamp;
+    __atomic_store_n(&tstamp.tail, tstamp.tail - 1, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+/* Send a batch of datagrams with a single sendmmsg() call.
+ * Returns number of messages that were sent, RET_SOCKET_SKIPPED in case
+ * nothing was sent because the socket would block or RET_SOCKET_SHUTDOWN.
+ */
+static inline int msg_sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen) {
+    int ret = 0;
+    int flags = MSG_NOSIGNAL;
+    unsigned int sent = 0;
+
+    if (g_pApp->m_const_params.is_nonblocked_send) {
+        flags |= MSG_DONTWAIT;
+    }
+
+    while (sent < vlen) {
+        ret = sendmmsg(fd, msgvec + sent, vlen - sent, flags);
+
+#if defined(LOG_TRACE_SEND) && (LOG_TRACE_SEND == TRUE)
+        LOG_TRACE("raw", "%s [fd=%d vlen=%u ret=%d] %s", __FUNCTION__, fd, vlen - sent, ret,
+                  strerror(errno));
+#endif /* LOG_TRACE_SEND */
+
+        if (likely(ret > 0)) {
+            sent += ret;
+        } else if (ret == 0 || errno == EPIPE || os_err_conn_reset()) {
+            errno = 0;
+            ret = RET_SOCKET_SHUTDOWN;
+            break;
+        } else if (ret < 0 && (os_err_eagain() || errno == EWOULDBLOCK)) {
+            /* the rest of the batch is skipped */
+            errno = 0;
+            ret = RET_SOCKET_SKIPPED;
+            break;
+        } else if (ret < 0 && (errno == EINTR)) {
+            errno = 0;
+            break;
+        } else {
+            const struct msghdr &hdr = msgvec[sent].msg_hdr;
+            int nbytes = 0;
+            for (size_t i = 0; i < hdr.msg_iovlen; i++) {
+                nbytes += (int)hdr.msg_iov[i].iov_len;
+            }
+            sendtoError(fd, nbytes, (const struct sockaddr *)hdr.msg_name);
+            errno = 0;
+            break;
+        }
+    }
+
+    return (sent ? (int)sent : ret);
+}
+#endif // __linux__
+
 int sock_set_rate_limit(int fd, uint32_t rate_limit);
 
 /** @brief extract port in network byte order from socket address.
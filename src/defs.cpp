@@ -26,6 +26,7 @@
  * OF SUCH DAMAGE.
  */
 
+#include <new>
 #include "defs.h"
 #include "message.h"
 #include "packet.h"
@@ -33,12 +34,50 @@
 /* Global variables */
 bool g_b_exit = false;
 bool g_b_errorOccured = false;
-uint64_t g_receiveCount = 0; // TODO: should be one per server
-uint64_t g_skipCount = 0;    // TODO: should be one per server
 
-unsigned long long g_cycle_wait_loop_counter = 0;
 TicksTime g_cycleStartTime;
 
+thread_local thread_stats_t *g_pThreadStats = NULL;
+static thread_stats_t s_threadStatsShared; // for threads that failed to get a block
+static std::atomic<thread_stats_t *> s_pThreadStatsList(&s_threadStatsShared);
+
+static_assert(sizeof(thread_stats_t) % CACHE_LINE_SIZE == 0,
+              "thread statistics must fill whole cache lines");
+
+//------------------------------------------------------------------------------
+/* Blocks outlive their threads so that the totals can be printed at exit */
+thread_stats_t *thread_stats_attach() {
+    char *buf = (char *)MALLOC(sizeof(thread_stats_t) + CACHE_LINE_SIZE);
+    if (!buf) {
+        log_err("Failed to allocate memory for thread statistics");
+        return &s_threadStatsShared;
+    }
+    thread_stats_t *stats =
+        new (buf + CACHE_LINE_SIZE - (uintptr_t)buf % CACHE_LINE_SIZE) thread_stats_t();
+
+    stats->next = s_pThreadStatsList.load(std::memory_order_relaxed);
+    while (!s_pThreadStatsList.compare_exchange_weak(stats->next, stats, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+    }
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void thread_stats_total(thread_stats_t &_total) {
+    for (thread_stats_t *stats = s_pThreadStatsList.load(std::memory_order_acquire); stats;
+         stats = stats->next) {
+        _total.receiveCount += stats->receiveCount;
+        _total.skipCount += stats->skipCount;
+        _total.cycleWaitLoopCounter += stats->cycleWaitLoopCounter;
+        _total.spinMessages += stats->spinMessages;
+        _total.blockMessages += stats->blockMessages;
+        _total.zcopySendCount += stats->zcopySendCount;
+        _total.zcopyDoneCount += stats->zcopyDoneCount;
+        _total.zcopyCopiedCount += stats->zcopyCopiedCount;
+        _total.zcopyWaitCount += stats->zcopyWaitCount;
+    }
+}
+
 debug_level_t g_debug_level = LOG_LVL_INFO;
 
 #ifdef USING_EXTRA_API
@@ -55,6 +94,7 @@ zeroCopyMap g_zeroCopyData;
 
 uint32_t MPS_MAX = MPS_MAX_UL; // will be overwrite at runtime in case of ping-pong test
 PacketTimes *g_pPacketTimes = NULL;
+IntervalReport *g_pIntervalReport = NULL;
 
 TicksTime g_lastTicks;
 
@@ -56,6 +56,10 @@ typedef unsigned short int sa_family_t;
 
 #ifdef __linux__
 #include <sys/epoll.h>
+#include <linux/net_tstamp.h>
+#ifdef USING_IOURING
+#include <linux/io_uring.h>
+#endif // USING_IOURING
 #endif
 
 #if defined(__FreeBSD__) || defined(__APPLE__)
@@ -83,6 +87,7 @@ typedef unsigned short int sa_family_t;
 #include <netinet/in.h>  /* internet address manipulation */
 #include <netdb.h>       /* getaddrinfo() */
 #include <netinet/tcp.h> /* tcp specific */
+#include <netinet/udp.h> /* udp specific */
 #include <sys/resource.h>
 
 #endif
@@ -101,10 +106,10 @@ typedef unsigned short int sa_family_t;
 #include <sys/types.h> /* sockets*/
 #include <queue>
 #include <map>
+#include <atomic>
 
 #include "ticks.h"
 #include "message.h"
-#include "playback.h"
 #include "ip_address.h"
 
 #if defined(USING_VMA_EXTRA_API) || defined (USING_XLIO_EXTRA_API)
@@ -161,6 +166,7 @@ typedef unsigned short int sa_family_t;
 extern int MAX_PAYLOAD_SIZE;
 extern int max_fds_num;
 #define MAX_TCP_SIZE ((1 << 20) - 1)
+#define MAX_UDP_SIZE 65507 /* maximum payload of IPv4 UDP datagram */
 
 const uint32_t MPS_MAX_UL =
     10 * 1000 * 1000; //  10 M MPS is 4 times the maximum possible under VMA today
@@ -194,6 +200,13 @@ const uint32_t TEST_FIRST_CONNECTION_FIRST_PACKET_TTL_THRESHOLD_MSEC = 50;
 #define MAX_SOCKETXTREME_COMPS 1024 /* maximum size for socketxtreme poll completions array */
 #endif // USING_EXTRA_API
 
+#define MAX_RECVMMSG_NUM 1024 /* maximum number of messages per recvmmsg() call (UIO_MAXIOV) */
+#define ZCOPY_SEND_SLOTS 64   /* maximum number of in-flight MSG_ZEROCOPY sends per socket */
+#define ZCOPY_POLL_MSEC 1     /* longest sleep for a MSG_ZEROCOPY completion */
+#define UDP_GSO_MAX_SEGMENTS 64 /* maximum number of segments per UDP_SEGMENT send (UDP_MAX_SEGMENTS) */
+#define UDP_GRO_MAX_SIZE 65535  /* maximum size of coalesced UDP_GRO buffer */
+#define TSTAMP_TX_SLOTS 1024    /* maximum number of pong requests waiting for TX timestamp per socket */
+
 #ifndef MAX_PATH_LENGTH
 #define MAX_PATH_LENGTH 1024
 #endif
@@ -225,6 +238,15 @@ const uint32_t TEST_FIRST_CONNECTION_FIRST_PACKET_TTL_THRESHOLD_MSEC = 50;
 #define MAX_ARGV_SIZE 256
 #define MAX_DURATION 36000000
 #define MAX_PACKET_NUMBER 100000000
+#define MAX_PACKET_TIMES_WINDOW (1 << 20) /* maximum number of pong requests tracked at once */
+#define MAX_OUTSTANDING 4096          /* maximum requests in flight per connection (--outstanding) */
+#define OUTSTANDING_LOSS_MSEC 100     /* UDP request without reply is lost after it (--outstanding) */
+#define INTERVAL_REPORT_RING_SIZE (1 << 16) /* maximum number of replies waiting for interval report */
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) /* --mem-prep=hugepages rounds mappings up to it */
+#define PACING_GAPS_NUM (1 << 16)       /* size of random gaps table of --pacing */
+#define PACING_MAX_GAPS (1 << 22)       /* maximum size of gaps table (onoff period) */
+#define PACING_DEFAULT_JITTER 50        /* percent of period for uniform pacing */
 #define SOCK_BUFF_DEFAULT_SIZE 0
 #define DEFAULT_SELECT_TIMEOUT_MSEC 10
 #define DEFAULT_DEBUG_LEVEL 0
@@ -232,6 +254,23 @@ const uint32_t TEST_FIRST_CONNECTION_FIRST_PACKET_TTL_THRESHOLD_MSEC = 50;
 #ifndef SO_MAX_PACING_RATE
 #define SO_MAX_PACING_RATE 47
 #endif
+#ifdef __linux__
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_TIMESTAMPING
+#define SO_TIMESTAMPING 37
+#endif
+#endif // __linux__
 /*
 Used by offload libraries to do egress path warm-up of caches.
 It is not in use by kernel. WARNING: it will actually end this packet on the wire.
@@ -290,6 +329,23 @@ enum {
     OPT_HISTOGRAM,                // 46
     OPT_LOAD_XLIO,                // 47
     OPT_TCP_NB_CONN_TIMEOUT_MS,   // 48
+    OPT_SENDMMSG,                 // 49
+    OPT_RECVMMSG,                 // 50
+    OPT_ZCOPY_SEND,               // 51
+    OPT_UDP_GSO,                  // 52
+    OPT_UDP_GRO,                  // 53
+    OPT_TIMESTAMPING,             // 54
+    OPT_EXACT_STATS,              // 55
+    OPT_INTERVAL_REPORT,          // 56
+    OPT_INTENDED_TIME,            // 57
+    OPT_PACING,                   // 58
+    OPT_FULL_LOG_BIN,             // 59
+    OPT_REUSEPORT,                // 60
+    OPT_TCP_REBALANCE,            // 61
+    OPT_MEM_PREP,                 // 62
+    OPT_SPIN_WAIT,                // 63
+    OPT_SLEEP_PACING,             // 64
+    OPT_OUTSTANDING,              // 65
 #if defined(DEFINED_TLS)
     OPT_TLS
 #endif /* DEFINED_TLS */
@@ -494,12 +550,64 @@ inline void __free(void *ptr, const char *func, int line) {
 /* Global variables */
 extern bool g_b_exit;
 extern bool g_b_errorOccured;
-extern uint64_t g_receiveCount;
-extern uint64_t g_skipCount;
 
-extern unsigned long long g_cycle_wait_loop_counter;
 extern TicksTime g_cycleStartTime;
 
+/*
+ * Counter of thread_stats_t. It is written by the owner thread of the block only, so an update
+ * is a relaxed load and store rather than a locked read-modify-write; other threads read it.
+ */
+class stat_counter_t {
+public:
+    constexpr stat_counter_t() : m_value(0) {}
+
+    inline operator uint64_t() const { return m_value.load(std::memory_order_relaxed); }
+    inline uint64_t operator++() { return add(1); }
+    inline uint64_t operator++(int) { return add(1) - 1; }
+    inline uint64_t operator+=(uint64_t num) { return add(num); }
+
+private:
+    inline uint64_t add(uint64_t num) {
+        uint64_t value = m_value.load(std::memory_order_relaxed) + num;
+        m_value.store(value, std::memory_order_relaxed);
+        return value;
+    }
+
+    std::atomic<uint64_t> m_value;
+};
+
+/*
+ * Counters updated on the data path. Every thread owns a block of its own that fills
+ * whole cache lines, so threads never write to a shared line; the blocks are summed
+ * by thread_stats_total() when a report is printed.
+ */
+struct thread_stats_t {
+    stat_counter_t receiveCount;
+    stat_counter_t skipCount;
+    stat_counter_t cycleWaitLoopCounter; // count delta between time takings vs. num of cycles
+    stat_counter_t spinMessages;         // received after spinning found them (--spin-wait)
+    stat_counter_t blockMessages;        // received after a blocking wait (--spin-wait)
+    stat_counter_t zcopySendCount;       // sends done with MSG_ZEROCOPY
+    stat_counter_t zcopyDoneCount;       // sends completed by error queue notifications
+    stat_counter_t zcopyCopiedCount;     // completed sends that the kernel had to copy
+    stat_counter_t zcopyWaitCount;       // sends that waited for a free header slot
+    thread_stats_t *next;                // list of all blocks, never unlinked
+    char pad[2 * CACHE_LINE_SIZE - 9 * sizeof(uint64_t) - sizeof(thread_stats_t *)];
+};
+
+extern thread_local thread_stats_t *g_pThreadStats;
+thread_stats_t *thread_stats_attach();
+// sums all blocks into a new block _total
+void thread_stats_total(thread_stats_t &_total);
+
+// block of the calling thread, allocated on first use
+static inline thread_stats_t &thread_stats() {
+    if (unlikely(!g_pThreadStats)) {
+        g_pThreadStats = thread_stats_attach();
+    }
+    return *g_pThreadStats;
+}
+
 extern debug_level_t g_debug_level;
 
 #ifdef USING_EXTRA_API
@@ -521,6 +629,11 @@ class Message;
 class PacketTimes;
 extern PacketTimes *g_pPacketTimes;
 
+class IntervalReport;
+extern IntervalReport *g_pIntervalReport;
+
+class PlaybackReader;
+
 extern TicksTime g_lastTicks;
 
 typedef struct spike {
@@ -536,7 +649,42 @@ struct SocketRecvData {
     uint8_t *cur_addr = nullptr;    // start of current message (may point outside buf)
     int cur_offset = 0;             // number of available message bytes
     int cur_size = 0;               // maximum number of bytes for the next chunk
+#ifdef __linux__
+    struct mmsghdr *mmsg = nullptr; // recvmmsg() slots of the receiving thread
+    int mmsg_num = 0;               // datagrams per recvmmsg() call (UDP with --recvmmsg only)
+    bool gro = false;               // UDP_GRO is enabled (datagrams can be coalesced)
+#endif // __linux__
+};
+
+#ifdef __linux__
+/* MSG_ZEROCOPY send state (--zcopy-send only).
+ * Message header is copied into a slot because it is updated for every send,
+ * the slot is reused only after the kernel completed all sends referencing it.
+ */
+struct SocketZcopyData {
+    uint8_t *hdrs = nullptr;        // header slots
+    uint32_t *hdr_end = nullptr;    // per slot: notification id following its last send
+    int slot_num = 0;               // number of header slots
+    int slot_next = 0;              // slot of the next send
+    uint32_t next_id = 0;           // notification id of the next send
+    uint32_t done_num = 0;          // number of completed sends (updated atomically)
+};
+
+/* SO_TIMESTAMPING state (--timestamping only).
+ * The kernel reports TX timestamps keyed by SOF_TIMESTAMPING_OPT_ID: a datagram counter for
+ * UDP and the offset of the last byte of the send for TCP. Pong requests are queued with
+ * their key by the sender and matched in order by whoever drains the error queue.
+ */
+struct SocketTstampData {
+    uint32_t *keys = nullptr;       // per slot: TX timestamp key of the pong request
+    uint64_t *seqs = nullptr;       // per slot: sequence number of the pong request
+    uint32_t slot_num = 0;          // number of slots (power of 2)
+    uint32_t head = 0;              // next slot waiting for TX timestamp
+    uint32_t tail = 0;              // next free slot (updated atomically)
+    uint32_t next_key = 0;          // key following the last send
+    TicksTime rx_time;              // kernel RX time of the last received buffer
 };
+#endif // __linux__
 
 // big enough to store sockaddr_in and sockaddr_in6
 struct sockaddr_store_t {
@@ -565,6 +713,10 @@ struct fds_data {
     IPAddress mc_source_ip_addr;    /**< message source ip for multicast packet filtering */
     int memberships_size = 0;
     struct SocketRecvData recv;
+#ifdef __linux__
+    struct SocketZcopyData zcopy;
+    struct SocketTstampData tstamp;
+#endif // __linux__
 #ifdef USING_EXTRA_API // callback-extra-api Only
     Message *p_msg = nullptr;
 #endif // USING_EXTRA_API
@@ -661,6 +813,31 @@ using socketxtreme_rings_comps_map = std::unordered_map<int, struct socketxtreme
 typedef std::queue<int> socketxtreme_comps_queue;
 #endif // USING_EXTRA_API
 
+#ifdef USING_IOURING
+/* Data chunk received by a multishot recvmsg() request of io_uring.
+ * Chunks live in the provided buffer ring and are indexed by buffer id.
+ */
+struct iouring_buff_t {
+    uint8_t *payload;
+    int len;
+    struct sockaddr *name;
+    socklen_t namelen;
+    uint16_t bid;
+    iouring_buff_t *next;
+};
+
+/* All completions reaped for a single socket by one IoUring::waitArrival() call.
+ * res is a number of received bytes, 0 on peer shutdown or -errno.
+ */
+struct iouring_comp_t {
+    int fd;
+    int res;
+    bool cancel; // set by the consumer to stop receiving on the socket
+    iouring_buff_t *buff_lst;
+    iouring_buff_t *buff_last;
+};
+#endif // USING_IOURING
+
 typedef std::unordered_map<struct sockaddr_store_t, clt_session_info_t> seq_num_map;
 typedef std::unordered_map<IPAddress, size_t> addr_to_id;
 
@@ -695,6 +872,16 @@ struct is_xlio_bufftype<_Tp, typename std::enable_if_t<std::is_same<typename _Tp
 extern void *g_xlio_api; // Dummy variable
 #endif // USING_XLIO_EXTRA_API
 
+template<typename _Tp, class Enable = void>
+struct is_iouring_bufftype
+: public std::false_type {};
+
+#ifdef USING_IOURING
+template<typename _Tp>
+struct is_iouring_bufftype<_Tp, typename std::enable_if_t<std::is_same<typename _Tp::buff_type, iouring_buff_t>::value>>
+: public std::true_type {};
+#endif // USING_IOURING
+
 typedef enum {
     MODE_CLIENT = 0,
     MODE_SERVER,
@@ -714,6 +901,9 @@ typedef enum { // must be coordinated with s_fds_handle_desc in common.cpp
     POLL,
 #ifdef __linux__
     EPOLL,
+#ifdef USING_IOURING
+    IOURING,
+#endif // USING_IOURING
 #elif defined(__APPLE__) || defined(__FreeBSD__)
     KQUEUE,
 #endif // defined(__APPLE__) || defined(__FreeBSD__)
@@ -721,6 +911,33 @@ typedef enum { // must be coordinated with s_fds_handle_desc in common.cpp
     SOCKETXTREME,
     FD_HANDLE_MAX } fd_block_handler_t;
 
+typedef enum {
+    TSTAMP_NONE = 0,
+    TSTAMP_SOFTWARE, // kernel timestamps taken by the network stack
+    TSTAMP_HARDWARE  // NIC timestamps (clock of the NIC must be synchronized with system clock)
+} tstamp_mode_t;
+
+typedef enum { // inter-arrival distribution of client sends (--pacing)
+    PACING_FIXED = 0, // every cycle takes cycleDuration
+    PACING_POISSON,   // exponential gaps (Poisson arrivals)
+    PACING_UNIFORM,   // cycleDuration +- jitter
+    PACING_ONOFF      // ON periods at higher rate followed by silent OFF periods
+} pacing_t;
+
+typedef enum { // sockets of multi-threaded server (--reuseport)
+    REUSEPORT_NONE = 0, // threads share the sockets of the feed file
+    REUSEPORT_HASH,     // every thread has its own SO_REUSEPORT socket of every address
+    REUSEPORT_CPU       // the same, a packet goes to the thread of the CPU that received it
+} reuseport_t;
+
+typedef enum { // preparation of measurement memory before the test (--mem-prep), flags
+    MEM_PREP_NONE = 0,
+    MEM_PREP_PREFAULT = 0x1,  // touch every page of socket receive buffers
+    MEM_PREP_HUGEPAGES = 0x2, // back timestamp arrays of PacketTimes with huge pages
+    MEM_PREP_MLOCK = 0x4,     // lock memory of the process with mlockall()
+    MEM_PREP_NUMA = 0x8       // pre-fault buffers of a socket from the pinned thread serving it
+} mem_prep_t;
+
 struct user_params_t {
     work_mode_t mode = MODE_SERVER; // either client or server
     measurement_mode_t measurement = TIME_BASED; // either time or number
@@ -774,16 +991,20 @@ struct user_params_t {
     char sender_affinity[MAX_ARGV_SIZE];
     char receiver_affinity[MAX_ARGV_SIZE];
     FILE *fileFullLog = NULL;                   // client side only
+    int full_log_bin_fd = -1;                   // client side only
     bool full_rtt = false;                      // client side only
     bool giga_size = false;                     // client side only
     bool increase_output_precision = false;     // client side only
     bool b_stream = false;                      // client side only
-    PlaybackVector *pPlaybackVector = NULL;     // client side only
+    PlaybackReader *pPlaybackReader = NULL;     // client side only
     uint32_t ci_significance_level = DEFAULT_CI_SIG_LEVEL;// client side only
     bool b_histogram;                           // client side only
     uint32_t histogram_lower_range = 0;         // client side only
     uint32_t histogram_upper_range = 2000000;   // client side only
     uint32_t histogram_bin_size = 10;           // client side only
+    bool b_exact_stats = false;                 // client side only
+    uint32_t interval_report_msec = 0;          // client side only
+    bool b_intended_time = false;               // client side only
     struct sockaddr_store_t addr;
     socklen_t addr_len = 0;
     int sock_type = SOCK_DGRAM;
@@ -800,6 +1021,23 @@ struct user_params_t {
     bool lls_is_set = false;
     uint32_t dummy_mps = 0;                   // client side only
     TicksDuration dummySendCycleDuration; // client side only
+    bool is_sendmmsg = false;             // client side only
+    bool is_zcopy_send = false;           // client side only
+    bool is_udp_gso = false;              // client side only (throughput mode)
+    int recvmmsg_num = 0;                 // datagrams per recvmmsg() call (0 - use recvfrom())
+    bool is_udp_gro = false;              // server side only
+    tstamp_mode_t tstamp_mode = TSTAMP_NONE; // client side only
+    pacing_t pacing = PACING_FIXED;       // client side only
+    uint32_t pacing_jitter = PACING_DEFAULT_JITTER; // client side only (uniform pacing)
+    uint32_t pacing_on_msec = 0;          // client side only (onoff pacing)
+    uint32_t pacing_off_msec = 0;         // client side only (onoff pacing)
+    bool b_sleep_pacing = false;          // client side only
+    uint32_t pacing_spin_usec = 0;        // client side only (busy wait before deadline)
+    uint32_t outstanding = 0;             // client side only (requests in flight per connection)
+    reuseport_t reuseport = REUSEPORT_NONE; // server side only
+    bool tcp_rebalance = false;           // server side only
+    int mem_prep = MEM_PREP_NONE;         // mem_prep_t flags
+    uint32_t spin_wait_usec = 0;          // spin budget of iomux wait (0 - block right away)
     uint32_t rate_limit = 0;
 #if defined(DEFINED_TLS)
     bool tls = false;
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include "full_log.h"
+
+#include <sys/mman.h>
+
+//------------------------------------------------------------------------------
+FullLogWriter::FullLogWriter(int fd)
+    : m_fd(fd), m_failed(false), m_pMap(NULL), m_offset(0), m_pos(FULL_LOG_MAP_CHUNK) {}
+
+//------------------------------------------------------------------------------
+FullLogWriter::~FullLogWriter() {
+    uint64_t size = m_offset;
+    if (m_pMap) {
+        size += m_pos;
+        munmap(m_pMap, FULL_LOG_MAP_CHUNK);
+    }
+    if (ftruncate(m_fd, (off_t)size)) {
+        log_err("Failed to truncate binary full log");
+    }
+    close(m_fd);
+}
+
+//------------------------------------------------------------------------------
+bool FullLogWriter::writeHeader(const FullLogHeader &header) {
+    if (!mapNextChunk()) {
+        return false;
+    }
+    memcpy(m_pMap, &header, sizeof(header));
+    m_pos = sizeof(header);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/* Extend the file by a chunk and map it instead of the current (full) one */
+bool FullLogWriter::mapNextChunk() {
+    if (m_pMap) {
+        munmap(m_pMap, FULL_LOG_MAP_CHUNK);
+        m_pMap = NULL;
+        m_offset += FULL_LOG_MAP_CHUNK;
+    }
+    if (m_failed) {
+        return false;
+    }
+
+    void *addr = MAP_FAILED;
+    if (!ftruncate(m_fd, (off_t)(m_offset + FULL_LOG_MAP_CHUNK))) {
+        addr = mmap(NULL, FULL_LOG_MAP_CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd,
+                    (off_t)m_offset);
+    }
+    if (addr == MAP_FAILED) {
+        log_err("Failed to extend binary full log, the rest of records are lost");
+        m_failed = true;
+        return false;
+    }
+    m_pMap = (uint8_t *)addr;
+    m_pos = 0;
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#ifndef FULL_LOG_H_
+#define FULL_LOG_H_
+
+#include <stdint.h> // for uint64_t
+#include <string.h>
+#include "defs.h"
+
+/*
+ * Binary full log (--full-log-bin): FullLogHeader followed by one FullLogRecord per pong request
+ * and server, in host byte order. Times are raw ticks; divide by ticks_per_sec for seconds.
+ * tools/fulllog.py converts the file to CSV and prints statistics.
+ */
+#define FULL_LOG_MAGIC "SPFLOG"
+#define FULL_LOG_VERSION 1
+#define FULL_LOG_MAP_CHUNK (64 * 1024 * 1024) /* file is extended and mapped by chunks */
+
+struct FullLogHeader {
+    char magic[8];          // FULL_LOG_MAGIC
+    uint32_t version;       // FULL_LOG_VERSION
+    uint32_t header_size;   // sizeof(FullLogHeader)
+    uint32_t record_size;   // sizeof(FullLogRecord)
+    uint32_t reply_every;
+    int64_t ticks_per_sec;  // rate of tx_time/rx_time
+    uint32_t msg_size;
+    uint32_t mps;           // 0 - max
+    uint32_t server_num;
+    uint32_t full_rtt;      // latency is reported as rtt (1) or rtt/2 (0)
+    uint64_t reserved[2];
+};
+
+struct FullLogRecord {
+    uint64_t seq_no;
+    int64_t tx_time;
+    int64_t rx_time;        // 0 - reply was not received (dropped)
+    uint32_t server_no;
+    uint32_t flags;         // reserved
+};
+
+class FullLogWriter {
+public:
+    FullLogWriter(int fd); // takes ownership of fd
+    ~FullLogWriter();      // truncates file to written size and closes it
+
+    bool writeHeader(const FullLogHeader &header);
+
+    inline void append(const FullLogRecord &record) {
+        if (unlikely(m_pos + sizeof(record) > FULL_LOG_MAP_CHUNK)) {
+            if (!mapNextChunk()) {
+                return;
+            }
+        }
+        memcpy(m_pMap + m_pos, &record, sizeof(record));
+        m_pos += sizeof(record);
+    }
+
+private:
+    bool mapNextChunk();
+
+    int m_fd;
+    bool m_failed;
+    uint8_t *m_pMap; // current chunk
+    uint64_t m_offset; // file offset of current chunk
+    uint64_t m_pos;  // written bytes in current chunk (FULL_LOG_MAP_CHUNK - nothing is mapped)
+};
+
+#endif /* FULL_LOG_H_ */
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "histogram.h"
+
+//------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+    : m_counts((64 - HISTOGRAM_SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF, 0)
+    , m_count(0)
+    , m_min(0)
+    , m_max(0)
+    , m_sum(0)
+    , m_sumSqr(0) {}
+
+//------------------------------------------------------------------------------
+void LatencyHistogram::reset() {
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+    m_sumSqr = 0;
+}
+
+//------------------------------------------------------------------------------
+/* Middle of the values range that is counted by the bucket */
+uint64_t LatencyHistogram::bucketValue(size_t bucket) const {
+    if (bucket < SUB_BUCKET_NUM) {
+        return (uint64_t)bucket;
+    }
+    int shift = (int)(bucket >> (HISTOGRAM_SUB_BUCKET_BITS - 1)) - 1;
+    uint64_t lowest = ((uint64_t)bucket - shift * SUB_BUCKET_HALF) << shift;
+    return lowest + (((uint64_t)1 << shift) >> 1);
+}
+
+//------------------------------------------------------------------------------
+uint64_t LatencyHistogram::valueAtRank(uint64_t rank) const {
+    if (!m_count) return 0;
+    if (rank == 0) return m_min;
+    if (rank >= m_count - 1) return m_max;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size(); i++) {
+        seen += m_counts[i];
+        if (seen > rank) {
+            uint64_t value = bucketValue(i);
+            return value < m_min ? m_min : value > m_max ? m_max : value;
+        }
+    }
+    return m_max;
+}
+
+//------------------------------------------------------------------------------
+uint64_t LatencyHistogram::percentile(double p) const {
+    int64_t index = (int64_t)(0.5 + p * m_count) - 1;
+    return valueAtRank(index < 0 ? 0 : (uint64_t)index);
+}
+
+//------------------------------------------------------------------------------
+uint64_t LatencyHistogram::median() const {
+    if (m_count % 2 == 1) {
+        return valueAtRank(m_count / 2);
+    }
+    return (valueAtRank(m_count / 2 - 1) + valueAtRank(m_count / 2)) / 2;
+}
+
+//------------------------------------------------------------------------------
+/* Absolute deviation from 'center' at position 'rank' of the sorted deviations.
+ * Buckets are merged outwards from 'center' in order of their distance.
+ */
+uint64_t LatencyHistogram::deviationAtRank(uint64_t center, uint64_t rank) const {
+    const size_t num = m_counts.size();
+    size_t right = bucketOf(center);
+    if (right < num - 1 && bucketValue(right) < center) right++;
+    size_t left = right; // buckets [0, left) are on the left side
+    uint64_t seen = 0;
+
+    while (left > 0 || right < num) {
+        uint64_t devLeft = left > 0 ? center - bucketValue(left - 1) : UINT64_MAX;
+        uint64_t devRight = right < num ? bucketValue(right) - center : UINT64_MAX;
+        uint64_t dev;
+        if (devLeft <= devRight) {
+            seen += m_counts[--left];
+            dev = devLeft;
+        } else {
+            seen += m_counts[right++];
+            dev = devRight;
+        }
+        if (seen > rank) return dev;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+double LatencyHistogram::stdDev() const {
+    if (m_count <= 1) return 0;
+
+    double avg = mean();
+    double variance = (m_sumSqr - m_count * avg * avg) / (m_count - 1);
+    return variance > 0 ? sqrt(variance) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Mean Absolute Deviation
+double LatencyHistogram::mad() const {
+    if (m_count <= 1) return 0;
+
+    double avg = mean();
+    double distanceToAvgSummed = 0;
+    for (size_t i = 0; i < m_counts.size(); i++) {
+        if (m_counts[i]) {
+            distanceToAvgSummed += m_counts[i] * fabs((double)bucketValue(i) - avg);
+        }
+    }
+    return distanceToAvgSummed / m_count;
+}
+
+//------------------------------------------------------------------------------
+// Median Absolute Deviation
+double LatencyHistogram::medianad() const {
+    if (m_count <= 1) return 0;
+
+    // see TicksDuration::medianad()
+    double scaleToConsistentEstimatorForStdDev = 1.48260221851;
+    uint64_t center = median();
+    double medianDeviation;
+    if (m_count % 2 == 1) {
+        medianDeviation = (double)deviationAtRank(center, m_count / 2);
+    } else {
+        medianDeviation = ((double)deviationAtRank(center, m_count / 2 - 1) +
+                           (double)deviationAtRank(center, m_count / 2)) / 2;
+    }
+    return medianDeviation * scaleToConsistentEstimatorForStdDev;
+}
+
+//------------------------------------------------------------------------------
+// Semi-Interquartile Range
+double LatencyHistogram::siqr() const {
+    if (m_count <= 1) return 0;
+
+    return ((double)percentile(.75) - (double)percentile(.25)) / 2;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdint.h> // for uint64_t
+#include <stddef.h>
+#include <vector>
+
+/*
+ * LatencyHistogram is a log-linear (HDR-style) histogram of non-negative values (nsec).
+ * Values below 2^HISTOGRAM_SUB_BUCKET_BITS are counted exactly; every following power of two
+ * range is split into 2^(HISTOGRAM_SUB_BUCKET_BITS-1) equal buckets, so a value reported from a
+ * bucket is within 2^-HISTOGRAM_SUB_BUCKET_BITS (~0.1%) of the recorded one.
+ * Recording is O(1) and statistics are O(buckets), independently of the number of samples.
+ * Count, sum, sum of squares, min and max are kept exactly.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 10
+
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void reset();
+
+    inline void record(uint64_t value) {
+        m_counts[bucketOf(value)]++;
+        if (!m_count || value < m_min) m_min = value;
+        if (!m_count || value > m_max) m_max = value;
+        m_count++;
+        m_sum += value;
+        m_sumSqr += (double)value * value;
+    }
+
+    inline uint64_t count() const { return m_count; }
+    inline uint64_t min() const { return m_min; }
+    inline uint64_t max() const { return m_max; }
+    inline uint64_t sum() const { return m_sum; }
+    inline double mean() const { return m_count ? (double)m_sum / m_count : 0; }
+
+    // value of the observation at position 'rank' (0 based) of the sorted observations
+    uint64_t valueAtRank(uint64_t rank) const;
+    // same percentile/rank mapping that is used for sorted arrays: (int)(0.5 + p * size) - 1
+    uint64_t percentile(double p) const;
+
+    // the same estimators as TicksDuration::stdDev/mad/medianad/siqr
+    double stdDev() const;
+    double mad() const;
+    double medianad() const;
+    double siqr() const;
+
+    // bucket iteration, for building presentation histograms
+    inline size_t bucketNum() const { return m_counts.size(); }
+    inline uint64_t bucketCount(size_t bucket) const { return m_counts[bucket]; }
+    uint64_t bucketValue(size_t bucket) const;
+
+private:
+    static const uint64_t SUB_BUCKET_NUM = (uint64_t)1 << HISTOGRAM_SUB_BUCKET_BITS;
+    static const uint64_t SUB_BUCKET_HALF = SUB_BUCKET_NUM >> 1;
+
+    static inline int msb(uint64_t value) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        int n = 0;
+        while (value >>= 1) n++;
+        return n;
+#endif
+    }
+
+    static inline size_t bucketOf(uint64_t value) {
+        if (value < SUB_BUCKET_NUM) {
+            return (size_t)value;
+        }
+        int shift = msb(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+        return (size_t)(((uint64_t)shift << (HISTOGRAM_SUB_BUCKET_BITS - 1)) + (value >> shift));
+    }
+
+    uint64_t median() const;
+    uint64_t deviationAtRank(uint64_t center, uint64_t rank) const;
+
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count;
+    uint64_t m_min;
+    uint64_t m_max;
+    uint64_t m_sum;
+    double m_sumSqr;
+};
+
+#endif /* HISTOGRAM_H_ */
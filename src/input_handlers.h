@@ -119,6 +119,289 @@ public:
     }
 };
 
+#ifdef __linux__
+/**
+ * Reads up to SocketRecvData::mmsg_num datagrams with a single recvmmsg() call
+ * into the slots of the receiving thread and feeds them to the parser one by one.
+ */
+class RecvMmsgInputHandler : public MessageParser<BufferAccumulation> {
+private:
+    SocketRecvData &m_recv_data;
+    struct sockaddr *m_recvfrom_addr;
+    int m_count;
+public:
+    inline RecvMmsgInputHandler(Message *msg, SocketRecvData &recv_data):
+        MessageParser<BufferAccumulation>(msg),
+        m_recv_data(recv_data),
+        m_recvfrom_addr(NULL),
+        m_count(0)
+    {}
+
+    /** Receive pending datagrams from a socket
+     * @param [in] socket descriptor
+     * @param [out] recvfrom_addr address to save peer address into
+     * @param [inout] in - storage size, out - actual address size
+     * @return number of received datagrams or status code
+     */
+    inline int receive_pending_data(int fd, struct sockaddr *recvfrom_addr, socklen_t &size)
+    {
+        int ret = 0;
+
+        if (unlikely(!m_recv_data.mmsg)) {
+            m_recv_data.mmsg = recvmmsg_thread_slots(m_recv_data.mmsg_num, m_recv_data.max_size);
+        }
+        /* MSG_WAITFORONE: block (if socket is blocking) for the first datagram only */
+        ret = recvmmsg(fd, m_recv_data.mmsg, m_recv_data.mmsg_num,
+                       MSG_NOSIGNAL | MSG_WAITFORONE, NULL);
+
+#if defined(LOG_TRACE_RECV) && (LOG_TRACE_RECV == TRUE)
+        LOG_TRACE("raw", "%s [fd=%d vlen=%d ret=%d] %s", __FUNCTION__, fd,
+                  m_recv_data.mmsg_num, ret, strerror(errno));
+#endif /* LOG_TRACE_RECV */
+
+        if (likely(ret > 0)) {
+            m_count = ret;
+            m_recvfrom_addr = recvfrom_addr;
+            size = m_recv_data.mmsg[0].msg_hdr.msg_namelen;
+        } else if (ret == 0 || errno == EPIPE || os_err_conn_reset()) {
+            ret = RET_SOCKET_SHUTDOWN;
+            errno = 0;
+        } else if (ret < 0 && !os_err_eagain() && errno != EINTR) {
+            recvfromError(fd);
+        }
+
+        return ret;
+    }
+
+    template <class Callback>
+    inline bool iterate_over_buffers(Callback &callback)
+    {
+        for (int i = 0; i < m_count; i++) {
+            struct msghdr &hdr = m_recv_data.mmsg[i].msg_hdr;
+
+            /* callback refers to the caller's address storage */
+            std::memcpy(m_recvfrom_addr, hdr.msg_name, hdr.msg_namelen);
+
+#if defined(LOG_TRACE_MSG_IN) && (LOG_TRACE_MSG_IN == TRUE)
+            printf(">   ");
+            hexdump(hdr.msg_iov->iov_base, MsgHeader::EFFECTIVE_SIZE);
+#endif /* LOG_TRACE_MSG_IN */
+
+            bool ok = process_buffer(callback, m_recv_data,
+                                     reinterpret_cast<uint8_t *>(hdr.msg_iov->iov_base),
+                                     static_cast<int>(m_recv_data.mmsg[i].msg_len));
+            if (unlikely(!ok)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline void cleanup()
+    {
+        /* restore address storage size of the used slots */
+        for (int i = 0; i < m_count; i++) {
+            m_recv_data.mmsg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_store_t);
+        }
+        m_count = 0;
+    }
+};
+#endif // __linux__
+
+#ifdef __linux__
+/**
+ * Receives datagrams from UDP_GRO enabled socket. The kernel can coalesce
+ * several datagrams into one buffer, so every segment of gso_size bytes is
+ * fed to the parser separately.
+ */
+class RecvGroInputHandler : public MessageParser<InPlaceAccumulation> {
+private:
+    SocketRecvData &m_recv_data;
+    uint8_t *m_actual_buf;
+    int m_actual_buf_size;
+    int m_segment_size;
+public:
+    inline RecvGroInputHandler(Message *msg, SocketRecvData &recv_data):
+        MessageParser<InPlaceAccumulation>(msg),
+        m_recv_data(recv_data),
+        m_actual_buf(NULL),
+        m_actual_buf_size(0),
+        m_segment_size(0)
+    {}
+
+    /** Receive pending data from a socket
+     * @param [in] socket descriptor
+     * @param [out] recvfrom_addr address to save peer address into
+     * @param [inout] in - storage size, out - actual address size
+     * @return status code
+     */
+    inline int receive_pending_data(int fd, struct sockaddr *recvfrom_addr, socklen_t &size)
+    {
+        int ret = 0;
+        uint8_t *buf = m_recv_data.cur_addr + m_recv_data.cur_offset;
+        struct iovec iov;
+        struct msghdr msg;
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } control;
+
+        iov.iov_base = buf;
+        iov.iov_len = m_recv_data.cur_size;
+        msg.msg_name = recvfrom_addr;
+        msg.msg_namelen = size;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        msg.msg_flags = 0;
+
+        ret = recvmsg(fd, &msg, MSG_NOSIGNAL);
+        m_actual_buf = buf;
+        m_actual_buf_size = ret;
+        m_segment_size = ret;
+
+#if defined(LOG_TRACE_RECV) && (LOG_TRACE_RECV == TRUE)
+        LOG_TRACE("raw", "%s [fd=%d ret=%d] %s", __FUNCTION__, fd, ret, strerror(errno));
+#endif /* LOG_TRACE_RECV */
+
+        if (likely(ret > 0)) {
+            size = msg.msg_namelen;
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    /* buffer holds coalesced datagrams of gso_size bytes (the last can be shorter) */
+                    m_segment_size = *reinterpret_cast<int *>(CMSG_DATA(cmsg));
+                    break;
+                }
+            }
+        } else if (ret == 0 || errno == EPIPE || os_err_conn_reset()) {
+            ret = RET_SOCKET_SHUTDOWN;
+            errno = 0;
+        } else if (ret < 0 && !os_err_eagain() && errno != EINTR) {
+            recvfromError(fd);
+        }
+
+        return ret;
+    }
+
+    template <class Callback>
+    inline bool iterate_over_buffers(Callback &callback)
+    {
+        for (int offset = 0; offset < m_actual_buf_size; offset += m_segment_size) {
+            int len = _min(m_segment_size, m_actual_buf_size - offset);
+
+#if defined(LOG_TRACE_MSG_IN) && (LOG_TRACE_MSG_IN == TRUE)
+            printf(">   ");
+            hexdump(m_actual_buf + offset, MsgHeader::EFFECTIVE_SIZE);
+#endif /* LOG_TRACE_MSG_IN */
+
+            bool ok = process_buffer(callback, m_recv_data, m_actual_buf + offset, len);
+            if (unlikely(!ok)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline void cleanup()
+    {
+    }
+};
+
+/**
+ * Receives like RecvFromInputHandler and keeps kernel RX timestamp of the
+ * received buffer (SCM_TIMESTAMPING) in the socket data.
+ */
+class RecvTstampInputHandler : public MessageParser<InPlaceAccumulation> {
+private:
+    SocketRecvData &m_recv_data;
+    uint8_t *m_actual_buf;
+    int m_actual_buf_size;
+public:
+    inline RecvTstampInputHandler(Message *msg, SocketRecvData &recv_data):
+        MessageParser<InPlaceAccumulation>(msg),
+        m_recv_data(recv_data),
+        m_actual_buf(NULL),
+        m_actual_buf_size(0)
+    {}
+
+    /** Receive pending data from a socket
+     * @param [in] socket descriptor
+     * @param [out] recvfrom_addr address to save peer address into
+     * @param [inout] in - storage size, out - actual address size
+     * @return status code
+     */
+    inline int receive_pending_data(int fd, struct sockaddr *recvfrom_addr, socklen_t &size)
+    {
+        static const int ts_index = (g_pApp->m_const_params.tstamp_mode == TSTAMP_HARDWARE ? 2 : 0);
+        int ret = 0;
+        uint8_t *buf = m_recv_data.cur_addr + m_recv_data.cur_offset;
+        struct iovec iov;
+        struct msghdr msg;
+        union {
+            char buf[CMSG_SPACE(sizeof(struct timespec) * 3)];
+            struct cmsghdr align;
+        } control;
+
+        iov.iov_base = buf;
+        iov.iov_len = m_recv_data.cur_size;
+        msg.msg_name = recvfrom_addr;
+        msg.msg_namelen = size;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        msg.msg_flags = 0;
+
+        ret = recvmsg(fd, &msg, MSG_NOSIGNAL);
+        m_actual_buf = buf;
+        m_actual_buf_size = ret;
+
+#if defined(LOG_TRACE_MSG_IN) && (LOG_TRACE_MSG_IN == TRUE)
+        printf(">   ");
+        hexdump(buf, MsgHeader::EFFECTIVE_SIZE);
+#endif /* LOG_TRACE_MSG_IN */
+
+#if defined(LOG_TRACE_RECV) && (LOG_TRACE_RECV == TRUE)
+        LOG_TRACE("raw", "%s [fd=%d ret=%d] %s", __FUNCTION__, fd, ret, strerror(errno));
+#endif /* LOG_TRACE_RECV */
+
+        if (likely(ret > 0)) {
+            TicksTime &rx_time = g_fds_array[fd]->tstamp.rx_time;
+            size = msg.msg_namelen;
+            rx_time = TicksTime::TICKS0;
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+                    const struct timespec *ts =
+                        reinterpret_cast<const struct timespec *>(CMSG_DATA(cmsg)) + ts_index;
+                    if (ts->tv_sec || ts->tv_nsec) {
+                        rx_time = TicksTime::fromRealtime(*ts);
+                    }
+                    break;
+                }
+            }
+        } else if (ret == 0 || errno == EPIPE || os_err_conn_reset()) {
+            ret = RET_SOCKET_SHUTDOWN;
+            errno = 0;
+        } else if (ret < 0 && !os_err_eagain() && errno != EINTR) {
+            recvfromError(fd);
+        }
+
+        return ret;
+    }
+
+    template <class Callback>
+    inline bool iterate_over_buffers(Callback &callback)
+    {
+        return process_buffer(callback, m_recv_data, m_actual_buf, m_actual_buf_size);
+    }
+
+    inline void cleanup()
+    {
+    }
+};
+#endif // __linux__
+
 template <class InputHandler, class IoType>
 struct input_handler_helper
 {
@@ -127,6 +410,91 @@ struct input_handler_helper
     }
 };
 
+#ifdef USING_IOURING
+/**
+ * Consumes data that io_uring multishot receive has already placed into
+ * provided buffers (see IoUring), so no syscall is made here.
+ */
+class UringInputHandler : public MessageParser<BufferAccumulation> {
+private:
+    SocketRecvData &m_recv_data;
+    iouring_comp_t *m_comp;
+    struct sockaddr *m_recvfrom_addr;
+public:
+    inline UringInputHandler(Message *msg, SocketRecvData &recv_data, iouring_comp_t *comp):
+        MessageParser<BufferAccumulation>(msg),
+        m_recv_data(recv_data),
+        m_comp(comp),
+        m_recvfrom_addr(NULL)
+    {}
+
+    /** Take data received from a socket
+     * @param [in] socket descriptor
+     * @param [out] recvfrom_addr address to save peer address into
+     * @param [inout] in - storage size, out - actual address size
+     * @return status code
+     */
+    inline int receive_pending_data(int fd, struct sockaddr *recvfrom_addr, socklen_t &size)
+    {
+        int ret = 0;
+
+        if (unlikely(!m_comp || m_comp->fd != fd)) {
+            /* completion is already consumed */
+            errno = EAGAIN;
+            return -1;
+        }
+
+        ret = m_comp->res;
+        if (likely(ret > 0)) {
+            m_recvfrom_addr = recvfrom_addr;
+            size = m_comp->buff_lst->namelen;
+        } else if (ret == 0 || ret == -EPIPE || ret == -ECONNRESET) {
+            /* peer has performed an orderly shutdown */
+            ret = RET_SOCKET_SHUTDOWN;
+        } else {
+            errno = -ret;
+            ret = -1;
+            if (!os_err_eagain() && errno != EINTR) {
+                recvfromError(fd);
+            }
+        }
+
+        return ret;
+    }
+
+    template <class Callback>
+    inline bool iterate_over_buffers(Callback &callback)
+    {
+        for (iouring_buff_t *cur = m_comp->buff_lst; cur; cur = cur->next) {
+            /* callback refers to the caller's address storage */
+            if (cur->namelen) {
+                std::memcpy(m_recvfrom_addr, cur->name, cur->namelen);
+            }
+            bool ok = process_buffer(callback, m_recv_data, cur->payload, cur->len);
+            if (unlikely(!ok)) {
+                /* caller closes TCP socket so receive request has to be cancelled */
+                m_comp->cancel = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline void cleanup()
+    {
+    }
+};
+
+template <class IoType>
+struct input_handler_helper<UringInputHandler, IoType>
+{
+    inline static UringInputHandler create_input_handler(
+            Message *msg, SocketRecvData &recv, IoType& ioHandler) {
+        return UringInputHandler(msg, recv, ioHandler.get_last_comp());
+    }
+};
+#endif // USING_IOURING
+
 #ifdef USING_EXTRA_API
 // T is vma_buff_t | xlio_buff_t
 template <class T>
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include "interval_report.h"
+#include "common.h"
+
+// how often the reporter thread drains the ring
+#define INTERVAL_REPORT_POLL_USEC 1000
+
+//------------------------------------------------------------------------------
+IntervalReport::IntervalReport(uint32_t intervalMsec, uint64_t replyEvery, int serverNum)
+    : m_pRing(new Sample[INTERVAL_REPORT_RING_SIZE])
+    , m_head(0)
+    , m_tail(0)
+    , m_skipped(0)
+    , m_stop(false)
+    , m_interval(TicksDuration::TICKS1MSEC * (int64_t)intervalMsec)
+    , m_replyEvery(replyEvery)
+    , m_serverNum(serverNum)
+    , m_maxSeqNo(0)
+    , m_prevMaxSeqNo(0)
+    , m_prevSkipped(0) {
+    os_thread_init(&m_tid);
+}
+
+//------------------------------------------------------------------------------
+IntervalReport::~IntervalReport() {
+    stop();
+    delete[] m_pRing;
+}
+
+//------------------------------------------------------------------------------
+int IntervalReport::start() {
+    m_startTime.setNowNonInline();
+    if (0 != os_thread_exec(&m_tid, reporter_thread, this)) {
+        log_err("Creating thread has failed");
+        return SOCKPERF_ERR_FATAL;
+    }
+    return SOCKPERF_ERR_NONE;
+}
+
+//------------------------------------------------------------------------------
+void IntervalReport::stop() {
+    if (m_tid.tid) {
+        m_stop.store(true, std::memory_order_release);
+        os_thread_join(&m_tid);
+        os_thread_close(&m_tid);
+        m_tid.tid = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+void *IntervalReport::reporter_thread(void *arg) {
+    IntervalReport *_this = (IntervalReport *)arg;
+    _this->run();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void IntervalReport::run() {
+    TicksTime next = m_startTime + m_interval;
+
+    while (!g_b_exit && !m_stop.load(std::memory_order_acquire)) {
+        usleep(INTERVAL_REPORT_POLL_USEC);
+        drain();
+
+        TicksTime now = TicksTime::now();
+        if (now >= next) {
+            print(now);
+            next += m_interval;
+            if (next <= now) { // reporter was stalled for more than an interval
+                next = now + m_interval;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void IntervalReport::drain() {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    uint64_t tail = m_tail.load(std::memory_order_acquire);
+
+    for (; head != tail; head++) {
+        const Sample &sample = m_pRing[head & (INTERVAL_REPORT_RING_SIZE - 1)];
+        m_hist.record(sample.nsec > 0 ? (uint64_t)sample.nsec : 0);
+        if (sample.seqNo > m_maxSeqNo) {
+            m_maxSeqNo = sample.seqNo;
+        }
+    }
+    m_head.store(head, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+/* Loss of an interval is the number of pong requests up to the highest sequence number that
+ * was replied in it, which were not replied in it */
+void IntervalReport::print(const TicksTime &now) {
+    const uint64_t replies = m_hist.count();
+    const uint64_t skipped = m_skipped.load(std::memory_order_relaxed);
+    const uint64_t expected =
+        (m_maxSeqNo / m_replyEvery - m_prevMaxSeqNo / m_replyEvery) * m_serverNum;
+    const uint64_t lost = expected > replies + (skipped - m_prevSkipped)
+                              ? expected - replies - (skipped - m_prevSkipped)
+                              : 0;
+    const double elapsed = (now - m_startTime).toDecimalUsec() / USEC_IN_SEC;
+
+    if (replies) {
+        log_msg("[%9.3lf sec] %s p50=%.3lf p99=%.3lf p99.9=%.3lf max=%.3lf usec; "
+                "replies=%" PRIu64 "; lost=%" PRIu64 "%s",
+                elapsed, round_trip_str[g_pApp->m_const_params.full_rtt],
+                (double)m_hist.percentile(0.50) / 1000, (double)m_hist.percentile(0.99) / 1000,
+                (double)m_hist.percentile(0.999) / 1000, (double)m_hist.max() / 1000, replies,
+                lost, skipped != m_prevSkipped ? " (report skipped some replies)" : "");
+    } else {
+        log_msg("[%9.3lf sec] no replies", elapsed);
+    }
+    fflush(stdout);
+
+    m_hist.reset();
+    if (m_maxSeqNo > m_prevMaxSeqNo) {
+        m_prevMaxSeqNo = m_maxSeqNo;
+    }
+    m_prevSkipped = skipped;
+}
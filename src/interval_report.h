@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2011-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#ifndef INTERVAL_REPORT_H_
+#define INTERVAL_REPORT_H_
+
+#include <stdint.h> // for uint64_t
+#include <atomic>
+#include "defs.h"
+#include "histogram.h"
+#include "ticks.h"
+
+/*
+ * IntervalReport prints latency percentiles and loss of every interval while the test runs.
+ * The receiver hands the latency of every reply to a reporter thread through a single producer
+ * single consumer ring, so it never waits for the reporter; replies that find the ring full are
+ * only counted as skipped.
+ */
+class IntervalReport {
+public:
+    IntervalReport(uint32_t intervalMsec, uint64_t replyEvery, int serverNum);
+    ~IntervalReport();
+
+    int start();
+    void stop();
+
+    // called by the receiver for every valid reply
+    inline void push(uint64_t seqNo, const TicksDuration &latency) {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= INTERVAL_REPORT_RING_SIZE) {
+            m_skipped.store(m_skipped.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            return;
+        }
+        Sample &sample = m_pRing[tail & (INTERVAL_REPORT_RING_SIZE - 1)];
+        sample.seqNo = seqNo;
+        sample.nsec = latency.toNsec();
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+private:
+    struct Sample {
+        uint64_t seqNo;
+        int64_t nsec;
+    };
+
+    static void *reporter_thread(void *arg);
+    void run();
+    void drain();
+    void print(const TicksTime &now);
+
+    Sample *m_pRing;
+    std::atomic<uint64_t> m_head; // consumed by reporter
+    char m_pad[CACHE_LINE_SIZE];
+    std::atomic<uint64_t> m_tail; // produced by receiver
+    std::atomic<uint64_t> m_skipped;
+    char m_pad2[CACHE_LINE_SIZE];
+
+    // reporter thread only
+    os_thread_t m_tid;
+    std::atomic<bool> m_stop;
+    TicksDuration m_interval;
+    uint64_t m_replyEvery;
+    int m_serverNum;
+    LatencyHistogram m_hist;
+    uint64_t m_maxSeqNo;
+    uint64_t m_prevMaxSeqNo;
+    uint64_t m_prevSkipped;
+    TicksTime m_startTime;
+};
+
+#endif /* INTERVAL_REPORT_H_ */
@@ -28,6 +28,10 @@
 
 #include "iohandlers.h"
 
+#ifdef USING_IOURING
+#include <sys/mman.h>
+#endif // USING_IOURING
+
 void print_addresses(const fds_data *data, int &list_count)
 {
     {
@@ -60,7 +64,9 @@ void print_addresses(const fds_data *data, int &list_count)
 //------------------------------------------------------------------------------
 IoHandler::IoHandler(int _fd_min, int _fd_max, int _fd_num, int _look_start, int _look_end)
     : m_fd_min(_fd_min), m_fd_max(_fd_max), m_fd_num(_fd_num), m_look_start(_look_start),
-      m_look_end(_look_end) {}
+      m_look_end(_look_end),
+      m_spinBudget((int64_t)g_pApp->m_const_params.spin_wait_usec * NSEC_IN_USEC),
+      m_wakePhase(WAKE_NONE), m_wakeReceived(0) {}
 
 //------------------------------------------------------------------------------
 IoHandler::~IoHandler() {}
@@ -137,8 +143,9 @@ int IoRecvfromMUX::prepareNetwork() {
 //==============================================================================
 //------------------------------------------------------------------------------
 IoSelect::IoSelect(int _fd_min, int _fd_max, int _fd_num)
-    : IoHandler(_fd_min, _fd_max, _fd_num, _fd_min, _fd_max + 1),
-      mp_timeout_timeval(g_pApp->m_const_params.select_timeout ? &m_timeout_timeval : NULL) {}
+    : IoHandler(_fd_min, _fd_max, _fd_num, 0, 0),
+      mp_timeout_timeval(g_pApp->m_const_params.select_timeout ? &m_timeout_timeval : NULL),
+      m_fd_first(_fd_min), m_nfds(_fd_max + 1) {}
 
 //------------------------------------------------------------------------------
 IoSelect::~IoSelect() {}
@@ -163,12 +170,17 @@ int IoSelect::prepareNetwork() {
 //==============================================================================
 //------------------------------------------------------------------------------
 IoPoll::IoPoll(int _fd_min, int _fd_max, int _fd_num)
-    : IoHandler(_fd_min, _fd_max, _fd_num, 0, _fd_num),
+    : IoHandler(_fd_min, _fd_max, _fd_num, 0, 0),
       m_timeout_msec(g_pApp->m_const_params.select_timeout
                          ? g_pApp->m_const_params.select_timeout->tv_sec * 1000 +
                                g_pApp->m_const_params.select_timeout->tv_usec / 1000
                          : -1) {
     mp_poll_fd_arr = NULL;
+    m_slot_num = 0;
+    mp_ready_fds = NULL;
+    mp_fd_slot = NULL;
+    mp_free_slots = NULL;
+    m_free_num = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -176,6 +188,15 @@ IoPoll::~IoPoll() {
     if (mp_poll_fd_arr) {
         FREE(mp_poll_fd_arr);
     }
+    if (mp_ready_fds) {
+        FREE(mp_ready_fds);
+    }
+    if (mp_fd_slot) {
+        FREE(mp_fd_slot);
+    }
+    if (mp_free_slots) {
+        FREE(mp_free_slots);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -183,7 +204,10 @@ int IoPoll::prepareNetwork() {
     int rc = SOCKPERF_ERR_NONE;
 
     mp_poll_fd_arr = (struct pollfd *)MALLOC(max_fds_num * sizeof(struct pollfd));
-    if (!mp_poll_fd_arr) {
+    mp_ready_fds = (int *)MALLOC(max_fds_num * sizeof(int));
+    mp_fd_slot = (int *)MALLOC(max_fds_num * sizeof(int));
+    mp_free_slots = (int *)MALLOC(max_fds_num * sizeof(int));
+    if (!mp_poll_fd_arr || !mp_ready_fds || !mp_fd_slot || !mp_free_slots) {
         log_err("Failed to allocate memory for poll fd array");
         rc = SOCKPERF_ERR_NO_MEMORY;
     } else {
@@ -195,9 +219,11 @@ int IoPoll::prepareNetwork() {
                 print_addresses(g_fds_array[ifd], list_count);
                 mp_poll_fd_arr[fd_count].fd = ifd;
                 mp_poll_fd_arr[fd_count].events = POLLIN | POLLPRI;
+                mp_fd_slot[ifd] = fd_count;
                 fd_count++;
             }
         }
+        m_slot_num = fd_count;
     }
 
     return rc;
@@ -250,6 +276,199 @@ int IoEpoll::prepareNetwork() {
 
     return rc;
 }
+#ifdef USING_IOURING
+//==============================================================================
+//------------------------------------------------------------------------------
+IoUring::IoUring(int _fd_min, int _fd_max, int _fd_num)
+    : IoHandler(_fd_min, _fd_max, _fd_num, 0, 0), m_ring_fd(-1), mp_timeout_arg(NULL),
+      mp_sq_ring(MAP_FAILED), m_sq_ring_size(0), m_sq_tail(0), m_to_submit(0),
+      mp_sqes((struct io_uring_sqe *)MAP_FAILED), m_sqes_size(0), mp_cq_ring(MAP_FAILED),
+      m_cq_ring_size(0), mp_buf_ring((struct io_uring_buf_ring *)MAP_FAILED),
+      mp_buf_entries(NULL), m_buf_ring_size(0), mp_bufs(NULL), m_buf_size(0), m_buf_tail(0),
+      mp_buffs(NULL), mp_fd_state(NULL), mp_comps(NULL), m_curr_comp(NULL), mp_postponed(NULL), m_postponed_num(0) {
+    memset(&m_timeout, 0, sizeof(m_timeout));
+    memset(&m_timeout_arg, 0, sizeof(m_timeout_arg));
+    memset(&m_msghdr, 0, sizeof(m_msghdr));
+    if (g_pApp->m_const_params.select_timeout) {
+        m_timeout.tv_sec = g_pApp->m_const_params.select_timeout->tv_sec;
+        m_timeout.tv_nsec = g_pApp->m_const_params.select_timeout->tv_usec * 1000;
+        m_timeout_arg.ts = (uint64_t)(uintptr_t)&m_timeout;
+        mp_timeout_arg = &m_timeout_arg;
+    }
+}
+
+//------------------------------------------------------------------------------
+IoUring::~IoUring() {
+    if (m_ring_fd >= 0) {
+        close(m_ring_fd);
+    }
+    if (mp_buf_ring != MAP_FAILED) {
+        munmap(mp_buf_ring, m_buf_ring_size);
+    }
+    if (mp_sqes != MAP_FAILED) {
+        munmap(mp_sqes, m_sqes_size);
+    }
+    if (mp_cq_ring != MAP_FAILED && mp_cq_ring != mp_sq_ring) {
+        munmap(mp_cq_ring, m_cq_ring_size);
+    }
+    if (mp_sq_ring != MAP_FAILED) {
+        munmap(mp_sq_ring, m_sq_ring_size);
+    }
+    if (mp_bufs) {
+        FREE(mp_bufs);
+    }
+    if (mp_buffs) {
+        FREE(mp_buffs);
+    }
+    if (mp_fd_state) {
+        FREE(mp_fd_state);
+    }
+    if (mp_comps) {
+        FREE(mp_comps);
+    }
+    if (mp_postponed) {
+        FREE(mp_postponed);
+    }
+}
+
+//------------------------------------------------------------------------------
+void IoUring::sqe_error(int fd) {
+    log_err("[fd=%d] io_uring submission queue is full and can't be flushed", fd);
+    exit_with_log(SOCKPERF_ERR_FATAL);
+}
+
+//------------------------------------------------------------------------------
+int IoUring::prepareNetwork() {
+    int rc = SOCKPERF_ERR_NONE;
+    int list_count = 0;
+    struct io_uring_params params;
+    struct io_uring_buf_reg buf_reg;
+
+    mp_fd_state = (fd_state *)MALLOC(max_fds_num * sizeof(fd_state));
+    mp_comps = (iouring_comp_t *)MALLOC(max_fds_num * sizeof(iouring_comp_t));
+    mp_postponed = (fd_status *)MALLOC(max_fds_num * sizeof(fd_status));
+    mp_buffs = (iouring_buff_t *)MALLOC(IOURING_BUF_NUM * sizeof(iouring_buff_t));
+    m_buf_size = (sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_store_t) +
+                  Message::getMaxSize() + 63) & ~63U;
+    mp_bufs = (uint8_t *)MALLOC((size_t)IOURING_BUF_NUM * m_buf_size);
+    if (!mp_fd_state || !mp_comps || !mp_postponed || !mp_buffs || !mp_bufs) {
+        log_err("Failed to allocate memory for io_uring");
+        return SOCKPERF_ERR_NO_MEMORY;
+    }
+    for (int i = 0; i < max_fds_num; i++) {
+        mp_fd_state[i].gen = 0;
+        mp_fd_state[i].armed = false;
+        mp_fd_state[i].comp = -1;
+    }
+
+    /* setup rings */
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = 4 * IOURING_BUF_NUM;
+    m_ring_fd = (int)syscall(__NR_io_uring_setup, IOURING_SQ_ENTRIES, &params);
+    if (m_ring_fd < 0) {
+        log_err("io_uring_setup() failed");
+        return SOCKPERF_ERR_FATAL;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        /* no way to pass timeout so wait infinitely */
+        mp_timeout_arg = NULL;
+    }
+
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_sq_ring_size = m_cq_ring_size = _max(m_sq_ring_size, m_cq_ring_size);
+    }
+    mp_sq_ring = mmap(NULL, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      m_ring_fd, IORING_OFF_SQ_RING);
+    if (mp_sq_ring == MAP_FAILED) {
+        log_err("Failed to map io_uring submission queue");
+        return SOCKPERF_ERR_FATAL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        mp_cq_ring = mp_sq_ring;
+    } else {
+        mp_cq_ring = mmap(NULL, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          m_ring_fd, IORING_OFF_CQ_RING);
+        if (mp_cq_ring == MAP_FAILED) {
+            log_err("Failed to map io_uring completion queue");
+            return SOCKPERF_ERR_FATAL;
+        }
+    }
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    mp_sqes = (struct io_uring_sqe *)mmap(NULL, m_sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (mp_sqes == MAP_FAILED) {
+        log_err("Failed to map io_uring submission entries");
+        return SOCKPERF_ERR_FATAL;
+    }
+
+    uint8_t *sq_ring = (uint8_t *)mp_sq_ring;
+    uint8_t *cq_ring = (uint8_t *)mp_cq_ring;
+    unsigned *sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+
+    mp_sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+    mp_sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    m_sq_mask = *(unsigned *)(sq_ring + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sq_tail = *mp_sq_tail;
+    for (unsigned i = 0; i < m_sq_entries; i++) {
+        sq_array[i] = i;
+    }
+    mp_cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    mp_cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    m_cq_mask = *(unsigned *)(cq_ring + params.cq_off.ring_mask);
+    mp_cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+
+    /* setup provided buffer ring */
+    m_buf_ring_size = IOURING_BUF_NUM * sizeof(struct io_uring_buf);
+    mp_buf_ring = (struct io_uring_buf_ring *)mmap(NULL, m_buf_ring_size, PROT_READ | PROT_WRITE,
+                                                   MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (mp_buf_ring == MAP_FAILED) {
+        log_err("Failed to allocate io_uring buffer ring");
+        return SOCKPERF_ERR_NO_MEMORY;
+    }
+    mp_buf_entries = (struct io_uring_buf *)mp_buf_ring;
+    memset(&buf_reg, 0, sizeof(buf_reg));
+    buf_reg.ring_addr = (uint64_t)(uintptr_t)mp_buf_ring;
+    buf_reg.ring_entries = IOURING_BUF_NUM;
+    buf_reg.bgid = IOURING_BUF_GROUP;
+    if (syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PBUF_RING, &buf_reg, 1) < 0) {
+        log_err("Failed to register io_uring buffer ring");
+        return SOCKPERF_ERR_FATAL;
+    }
+    m_buf_tail = 0;
+    for (int i = 0; i < IOURING_BUF_NUM; i++) {
+        mp_buffs[i].bid = (uint16_t)i;
+        recycle_buff(&mp_buffs[i]);
+    }
+    publish_buffs();
+
+    /* peer address is stored in front of the payload */
+    m_msghdr.msg_namelen = sizeof(struct sockaddr_store_t);
+
+    printf("\n");
+    for (int ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
+        if (g_fds_array[ifd]) {
+            print_addresses(g_fds_array[ifd], list_count);
+            if (g_fds_array[ifd]->sock_type == SOCK_STREAM &&
+                g_pApp->m_const_params.mode != MODE_CLIENT) {
+                arm_poll(ifd);
+            } else {
+                arm_recv(ifd);
+            }
+        }
+    }
+    if (enter(m_to_submit, 0, 0) < 0) {
+        log_err("io_uring_enter() failed");
+        rc = SOCKPERF_ERR_FATAL;
+    }
+    m_to_submit = 0;
+
+    return rc;
+}
+#endif // USING_IOURING
 #endif // !defined(__FreeBSD__) && !defined(__APPLE__)
 #if defined(__FreeBSD__) || defined(__APPLE__)
 //==============================================================================
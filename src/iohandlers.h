@@ -35,6 +35,12 @@
 void print_addresses(const fds_data *data, int &list_count);
 
 //==============================================================================
+/*
+ * waitArrival() returns number of ready entries, then every entry of
+ * [get_look_start(), get_look_end()) is passed to analyzeArrival() that returns its fd
+ * (0 if the entry is not ready). Multiplexers keep a list of ready fds, so this range
+ * covers ready entries only and dispatch does not depend on the number of idle sockets.
+ */
 class IoHandler {
 public:
     IoHandler(int _fd_min, int _fd_max, int _fd_num, int _look_start, int _look_end);
@@ -49,8 +55,49 @@ public:
     const int m_fd_min, m_fd_max, m_fd_num;
 
 protected:
+    //------------------------------------------------------------------------------
+    /* Hybrid wait (--spin-wait): _wait(true) checks the multiplexer without blocking until
+     * something is ready or the spin budget is spent, then _wait(false) does the usual
+     * blocking wait. Messages received after a wakeup (a recvmmsg() batch counts each of its
+     * messages) are counted by the phase that found the ready sockets.
+     */
+    template <typename Wait> inline int spinThenBlock(Wait _wait) {
+        if (likely(m_spinBudget == TicksDuration::TICKS0)) {
+            return _wait(false);
+        }
+        thread_stats_t &stats = thread_stats();
+        uint64_t received = stats.receiveCount;
+        if (m_wakePhase == WAKE_SPIN) {
+            stats.spinMessages += received - m_wakeReceived;
+        } else if (m_wakePhase == WAKE_BLOCK) {
+            stats.blockMessages += received - m_wakeReceived;
+        }
+        m_wakePhase = WAKE_NONE;
+        m_wakeReceived = received;
+
+        const TicksTime spinEnd = TicksTime::now() + m_spinBudget;
+        int rc = 0;
+        do {
+            rc = _wait(true);
+            if (rc) {
+                if (rc > 0) {
+                    m_wakePhase = WAKE_SPIN;
+                }
+                return rc;
+            }
+        } while (!g_b_exit && TicksTime::now() < spinEnd);
+        rc = _wait(false);
+        if (rc > 0) {
+            m_wakePhase = WAKE_BLOCK;
+        }
+        return rc;
+    }
+
     int m_look_start;
     int m_look_end; // non const because of epoll
+    const TicksDuration m_spinBudget;
+    enum { WAKE_NONE, WAKE_SPIN, WAKE_BLOCK } m_wakePhase; // phase of the last wakeup
+    uint64_t m_wakeReceived; // receiveCount of the thread before the last wakeup
 };
 
 //==============================================================================
@@ -59,7 +106,8 @@ public:
     IoRecvfrom(int _fd_min, int _fd_max, int _fd_num);
     virtual ~IoRecvfrom();
 
-    inline void update() {}
+    inline void add_fd(int fd) { (void)fd; }
+    inline void remove_fd(int fd) { (void)fd; }
     inline int waitArrival() { return (m_fd_num); }
     inline int analyzeArrival(int ifd) const {
         assert(g_fds_array[ifd] && "invalid fd");
@@ -97,46 +145,14 @@ public:
     IoRecvfromMUX(int _fd_min, int _fd_max, int _fd_num);
     virtual ~IoRecvfromMUX();
 
-    inline void update() {
-        m_fd_min_all = m_fd_min;
-        m_fd_max_all = m_fd_max;
-        for (int ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        if (active_fd_list[i] != ifd) {
-                            m_fd_min_all = _min(m_fd_min_all, active_fd_list[i]);
-                            m_fd_max_all = _max(m_fd_max_all, active_fd_list[i]);
-
-                            /* it is possible to set the same socket */
-                            errno = 0;
-                        }
-                        active_fd_count--;
-                    }
-                    i++;
-
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
-                }
-            }
-        }
-
-        if (m_look_start > m_fd_max || m_look_start < m_fd_min)
-            m_look_start = m_fd_max;
-        else if (m_look_start == m_fd_max)
-            m_look_start = m_fd_min_all - 1;
+    inline void add_fd(int fd) {
+        m_fd_min_all = _min(m_fd_min_all, fd);
+        m_fd_max_all = _max(m_fd_max_all, fd);
     }
 
+    /* closed socket is skipped by waitArrival() */
+    inline void remove_fd(int fd) { (void)fd; }
+
     inline int waitArrival() {
         do {
             m_look_start++;
@@ -169,67 +185,70 @@ public:
     virtual ~IoSelect();
 
     //------------------------------------------------------------------------------
-    inline void update() {
-        int ifd = 0;
-
-        FD_ZERO(&m_save_fds);
-        m_look_start = m_fd_min;
-        m_look_end = m_fd_max;
-        for (ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                FD_SET(ifd, &m_save_fds);
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        if (active_fd_list[i] != ifd) {
-                            FD_SET(active_fd_list[i], &m_save_fds);
-                            m_look_start = _min(m_look_start, active_fd_list[i]);
-                            m_look_end = _max(m_look_end, active_fd_list[i]);
-
-                            /* it is possible to set the same socket */
-                            errno = 0;
-                        }
-                        active_fd_count--;
-                    }
-                    i++;
-
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
-                }
-            }
-        }
-        m_look_end++;
+    inline void add_fd(int fd) {
+        FD_SET(fd, &m_save_fds);
+        m_fd_first = _min(m_fd_first, fd);
+        m_nfds = _max(m_nfds, fd + 1);
     }
 
+    //------------------------------------------------------------------------------
+    inline void remove_fd(int fd) { FD_CLR(fd, &m_save_fds); }
+
     //------------------------------------------------------------------------------
     inline int waitArrival() {
-        if (mp_timeout_timeval) {
-            memcpy(mp_timeout_timeval, g_pApp->m_const_params.select_timeout,
-                   sizeof(struct timeval));
-        }
-        memcpy(&m_readfds, &m_save_fds, sizeof(fd_set));
-        return select(m_look_end, &m_readfds, NULL, NULL, mp_timeout_timeval);
+        int rc = spinThenBlock([this](bool _poll) {
+            struct timeval *timeout = mp_timeout_timeval;
+            if (_poll) {
+                timeout = &m_timeout_timeval;
+                timeout->tv_sec = timeout->tv_usec = 0;
+            } else if (mp_timeout_timeval) {
+                memcpy(mp_timeout_timeval, g_pApp->m_const_params.select_timeout,
+                       sizeof(struct timeval));
+            }
+            memcpy(&m_readfds, &m_save_fds, sizeof(fd_set));
+            return select(m_nfds, &m_readfds, NULL, NULL, timeout);
+        });
+        m_look_end = (rc > 0 ? collect_ready(rc) : 0);
+        return rc;
     }
 
     //------------------------------------------------------------------------------
-    inline int analyzeArrival(int ifd) const { return FD_ISSET(ifd, &m_readfds) ? ifd : 0; }
+    inline int analyzeArrival(int ifd) const { return m_ready_fds[ifd]; }
 
     virtual int prepareNetwork();
 
 private:
+    //------------------------------------------------------------------------------
+    inline int collect_ready(int num) {
+        int count = 0;
+#ifdef __windows__
+        /* winsock fd_set is a list of sockets */
+        for (count = 0; count < num && count < (int)m_readfds.fd_count; count++) {
+            m_ready_fds[count] = (int)m_readfds.fd_array[count];
+        }
+#else
+        /* fd_set is a bit array, skip words without ready fds */
+        static const int word_bits = 8 * sizeof(unsigned long);
+        const unsigned long *words = reinterpret_cast<const unsigned long *>(&m_readfds);
+        const int word_last = (m_nfds - 1) / word_bits;
+
+        for (int w = m_fd_first / word_bits; count < num && w <= word_last; w++) {
+            unsigned long word = words[w];
+            while (word) {
+                m_ready_fds[count++] = w * word_bits + __builtin_ctzl(word);
+                word &= word - 1;
+            }
+        }
+#endif
+        return count;
+    }
+
     struct timeval m_timeout_timeval;
     struct timeval *const mp_timeout_timeval;
     fd_set m_readfds, m_save_fds;
+    int m_fd_first; // lowest registered fd
+    int m_nfds;     // highest registered fd + 1
+    int m_ready_fds[FD_SETSIZE];
 };
 
 #ifndef __windows__
@@ -241,60 +260,54 @@ public:
     virtual ~IoPoll();
 
     //------------------------------------------------------------------------------
-    inline void update() {
-        int ifd = 0;
+    /* slots of closed sockets are reused, poll() ignores negative fd of a free slot */
+    inline void add_fd(int fd) {
+        int slot = (m_free_num ? mp_free_slots[--m_free_num] : m_slot_num++);
 
-        m_look_start = 0;
-        m_look_end = m_fd_num;
-        for (ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        if (active_fd_list[i] != ifd) {
-                            mp_poll_fd_arr[m_look_end].fd = active_fd_list[i];
-                            mp_poll_fd_arr[m_look_end].events = POLLIN | POLLPRI;
-
-                            /* it is possible to set the same socket
-                             * EEXIST error appears in this case but it harmless condition
-                             */
-                            errno = 0;
-
-                            m_look_end++;
-                        }
-                        active_fd_count--;
-                    }
-                    i++;
+        assert((m_slot_num <= max_fds_num) && "exceeded tool limitation (max_fds_num)");
+
+        mp_poll_fd_arr[slot].fd = fd;
+        mp_poll_fd_arr[slot].events = POLLIN | POLLPRI;
+        mp_poll_fd_arr[slot].revents = 0;
+        mp_fd_slot[fd] = slot;
+    }
+
+    //------------------------------------------------------------------------------
+    inline void remove_fd(int fd) {
+        int slot = mp_fd_slot[fd];
 
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
+        mp_poll_fd_arr[slot].fd = -1;
+        mp_poll_fd_arr[slot].revents = 0;
+        mp_free_slots[m_free_num++] = slot;
+    }
+
+    //------------------------------------------------------------------------------
+    inline int waitArrival() {
+        int rc = spinThenBlock([this](bool _poll) {
+            return poll(mp_poll_fd_arr, m_slot_num, _poll ? 0 : m_timeout_msec);
+        });
+        int count = 0;
+
+        /* stop at the last ready slot */
+        for (int slot = 0; count < rc && slot < m_slot_num; slot++) {
+            if (mp_poll_fd_arr[slot].revents) {
+                if (mp_poll_fd_arr[slot].revents & (POLLIN | POLLPRI | POLLERR | POLLHUP)) {
+                    mp_ready_fds[count] = mp_poll_fd_arr[slot].fd;
+                    count++;
+                } else {
+                    rc--;
                 }
             }
         }
+        m_look_end = count;
+        return (rc < 0 ? rc : count);
     }
 
-    //------------------------------------------------------------------------------
-    inline int waitArrival() { return poll(mp_poll_fd_arr, m_look_end, m_timeout_msec); }
-
     //------------------------------------------------------------------------------
     inline int analyzeArrival(int ifd) const {
         assert((ifd < max_fds_num) && "exceeded tool limitation (max_fds_num)");
 
-        if (mp_poll_fd_arr[ifd].revents & POLLIN || mp_poll_fd_arr[ifd].revents & POLLPRI ||
-            mp_poll_fd_arr[ifd].revents & POLLERR || mp_poll_fd_arr[ifd].revents & POLLHUP) {
-            return mp_poll_fd_arr[ifd].fd;
-        } else {
-            return 0;
-        }
+        return mp_ready_fds[ifd];
     }
 
     virtual int prepareNetwork();
@@ -302,6 +315,11 @@ public:
 private:
     const int m_timeout_msec;
     struct pollfd *mp_poll_fd_arr;
+    int m_slot_num;     // used entries of mp_poll_fd_arr
+    int *mp_ready_fds;
+    int *mp_fd_slot;    // index in mp_poll_fd_arr of every socket
+    int *mp_free_slots; // slots of closed sockets
+    int m_free_num;
 };
 
 #if !defined(__FreeBSD__) && !defined(__APPLE__) 
@@ -312,56 +330,31 @@ public:
     virtual ~IoEpoll();
 
     //------------------------------------------------------------------------------
-    inline void update() {
-        int ifd = 0;
+    inline void add_fd(int fd) {
         struct epoll_event ev = { 0, { 0 } };
 
-        m_look_start = 0;
-        m_look_end = m_fd_num;
-        m_max_events = m_fd_num;
-        for (ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        if (active_fd_list[i] != ifd) {
-                            ev.data.fd = active_fd_list[i];
-                            ev.events = EPOLLIN | EPOLLPRI;
-                            epoll_ctl(m_epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
-
-                            /* it is possible to set the same socket
-                             * EEXIST error appears in this case but it harmless condition
-                             */
-                            errno = 0;
-
-                            m_max_events++;
-                        }
-                        active_fd_count--;
-                    }
-                    i++;
+        ev.data.fd = fd;
+        ev.events = EPOLLIN | EPOLLPRI;
+        if (!epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev)) {
+            m_max_events++;
+        }
+        assert(m_max_events < max_fds_num);
+    }
 
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
-                    assert(m_max_events < max_fds_num);
-                }
-            }
+    //------------------------------------------------------------------------------
+    inline void remove_fd(int fd) {
+        struct epoll_event ev = { 0, { 0 } };
+
+        if (!epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, &ev)) {
+            m_max_events--;
         }
-        /* It can be omitted */
-        m_look_end = m_max_events;
     }
 
     //------------------------------------------------------------------------------
     inline int waitArrival() {
-        m_look_end = epoll_wait(m_epfd, mp_epoll_events, m_max_events, m_timeout_msec);
+        m_look_end = spinThenBlock([this](bool _poll) {
+            return epoll_wait(m_epfd, mp_epoll_events, m_max_events, _poll ? 0 : m_timeout_msec);
+        });
         return m_look_end;
     }
     //------------------------------------------------------------------------------
@@ -379,6 +372,399 @@ private:
     int m_epfd;
     int m_max_events;
 };
+#ifdef USING_IOURING
+//==============================================================================
+#define IOURING_SQ_ENTRIES 256 /* submission queue size */
+#define IOURING_BUF_NUM 256    /* number of buffers in the provided buffer ring (power of 2) */
+#define IOURING_BUF_GROUP 0    /* provided buffer group id */
+
+/*
+ * io_uring based iomux:
+ * - every data socket has a single multishot IORING_OP_RECVMSG request armed that
+ *   takes buffers from the ring registered with IORING_REGISTER_PBUF_RING;
+ * - TCP listen sockets are watched by IORING_OP_POLL_ADD and accepted as usual;
+ * - waitArrival() reaps all available completions without a syscall and groups
+ *   them per socket, analyzeArrival() reports every socket once per batch.
+ * Buffers of a batch are returned to the ring by the next waitArrival() call.
+ */
+class IoUring : public IoHandler {
+public:
+    typedef iouring_buff_t buff_type;
+
+    IoUring(int _fd_min, int _fd_max, int _fd_num);
+    virtual ~IoUring();
+
+    //------------------------------------------------------------------------------
+    inline void add_fd(int fd) {
+        if (!mp_fd_state[fd].armed) {
+            arm_recv(fd);
+        }
+    }
+
+    /* receive request of a closed socket is cancelled by its completion (see cancel flag) */
+    inline void remove_fd(int fd) { (void)fd; }
+
+    //------------------------------------------------------------------------------
+    inline int waitArrival() {
+        release_comps();
+
+        while (!m_look_end) {
+            unsigned flags = 0;
+            unsigned wait_nr = 0;
+
+            if (!m_postponed_num &&
+                (*mp_cq_head == __atomic_load_n(mp_cq_tail, __ATOMIC_ACQUIRE))) {
+                flags = IORING_ENTER_GETEVENTS;
+                wait_nr = 1;
+                if (mp_timeout_arg) {
+                    flags |= IORING_ENTER_EXT_ARG;
+                }
+            }
+            if (flags || m_to_submit) {
+                int ret = enter(m_to_submit, wait_nr, flags);
+                if (ret < 0) {
+                    if (errno == ETIME || errno == EINTR) {
+                        errno = 0;
+                        return 0;
+                    }
+                    return ret;
+                }
+                submitted(ret);
+            }
+            reap();
+        }
+        return m_look_end;
+    }
+
+    //------------------------------------------------------------------------------
+    inline int analyzeArrival(int ifd) {
+        assert((ifd < m_look_end) && "exceeded number of reaped completions");
+
+        m_curr_comp = &mp_comps[ifd];
+        return m_curr_comp->fd;
+    }
+
+    virtual int prepareNetwork();
+
+    /* completion is handed over once to avoid double processing */
+    inline iouring_comp_t *get_last_comp() {
+        iouring_comp_t *comp = m_curr_comp;
+        m_curr_comp = NULL;
+        return comp;
+    }
+
+private:
+    enum { IOURING_OP_RECV = 1, IOURING_OP_POLL, IOURING_OP_CANCEL };
+
+    struct fd_state {
+        uint16_t gen; // generation of the last armed request
+        bool armed;
+        int comp;     // index in mp_comps or -1
+    };
+
+    struct fd_status {
+        int fd;
+        int res;
+    };
+
+    /* request can't be queued because the kernel does not consume submissions */
+    void sqe_error(int fd);
+
+    static inline uint64_t make_user_data(int op, uint16_t gen, int fd) {
+        return ((uint64_t)op << 56) | ((uint64_t)gen << 32) | (uint32_t)fd;
+    }
+
+    inline int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return (int)syscall(__NR_io_uring_enter, m_ring_fd, to_submit, min_complete, flags,
+                            (flags & IORING_ENTER_EXT_ARG) ? (void *)mp_timeout_arg : NULL,
+                            (flags & IORING_ENTER_EXT_ARG) ? sizeof(*mp_timeout_arg) : 0);
+    }
+
+    /* kernel may consume only a part of the submitted entries */
+    inline void submitted(int ret) {
+        m_to_submit -= _min((unsigned)ret, m_to_submit);
+    }
+
+    inline bool sq_full() const {
+        return m_sq_tail - __atomic_load_n(mp_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries;
+    }
+
+    //------------------------------------------------------------------------------
+    /* returns NULL if no entry can be freed by flushing the submission queue */
+    inline struct io_uring_sqe *get_sqe() {
+        if (unlikely(sq_full())) {
+            int ret = enter(m_to_submit, 0, 0);
+            if (ret > 0) {
+                submitted(ret);
+            }
+            if (sq_full()) {
+                return NULL;
+            }
+        }
+        struct io_uring_sqe *sqe = &mp_sqes[m_sq_tail & m_sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        m_sq_tail++;
+        m_to_submit++;
+        return sqe;
+    }
+
+    inline void commit_sqe() { __atomic_store_n(mp_sq_tail, m_sq_tail, __ATOMIC_RELEASE); }
+
+    //------------------------------------------------------------------------------
+    inline void arm_recv(int fd) {
+        struct io_uring_sqe *sqe = get_sqe();
+        fd_state &state = mp_fd_state[fd];
+
+        if (unlikely(!sqe)) {
+            sqe_error(fd);
+            return;
+        }
+        state.gen++;
+        state.armed = true;
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)&m_msghdr;
+        sqe->len = 1;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = IOURING_BUF_GROUP;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = make_user_data(IOURING_OP_RECV, state.gen, fd);
+        commit_sqe();
+    }
+
+    inline void arm_poll(int fd) {
+        struct io_uring_sqe *sqe = get_sqe();
+        fd_state &state = mp_fd_state[fd];
+
+        if (unlikely(!sqe)) {
+            sqe_error(fd);
+            return;
+        }
+        state.gen++;
+        state.armed = true;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = make_user_data(IOURING_OP_POLL, state.gen, fd);
+        commit_sqe();
+    }
+
+    inline void cancel_recv(int fd) {
+        fd_state &state = mp_fd_state[fd];
+
+        if (state.armed) {
+            struct io_uring_sqe *sqe = get_sqe();
+
+            if (unlikely(!sqe)) {
+                sqe_error(fd);
+                return;
+            }
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = make_user_data(IOURING_OP_RECV, state.gen, fd);
+            sqe->user_data = make_user_data(IOURING_OP_CANCEL, 0, fd);
+            commit_sqe();
+        }
+        /* completions of the cancelled request become stale */
+        state.gen++;
+        state.armed = false;
+    }
+
+    //------------------------------------------------------------------------------
+    inline void recycle_buff(iouring_buff_t *buff) {
+        struct io_uring_buf *buf = &mp_buf_entries[m_buf_tail & (IOURING_BUF_NUM - 1)];
+
+        buf->addr = (uint64_t)(uintptr_t)(mp_bufs + (size_t)buff->bid * m_buf_size);
+        buf->len = m_buf_size;
+        buf->bid = buff->bid;
+        m_buf_tail++;
+    }
+
+    inline void publish_buffs() { __atomic_store_n(&mp_buf_ring->tail, m_buf_tail, __ATOMIC_RELEASE); }
+
+    /* return buffers of the previous batch to the kernel */
+    inline void release_comps() {
+        for (int i = 0; i < m_look_end; i++) {
+            iouring_comp_t &comp = mp_comps[i];
+
+            for (iouring_buff_t *buff = comp.buff_lst; buff; buff = buff->next) {
+                recycle_buff(buff);
+            }
+            mp_fd_state[comp.fd].comp = -1;
+            if (unlikely(comp.cancel)) {
+                cancel_recv(comp.fd);
+                /* socket number can be reused by accept() in the same batch */
+                if (g_fds_array[comp.fd]) {
+                    arm_recv(comp.fd);
+                }
+            }
+        }
+        publish_buffs();
+        m_curr_comp = NULL;
+        m_look_start = 0;
+        m_look_end = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    inline iouring_comp_t &get_comp(int fd) {
+        fd_state &state = mp_fd_state[fd];
+
+        if (state.comp < 0) {
+            state.comp = m_look_end++;
+            iouring_comp_t &comp = mp_comps[state.comp];
+            comp.fd = fd;
+            comp.res = 0;
+            comp.cancel = false;
+            comp.buff_lst = NULL;
+            comp.buff_last = NULL;
+        }
+        return mp_comps[state.comp];
+    }
+
+    inline void add_buff(int fd, iouring_buff_t *buff) {
+        iouring_comp_t &comp = get_comp(fd);
+
+        buff->next = NULL;
+        if (comp.buff_last) {
+            comp.buff_last->next = buff;
+        } else {
+            comp.buff_lst = buff;
+        }
+        comp.buff_last = buff;
+        comp.res += buff->len;
+    }
+
+    /* shutdown or error is reported separately after all received data */
+    inline void add_status(int fd, int res) {
+        if (mp_fd_state[fd].comp >= 0) {
+            mp_postponed[m_postponed_num].fd = fd;
+            mp_postponed[m_postponed_num].res = res;
+            m_postponed_num++;
+        } else {
+            get_comp(fd).res = res;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    inline iouring_buff_t *parse_buff(uint16_t bid, int res) {
+        iouring_buff_t *buff = &mp_buffs[bid];
+        uint8_t *base = mp_bufs + (size_t)bid * m_buf_size;
+        struct io_uring_recvmsg_out *out = reinterpret_cast<struct io_uring_recvmsg_out *>(base);
+
+        buff->name = reinterpret_cast<struct sockaddr *>(out + 1);
+        buff->namelen = _min(out->namelen, (uint32_t)m_msghdr.msg_namelen);
+        buff->payload = reinterpret_cast<uint8_t *>(out + 1) + m_msghdr.msg_namelen;
+        buff->len = out->payloadlen ? (int)(res - (buff->payload - base)) : 0;
+        return buff;
+    }
+
+    inline void process_cqe(const struct io_uring_cqe *cqe) {
+        int fd = (int)(uint32_t)cqe->user_data;
+        int op = (int)(cqe->user_data >> 56);
+        uint16_t gen = (uint16_t)(cqe->user_data >> 32);
+        bool more = (cqe->flags & IORING_CQE_F_MORE);
+        iouring_buff_t *buff = NULL;
+
+        if (op == IOURING_OP_CANCEL) {
+            return;
+        }
+
+        fd_state &state = mp_fd_state[fd];
+        bool stale = (gen != state.gen);
+
+        if (!more && !stale) {
+            state.armed = false;
+        }
+
+        if (op == IOURING_OP_POLL) {
+            if (!stale && cqe->res > 0) {
+                /* listen socket is ready, poll again after accept() */
+                get_comp(fd).res = 1;
+                arm_poll(fd);
+            }
+            return;
+        }
+
+        if ((cqe->flags & IORING_CQE_F_BUFFER) && cqe->res > 0) {
+            buff = parse_buff(cqe->flags >> IORING_CQE_BUFFER_SHIFT, cqe->res);
+        }
+        if (unlikely(stale)) {
+            if (buff) {
+                recycle_buff(buff);
+            }
+        } else if (likely(buff && buff->len > 0)) {
+            add_buff(fd, buff);
+            if (unlikely(!more)) {
+                /* multishot request was terminated by the kernel (e.g. on CQ overflow) */
+                arm_recv(fd);
+            }
+        } else if (cqe->res == -ENOBUFS) {
+            /* all buffers are in use, they will be returned before the next submission */
+            arm_recv(fd);
+        } else if (cqe->res != -ECANCELED) {
+            if (buff) {
+                recycle_buff(buff);
+            }
+            add_status(fd, (cqe->res < 0 ? cqe->res : 0));
+        }
+    }
+
+    inline void reap() {
+        int postponed_num = m_postponed_num;
+        unsigned head = *mp_cq_head;
+        unsigned tail = __atomic_load_n(mp_cq_tail, __ATOMIC_ACQUIRE);
+
+        m_postponed_num = 0;
+        for (int i = 0; i < postponed_num; i++) {
+            add_status(mp_postponed[i].fd, mp_postponed[i].res);
+        }
+        for (; head != tail; head++) {
+            process_cqe(&mp_cqes[head & m_cq_mask]);
+        }
+        __atomic_store_n(mp_cq_head, head, __ATOMIC_RELEASE);
+        publish_buffs();
+    }
+
+    int m_ring_fd;
+    struct __kernel_timespec m_timeout;
+    struct io_uring_getevents_arg m_timeout_arg;
+    struct io_uring_getevents_arg *mp_timeout_arg;
+
+    void *mp_sq_ring;
+    size_t m_sq_ring_size;
+    unsigned *mp_sq_head;
+    unsigned *mp_sq_tail;
+    unsigned m_sq_mask;
+    unsigned m_sq_entries;
+    unsigned m_sq_tail;
+    unsigned m_to_submit;
+    struct io_uring_sqe *mp_sqes;
+    size_t m_sqes_size;
+
+    void *mp_cq_ring;
+    size_t m_cq_ring_size;
+    unsigned *mp_cq_head;
+    unsigned *mp_cq_tail;
+    unsigned m_cq_mask;
+    struct io_uring_cqe *mp_cqes;
+
+    struct io_uring_buf_ring *mp_buf_ring;
+    /* entries overlay the ring header; bufs[] of the uapi header is not at offset 0 in C++ */
+    struct io_uring_buf *mp_buf_entries;
+    size_t m_buf_ring_size;
+    uint8_t *mp_bufs;
+    unsigned m_buf_size;
+    uint16_t m_buf_tail;
+    iouring_buff_t *mp_buffs;
+
+    struct msghdr m_msghdr;
+    fd_state *mp_fd_state;
+    iouring_comp_t *mp_comps;
+    iouring_comp_t *m_curr_comp;
+    fd_status *mp_postponed;
+    int m_postponed_num;
+};
+#endif // USING_IOURING
 #endif // !defined(__FreeBSD__) && !defined(__APPLE__) 
 #if defined(__FreeBSD__) || defined(__APPLE__) 
 //==============================================================================
@@ -388,52 +774,33 @@ public:
     virtual ~IoKqueue();
 
     //------------------------------------------------------------------------------
-    inline void update() {
-        int ifd = 0;
-        int change_num = 0;
+    inline void add_fd(int fd) {
         int rc = 0;
 
-        m_look_start = 0;
-        m_look_end = m_fd_num;
-        m_max_events = m_fd_num;
-        for (ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        if (active_fd_list[i] != ifd) {
-                            EV_SET(&mp_kqueue_changes[change_num], active_fd_list[i], EVFILT_READ, EV_FLAGS, 0, 0, 0);
-                            change_num++;
-                            m_max_events++;
-                        }
-                        active_fd_count--;
-                    }
-                    i++;
+        EV_SET(&mp_kqueue_changes[0], fd, EVFILT_READ, EV_FLAGS, 0, 0, 0);
+        rc = kevent(m_kqfd, mp_kqueue_changes, 1, NULL, 0, NULL);
+        assert(rc != -1);
+        if (rc != -1) {
+            m_max_events++;
+        }
+        assert(m_max_events < max_fds_num);
+    }
 
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
-                    assert(m_max_events < max_fds_num);
-                }
-            }
+    //------------------------------------------------------------------------------
+    inline void remove_fd(int fd) {
+        EV_SET(&mp_kqueue_changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, 0);
+        if (kevent(m_kqfd, mp_kqueue_changes, 1, NULL, 0, NULL) != -1) {
+            m_max_events--;
         }
-        rc = kevent(m_kqfd, mp_kqueue_changes, change_num, NULL, 0, NULL);
-        assert(rc != -1);
-        /* It can be omitted */
-        m_look_end = m_max_events;
     }
 
     //------------------------------------------------------------------------------
     inline int waitArrival() {
-        m_look_end = kevent(m_kqfd, NULL, 0, mp_kqueue_events, m_max_events, mp_timeout);
+        m_look_end = spinThenBlock([this](bool _poll) {
+            static const struct timespec zero = { 0, 0 };
+            return kevent(m_kqfd, NULL, 0, mp_kqueue_events, m_max_events,
+                          _poll ? &zero : mp_timeout);
+        });
         return m_look_end;
     }
     //------------------------------------------------------------------------------
@@ -488,35 +855,9 @@ public:
     virtual ~IoSocketxtreme();
 
     //------------------------------------------------------------------------------
-    inline void update() {
-        int ifd = 0;
-
-        m_look_start = 0;
-        m_look_end = m_fd_num;
-        for (ifd = m_fd_min; ifd <= m_fd_max; ifd++) {
-            if (g_fds_array[ifd]) {
-                int i = 0;
-                int active_fd_count = g_fds_array[ifd]->active_fd_count;
-                int *active_fd_list = g_fds_array[ifd]->active_fd_list;
-
-                assert(active_fd_list && "corrupted fds_data object");
-
-                while (active_fd_count) {
-                    /* process active sockets in case TCP (listen sockets are set in
-                     * prepareNetwork()) and
-                     * skip active socket in case UDP (it is the same with set in prepareNetwork())
-                     */
-                    if (active_fd_list[i] != (int)INVALID_SOCKET) {
-                        active_fd_count--;
-                    }
-                    i++;
-
-                    assert((i < MAX_ACTIVE_FD_NUM) &&
-                           "maximum number of active connection to the single TCP addr:port");
-                }
-            }
-        }
-    }
+    /* connections are reported by completions of the ring */
+    inline void add_fd(int fd) { (void)fd; }
+    inline void remove_fd(int fd) { (void)fd; }
 
 #ifdef USING_VMA_EXTRA_API // VMA
     template <typename K = T>
@@ -27,37 +27,139 @@
  */
 
 #include <stdexcept>
+#include <new>
 #include "defs.h"
 #include "packet.h"
 
 #include "common.h"
 
-PacketTimes::PacketTimes(uint64_t _maxSequenceNo, uint64_t _replyEvery, uint64_t _numServers)
-    : m_maxSequenceNo(_maxSequenceNo), m_replyEvery(_replyEvery),
+static uint64_t window_size(uint64_t _maxSequenceNo, uint64_t _replyEvery) {
+    // _maxSequenceNo/_replyEvery+1 is _numBlocks rounded up
+    uint64_t numBlocks = _min(_maxSequenceNo / _replyEvery + 1, (uint64_t)MAX_PACKET_TIMES_WINDOW);
+    uint64_t size = 1;
+    while (size < numBlocks) {
+        size <<= 1;
+    }
+    return size;
+}
+
+// array of _num times that starts and ends on a cache line boundary; _buf gets the allocation
+// (NULL if the array is mapped with huge pages)
+static TicksTime *new_aligned_times(uint64_t _num, bool _hugePages, TicksTime *&_buf) {
+    const uint64_t lineTimes = CACHE_LINE_SIZE / sizeof(TicksTime);
+#ifdef __linux__
+    if (_hugePages) {
+        TicksTime *times = (TicksTime *)mem_alloc_huge(_num * sizeof(TicksTime));
+        if (times) {
+            for (uint64_t i = 0; i < _num; i++) {
+                new (&times[i]) TicksTime();
+            }
+            _buf = NULL;
+            return times;
+        }
+        log_msg("Failed to map %" PRIu64 " bytes for timestamps, huge pages are not used",
+                _num * (uint64_t)sizeof(TicksTime));
+    }
+#else
+    (void)_hugePages;
+#endif // __linux__
+    _buf = new TicksTime[_num + 2 * lineTimes];
+    uintptr_t offset = (uintptr_t)_buf % CACHE_LINE_SIZE;
+    return offset ? (TicksTime *)((char *)_buf + CACHE_LINE_SIZE - offset) : _buf;
+}
+
+static void delete_aligned_times(TicksTime *_times, uint64_t _num, TicksTime *_buf) {
+    if (_buf) {
+        delete[] _buf;
+    } else {
+#ifdef __linux__
+        mem_free_huge(_times, _num * sizeof(TicksTime));
+#else
+        (void)_times;
+        (void)_num;
+#endif // __linux__
+    }
+}
+
+PacketTimes::PacketTimes(uint64_t _maxSequenceNo, uint64_t _replyEvery, uint64_t _numServers,
+                         bool _kernelTimes, bool _intendedTimes, bool _streams, bool _hugePages)
+    : m_replyEvery(_replyEvery), m_numServers(_numServers),
       m_blockSize(1 + _numServers) // 1 sent + N replies
       ,
-      m_pTimes(new TicksTime[(_maxSequenceNo / _replyEvery + 1) *
-                             m_blockSize]) //_maxSequenceNo/_replyEvery+1 is _numBlocks rounded up
-      ,
-      m_pInternalUse(&m_pTimes[1]), m_pErrors(new ArrivalErrors[_numServers]) {
+      m_windowSize(window_size(_maxSequenceNo, _replyEvery)), m_windowMask(m_windowSize - 1),
+      m_pTxTimes(new_aligned_times(m_windowSize, _hugePages, m_pTxBuf)),
+      m_pRxTimes(new_aligned_times(m_windowSize * m_numServers, _hugePages, m_pRxBuf)),
+      m_pRetired(new TicksTime[m_blockSize]),
+      m_pKernelTimes(_kernelTimes ? new TicksTime[m_windowSize * m_blockSize] : NULL),
+      m_pIntendedTimes(_intendedTimes ? new TicksTime[m_windowSize] : NULL),
+      m_pStreams(_streams ? new int[m_windowSize] : NULL),
+      m_pNoTimes(new TicksTime[_numServers]), m_pSeqs(new std::atomic<uint64_t>[m_windowSize]),
+      m_lastSeqNo(0), m_consumer(NULL), m_pErrors(new ArrivalErrors[_numServers]) {
+    for (uint64_t i = 0; i < m_windowSize; i++) {
+        m_pSeqs[i].store(0, std::memory_order_relaxed);
+    }
     /*
-        log_msg("m_maxSequenceNo=%lu, m_replyEvery=%lu, m_blockSize=%lu, m_pTimes=%p[%lu],
-    m_pInternalUse=%p, m_pErrors=%p[%lu]"
+        log_msg("m_windowSize=%lu, m_replyEvery=%lu, m_blockSize=%lu, m_pTxTimes=%p[%lu],
+    m_pRxTimes=%p[%lu], m_pErrors=%p[%lu]"
 
-                , m_maxSequenceNo, m_replyEvery, m_blockSize, m_pTimes
-                , (_maxSequenceNo / _replyEvery + 1) * m_blockSize
-                , m_pInternalUse
+                , m_windowSize, m_replyEvery, m_blockSize, m_pTxTimes, m_windowSize
+                , m_pRxTimes, m_windowSize * m_numServers
                 , m_pErrors, _numServers
                 );
     */
 }
 
 PacketTimes::~PacketTimes() {
-    delete[] m_pTimes;
+    delete_aligned_times(m_pTxTimes, m_windowSize, m_pTxBuf);
+    delete_aligned_times(m_pRxTimes, m_windowSize * m_numServers, m_pRxBuf);
+    delete[] m_pRetired;
+    delete[] m_pKernelTimes;
+    delete[] m_pIntendedTimes;
+    delete[] m_pStreams;
+    delete[] m_pNoTimes;
+    delete[] m_pSeqs;
     delete[] m_pErrors;
 }
 
-bool PacketTimes::verifyError(uint64_t _seqNo) {
-    exit_with_err("_seqN > m_maxSequenceNo", SOCKPERF_ERR_FATAL);
-    return false;
+void PacketTimes::retire(uint64_t _slot) {
+    TicksTime *rxTimes = &m_pRxTimes[_slot * m_numServers];
+    TicksTime *kernelTimes = m_pKernelTimes ? &m_pKernelTimes[_slot * m_blockSize] : NULL;
+    TicksTime *intendedTime = m_pIntendedTimes ? &m_pIntendedTimes[_slot] : NULL;
+    int stream = m_pStreams ? m_pStreams[_slot] : -1;
+    uint64_t seqNo = m_pSeqs[_slot].load(std::memory_order_relaxed) & ~SEQ_BUSY;
+    uint64_t expected = seqNo;
+
+    // take the block from the receiver when it does not store a time into it (see storeTime())
+    while (!m_pSeqs[_slot].compare_exchange_weak(expected, 0, std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+        expected = seqNo;
+    }
+
+    if (m_consumer) {
+        m_pRetired[0] = m_pTxTimes[_slot];
+        for (uint64_t i = 0; i < m_numServers; i++) {
+            m_pRetired[1 + i] = rxTimes[i];
+        }
+        m_consumer(seqNo, m_pRetired, kernelTimes, intendedTime, stream);
+    }
+    m_pTxTimes[_slot] = TicksTime::TICKS0;
+    for (uint64_t i = 0; i < m_numServers; i++) {
+        rxTimes[i] = TicksTime::TICKS0;
+    }
+    if (kernelTimes) {
+        for (uint64_t i = 0; i < m_blockSize; i++) {
+            kernelTimes[i] = TicksTime::TICKS0;
+        }
+    }
+}
+
+void PacketTimes::flush() {
+    // the oldest block follows the last used one
+    uint64_t slot = seq2slot(m_lastSeqNo);
+    for (uint64_t i = 0; i < m_windowSize; i++) {
+        slot = (slot + 1) & m_windowMask;
+        if (m_pSeqs[slot].load(std::memory_order_relaxed)) {
+            retire(slot);
+        }
+    }
 }
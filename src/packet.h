@@ -30,44 +30,118 @@
 #define PACKETTIMES_H_
 
 #include <stdint.h> // for uint64_t
+#include <atomic>
 #include "ticks.h"
 #include <stdexcept>
 #include "common.h"
 
+/*
+ * PacketTimes keeps tx/rx times of pong requests in a ring of blocks indexed by sequence
+ * number modulo window, so memory does not depend on test duration.
+ * Tx times are written by the sender thread and rx times by the receiver thread, so they are
+ * kept in separate cache line aligned arrays rather than interleaved in one block.
+ * Block of a sequence number is retired (handed to the consumer) when the ring wraps around
+ * to it, or by flush() at the end of the test. Replies that arrive for already retired
+ * blocks are ignored (the message was accounted as dropped).
+ * The sender may retire a block while the receiver stores a time into it, see storeTime().
+ */
 class PacketTimes {
 public:
-    PacketTimes(uint64_t _maxSequenceNo, uint64_t _replyEvery, uint64_t _numServers);
+    // called for retired block in increasing order of sequence numbers;
+    // _times[0] - tx time, _times[1 + serverNo] - rx time (TICKS0 if not set);
+    // _kernelTimes - the same for kernel times or NULL;
+    // _intendedTime - scheduled send time of the message or NULL;
+    // _stream - playback stream the message was sent to or -1
+    typedef void (*Consumer)(uint64_t _seqNo, const TicksTime *_times,
+                             const TicksTime *_kernelTimes, const TicksTime *_intendedTime,
+                             int _stream);
+
+    PacketTimes(uint64_t _maxSequenceNo, uint64_t _replyEvery, uint64_t _numServers,
+                bool _kernelTimes = false, bool _intendedTimes = false, bool _streams = false,
+                bool _hugePages = false);
     ~PacketTimes();
 
-    bool verifyError(uint64_t _seqNo);
+    void setConsumer(Consumer _consumer) { m_consumer = _consumer; }
+    // retire all blocks that are still in the ring
+    void flush();
 
-    uint64_t seq2index(uint64_t _seqNo) {
-        return ((_seqNo <= m_maxSequenceNo) ? _seqNo / m_replyEvery * m_blockSize
-                                            : verifyError(_seqNo));
-    } // index 0 is not used for real packets
+    uint64_t seq2slot(uint64_t _seqNo) const { return (_seqNo / m_replyEvery) & m_windowMask; }
+    uint64_t seq2index(uint64_t _seqNo) const { return seq2slot(_seqNo) * m_numServers; }
+    // block holds times of this sequence number (it was not retired yet)
+    bool isInWindow(uint64_t _seqNo) const {
+        return (m_pSeqs[seq2slot(_seqNo)].load(std::memory_order_relaxed) & ~SEQ_BUSY) == _seqNo;
+    }
 
-    const TicksTime &getTxTime(uint64_t _seqNo) { return m_pTimes[seq2index(_seqNo)]; }
-    const TicksTime *getRxTimeArray(uint64_t _seqNo) { return &m_pInternalUse[seq2index(_seqNo)]; }
+    const TicksTime &getTxTime(uint64_t _seqNo) {
+        return isInWindow(_seqNo) ? m_pTxTimes[seq2slot(_seqNo)] : TicksTime::TICKS0;
+    }
+    const TicksTime *getRxTimeArray(uint64_t _seqNo) {
+        return isInWindow(_seqNo) ? &m_pRxTimes[seq2index(_seqNo)] : m_pNoTimes;
+    }
 
-    void clearTxTime(uint64_t _seqNo) { m_pTimes[seq2index(_seqNo)] = TicksTime::TICKS0; }
+    void clearTxTime(uint64_t _seqNo) { m_pTxTimes[seq2slot(_seqNo)] = TicksTime::TICKS0; }
     void setTxTime(uint64_t _seqNo) {
-        m_pTimes[seq2index(_seqNo)].setNow();
+        uint64_t slot = seq2slot(_seqNo);
+        uint64_t owner = m_pSeqs[slot].load(std::memory_order_relaxed) & ~SEQ_BUSY;
+        if (owner != _seqNo) {
+            if (owner) {
+                retire(slot);
+            }
+            m_pSeqs[slot].store(_seqNo, std::memory_order_relaxed);
+            m_lastSeqNo = _seqNo;
+        }
+        m_pTxTimes[slot].setNow();
+        if (m_pIntendedTimes) {
+            // start of the current cycle is when the message should have been sent
+            m_pIntendedTimes[slot] = g_cycleStartTime;
+        }
         // log_msg(">>> %lu: tx=%.3lf", _seqNo,
-        // (double)m_pTimes[seq2index(_seqNo)].debugToNsec()/1000/1000 );//TODO: remove
+        // (double)m_pTxTimes[seq2slot(_seqNo)].debugToNsec()/1000/1000 );//TODO: remove
     }
-    void setRxTime(uint64_t _seqNo, uint64_t _serverNo = 0) {
-        setRxTime(_seqNo, TicksTime().setNow(), _serverNo);
+    void setStream(uint64_t _seqNo, int _stream) {
+        if (m_pStreams && isInWindow(_seqNo)) {
+            m_pStreams[seq2slot(_seqNo)] = _stream;
+        }
     }
-    void setRxTime(uint64_t _seqNo, const TicksTime &_time, uint64_t _serverNo = 0) {
-        TicksTime *rxTimes = &m_pInternalUse[seq2index(_seqNo)];
+    // returns true if the reply was stored (it is neither a duplicate nor too late)
+    bool setRxTime(uint64_t _seqNo, uint64_t _serverNo = 0) {
+        return setRxTime(_seqNo, TicksTime().setNow(), _serverNo);
+    }
+    bool setRxTime(uint64_t _seqNo, const TicksTime &_time, uint64_t _serverNo = 0) {
+        if (unlikely(!isInWindow(_seqNo))) {
+            return false; // too late reply, the message is already accounted as dropped
+        }
+        TicksTime *rxTimes = &m_pRxTimes[seq2index(_seqNo)];
         if (rxTimes[_serverNo] == TicksTime::TICKS0) {
-            rxTimes[_serverNo] = _time;
-            ++g_receiveCount;
+            if (unlikely(!storeTime(_seqNo, rxTimes[_serverNo], _time))) {
+                return false;
+            }
+            ++thread_stats().receiveCount;
             // log_msg("<<< %lu: rx=%.3lf", _seqNo, (double)_time.debugToNsec()/1000/1000 );//TODO:
             // remove
+            return true;
         } else if (!g_b_exit) {
             incDupCount(_serverNo); /*log_err("dup-packket at _seqNo=%lu", _seqNo);*/
         }
+        return false;
+    }
+
+    // kernel (SO_TIMESTAMPING) times are kept in blocks of the consumer layout since the
+    // receiver thread sets both of them; they exist only if requested
+    bool hasKernelTimes() const { return m_pKernelTimes != NULL; }
+    void setKernelTxTime(uint64_t _seqNo, const TicksTime &_time) {
+        if (isInWindow(_seqNo)) {
+            storeTime(_seqNo, m_pKernelTimes[seq2slot(_seqNo) * m_blockSize], _time);
+        }
+    }
+    void setKernelRxTime(uint64_t _seqNo, const TicksTime &_time, uint64_t _serverNo = 0) {
+        if (!isInWindow(_seqNo)) {
+            return;
+        }
+        TicksTime &rxTime = m_pKernelTimes[seq2slot(_seqNo) * m_blockSize + 1 + _serverNo];
+        if (rxTime == TicksTime::TICKS0) {
+            storeTime(_seqNo, rxTime, _time);
+        }
     }
 
     void incDupCount(uint64_t serverNo) { m_pErrors[serverNo].duplicates++; }
@@ -78,13 +152,55 @@ public:
     size_t getOooCount(uint64_t serverNo) { return m_pErrors[serverNo].ooo; }
     size_t getDroppedCount(uint64_t serverNo) { return m_pErrors[serverNo].dropped; }
 
-    const uint64_t m_maxSequenceNo;
+    // the last sequence number that got a block (the last pong request that was sent)
+    uint64_t getLastSeqNo() const { return m_lastSeqNo; }
+
     const uint64_t m_replyEvery;
+    const uint64_t m_numServers;
     const uint64_t m_blockSize;
+    const uint64_t m_windowSize; // number of blocks in the ring (power of 2)
+    const uint64_t m_windowMask;
 
 private:
-    TicksTime *const m_pTimes;
-    TicksTime *const m_pInternalUse;
+    void retire(uint64_t _slot);
+
+    // owner of a block is marked busy while a time is stored into it
+    static const uint64_t SEQ_BUSY = (uint64_t)1 << 63;
+
+    /* Receiver side store of a time into the block of _seqNo. The block is claimed by marking
+     * its owner busy, and retire() takes the block only from an owner that is not busy, so either
+     * the time is stored before retire() reads the block or the block is already retired and
+     * the reply is accounted as dropped. Tx times the receiver reads for --interval-report are
+     * not synchronized: the sample is only an estimate.
+     */
+    bool storeTime(uint64_t _seqNo, TicksTime &_dst, const TicksTime &_time) {
+        std::atomic<uint64_t> &owner = m_pSeqs[seq2slot(_seqNo)];
+        uint64_t expected = _seqNo;
+        while (!owner.compare_exchange_weak(expected, _seqNo | SEQ_BUSY, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+            if (unlikely((expected & ~SEQ_BUSY) != _seqNo)) {
+                return false;
+            }
+            expected = _seqNo;
+        }
+        _dst = _time;
+        owner.store(_seqNo, std::memory_order_release);
+        return true;
+    }
+
+    TicksTime *m_pTxBuf; // allocated arrays, m_pTxTimes/m_pRxTimes are aligned inside
+                         // (NULL when mapped with huge pages)
+    TicksTime *m_pRxBuf;
+    TicksTime *const m_pTxTimes; // one per block, written by the sender
+    TicksTime *const m_pRxTimes; // one per server in every block, written by the receiver
+    TicksTime *const m_pRetired; // block in the consumer layout for retire()
+    TicksTime *const m_pKernelTimes;
+    TicksTime *const m_pIntendedTimes; // one per block
+    int *const m_pStreams;             // one per block
+    TicksTime *const m_pNoTimes; // rx times for sequence numbers outside of the window
+    std::atomic<uint64_t> *const m_pSeqs; // sequence number that owns each block (0 - free)
+    uint64_t m_lastSeqNo;
+    Consumer m_consumer;
 
     // prevent creation by compiler
     PacketTimes(const PacketTimes &);
@@ -97,30 +213,6 @@ private:
         ArrivalErrors() : duplicates(0), ooo(0), dropped(0) {}
     };
     ArrivalErrors *const m_pErrors; // array with one line per server
-                                    /*
-//------------------------------------------------------------------------------
-void dumpFullLog(FILE * f)
-{
-if (!f) return;
-
-fprintf(f, "------------------------------\n");
-const uint64_t NUM_SERVERS = m_blockSize -1;
-fprintf(f, "txTime");
-for (uint64_t i = 0; i < NUM_SERVERS; i++) fprintf(f, ", rxTime%d", i);
-fprintf(f, "\n");
-
-//
-
-for (uint64_t i = 0; i <  m_maxSequenceNo; i++) {
-printf("%.9lf", debugToNsec())
-double tx = (double)pFullLog[i][0].debugToNsec()/1000/1000/1000;
-double rx = (double)pFullLog[i][1].debugToNsec()/1000/1000/1000;
-fprintf(f, "%.9lf, %.9lf\n", tx, rx);
-}
-fprintf(f, "------------------------------\n");
-}
-
-*/
 };
 
 #endif /* PACKETTIMES_H_ */
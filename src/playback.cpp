@@ -26,94 +26,596 @@
  * OF SUCH DAMAGE.
  */
 
-#include <string>
-#include <vector>
-#include <fstream>
-#include <iostream>
-#include "defs.h"
 #include "playback.h"
-#include "ticks.h"
 
-// How to build unit test: g++ Playback.cpp Ticks.cpp -lrt -Wall -Dplayback_test=main -o playback
+#include <math.h>
+#include <sys/stat.h>
+#ifndef __windows__
+#include <sys/mman.h>
+#endif
 
-using std::cout;
+// how often the loader thread checks if the sender has released a chunk
+#define PLAYBACK_POLL_USEC 1000
+#define PLAYBACK_LINE_MAX 256
 
-typedef std::vector<std::string> StringVector;
+// link layer types of captures (see pcap-linktype(7))
+enum {
+    LINKTYPE_NULL = 0,
+    LINKTYPE_ETHERNET = 1,
+    LINKTYPE_RAW = 101,
+    LINKTYPE_LINUX_SLL = 113,
+    LINKTYPE_IPV4 = 228,
+    LINKTYPE_IPV6 = 229,
+    LINKTYPE_LINUX_SLL2 = 276
+};
 
-void readFile(StringVector &sv, const char *filename) {
-    std::string line;
-    std::ifstream infile(filename, std::ios_base::in);
-    if (infile.fail()) {
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_IDB 1
+#define PCAPNG_EPB 6
+#define PCAPNG_OPT_TSRESOL 9
+
+static inline uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static inline uint32_t raw32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// network byte order fields of packet headers
+static inline uint16_t be16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static int64_t ts2nsec(uint64_t ts, int tsResol) {
+    if (tsResol & 0x80) { // negative power of 2
+        int shift = _min(tsResol & 0x7f, 63);
+        uint64_t frac = ts & ((UINT64_C(1) << shift) - 1);
+        return (int64_t)((ts >> shift) * NSEC_IN_SEC) +
+               (int64_t)ldexp((double)frac * NSEC_IN_SEC, -shift);
+    }
+    uint64_t scale = 1;
+    for (int i = tsResol; i < 9; i++) {
+        scale *= 10;
+    }
+    for (int i = 9; i < tsResol; i++) {
+        ts /= 10;
+    }
+    return (int64_t)(ts * scale);
+}
+
+//------------------------------------------------------------------------------
+PlaybackReader::PlaybackReader()
+    : m_pItems(NULL), m_count(0), m_pos(0), m_cur(0), m_stalls(0), m_stop(false),
+      m_filename(NULL), m_pData(NULL), m_dataSize(0), m_cursor(NULL), m_end(NULL),
+      m_format(FORMAT_TEXT), m_recordSize(0), m_swap(false), m_eof(false), m_error(false),
+      m_record(0), m_prevNsec(0), m_firstNsec(-1), m_maxItems(0), m_skipped(0), m_linkType(LINKTYPE_ETHERNET),
+      m_nsecPcap(false)
+#ifdef __windows__
+      , m_hFile(INVALID_HANDLE_VALUE), m_hMap(NULL)
+#endif
+{
+    for (int i = 0; i < 2; i++) {
+        m_chunks[i].items = new PlaybackItem[PLAYBACK_CHUNK_ITEMS];
+        m_chunks[i].count = 0;
+        m_chunks[i].ready.store(false, std::memory_order_relaxed);
+        m_chunks[i].last = false;
+    }
+    os_thread_init(&m_tid);
+}
+
+//------------------------------------------------------------------------------
+PlaybackReader::~PlaybackReader() {
+    stop();
+#ifndef __windows__
+    if (m_pData) {
+        munmap((void *)m_pData, m_dataSize);
+    }
+#else
+    if (m_pData) {
+        UnmapViewOfFile(m_pData);
+    }
+    if (m_hMap) {
+        CloseHandle(m_hMap);
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_hFile);
+    }
+#endif
+    delete[] m_chunks[0].items;
+    delete[] m_chunks[1].items;
+}
+
+//------------------------------------------------------------------------------
+int PlaybackReader::open(const char *filename) {
+    m_filename = filename;
+
+#ifndef __windows__
+    int fd = ::open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0) {
+        log_msg("Can't open file: %s\n", filename);
+        return SOCKPERF_ERR_NOT_EXIST;
+    }
+    if (fstat(fd, &st)) {
+        log_msg("Can't get size of file: %s\n", filename);
+        ::close(fd);
+        return SOCKPERF_ERR_NOT_EXIST;
+    }
+    m_dataSize = (uint64_t)st.st_size;
+    if (m_dataSize) {
+        void *addr = mmap(NULL, m_dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            log_err("Can't map file: %s", filename);
+            ::close(fd);
+            return SOCKPERF_ERR_FATAL;
+        }
+        madvise(addr, m_dataSize, MADV_SEQUENTIAL);
+        m_pData = (const uint8_t *)addr;
+    }
+    ::close(fd);
+#else
+    LARGE_INTEGER size;
+    m_hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                          FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_hFile, &size)) {
         log_msg("Can't open file: %s\n", filename);
-        exit(SOCKPERF_ERR_NOT_EXIST);
-    }
-    int i = 0;
-
-    while (infile.good() && getline(infile, line)) {
-        sv.push_back(line);
-        i++;
-    }
-    if (!infile.eof()) {
-        log_msg("file: %s, error in line: #%d\n", filename, i + 1);
-        exit(SOCKPERF_ERR_INCORRECT);
-    }
-}
-
-void parsePlaybackData(PlaybackVector &pv, StringVector &sv) {
-    PlaybackItem pi;
-
-    double curr_time, prev_time = 0;
-    TicksDuration duration;
-
-    for (size_t i = 0; i < sv.size(); i++) {
-        std::string s = sv[i];
-        if (!s.empty() && s[0] != '#') {
-            // printf("[%lu]: %s\n", i+1, s.c_str());
-            if (2 == sscanf(s.c_str(), "%lf, %d", &curr_time, &pi.size)) {
-                if (prev_time > curr_time) {
-                    printf("out-of-order timestamp at line #%lu\n", (long unsigned)i + 1);
-                    exit(SOCKPERF_ERR_INCORRECT);
-                }
-                pi.duration.setFromSeconds(curr_time - prev_time);
-                if (!pi.isValid()) {
-                    printf("illegal time or size at line #%lu\n", (long unsigned)i + 1);
-                    exit(SOCKPERF_ERR_INCORRECT);
-                }
-
-                pv.push_back(pi);
-                prev_time = curr_time;
-            } else {
-                cout << "can't read time & size, at line #" << i + 1 << '\n';
-                exit(1);
+        return SOCKPERF_ERR_NOT_EXIST;
+    }
+    m_dataSize = (uint64_t)size.QuadPart;
+    if (m_dataSize) {
+        m_hMap = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        m_pData = m_hMap ? (const uint8_t *)MapViewOfFile(m_hMap, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!m_pData) {
+            log_err("Can't map file: %s", filename);
+            return SOCKPERF_ERR_FATAL;
+        }
+    }
+#endif
+    m_cursor = m_pData;
+    m_end = m_pData + m_dataSize;
+
+    /* Detect format by the magic at the start of the file */
+    uint32_t magic = m_dataSize >= 4 ? raw32(m_pData) : 0;
+    if (m_dataSize >= sizeof(PlaybackBinHeader) &&
+        !memcmp(m_pData, PLAYBACK_BIN_MAGIC, sizeof(PLAYBACK_BIN_MAGIC))) {
+        PlaybackBinHeader header;
+        memcpy(&header, m_pData, sizeof(header));
+        if (header.version != PLAYBACK_BIN_VERSION || header.header_size < sizeof(header) ||
+            header.header_size > m_dataSize || header.record_size < sizeof(PlaybackBinRecord)) {
+            log_msg("file: %s, unsupported binary playback file\n", filename);
+            return SOCKPERF_ERR_INCORRECT;
+        }
+        m_format = FORMAT_BIN;
+        m_recordSize = header.record_size;
+        m_cursor += header.header_size;
+        m_maxItems = (m_dataSize - header.header_size) / m_recordSize;
+    } else if (m_dataSize >= 24 && (magic == PCAP_MAGIC_USEC || magic == swap32(PCAP_MAGIC_USEC) ||
+                                    magic == PCAP_MAGIC_NSEC || magic == swap32(PCAP_MAGIC_NSEC))) {
+        m_format = FORMAT_PCAP;
+        m_swap = (magic == swap32(PCAP_MAGIC_USEC) || magic == swap32(PCAP_MAGIC_NSEC));
+        m_nsecPcap = (get32(m_pData) == PCAP_MAGIC_NSEC);
+        m_linkType = get32(m_pData + 20) & 0xffff;
+        m_cursor += 24;
+        m_maxItems = (m_dataSize - 24) / 16;
+    } else if (m_dataSize >= 12 && magic == PCAPNG_SHB) {
+        m_format = FORMAT_PCAPNG;
+        m_maxItems = m_dataSize / 32; // smallest enhanced packet block
+    } else {
+        m_format = FORMAT_TEXT;
+        m_maxItems = m_dataSize / 4 + 1; // shortest line is "t,NN"
+    }
+
+    /* Parse the first chunk before the test starts */
+    fill(m_chunks[0]);
+    if (m_error) {
+        return SOCKPERF_ERR_INCORRECT;
+    }
+    if (!m_chunks[0].count) {
+        log_msg("file: %s, no playback data\n", filename);
+        return SOCKPERF_ERR_INCORRECT;
+    }
+    m_chunks[0].ready.store(true, std::memory_order_relaxed);
+    m_pItems = m_chunks[0].items;
+    m_count = m_chunks[0].count;
+    m_pos = 0;
+    m_cur = 0;
+    return SOCKPERF_ERR_NONE;
+}
+
+//------------------------------------------------------------------------------
+int PlaybackReader::start() {
+    if (0 != os_thread_exec(&m_tid, loader_thread, this)) {
+        log_err("Creating thread has failed");
+        return SOCKPERF_ERR_FATAL;
+    }
+    return SOCKPERF_ERR_NONE;
+}
+
+//------------------------------------------------------------------------------
+void PlaybackReader::stop() {
+    if (m_tid.tid) {
+        m_stop.store(true, std::memory_order_release);
+        os_thread_join(&m_tid);
+        os_thread_close(&m_tid);
+        m_tid.tid = 0;
+
+        if (m_stalls) {
+            log_msg("Playback: sender waited for the data file %" PRIu64 " times", m_stalls);
+        }
+        if (m_skipped) {
+            log_msg("Playback: %" PRIu64 " captured packets without UDP/TCP payload were skipped",
+                    m_skipped);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void *PlaybackReader::loader_thread(void *arg) {
+    PlaybackReader *_this = (PlaybackReader *)arg;
+    _this->run();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void PlaybackReader::run() {
+    int idx = 1; // the first chunk was filled by open()
+
+    while (!m_eof && !g_b_exit && !m_stop.load(std::memory_order_acquire)) {
+        Chunk &chunk = m_chunks[idx];
+        if (chunk.ready.load(std::memory_order_acquire)) {
+            usleep(PLAYBACK_POLL_USEC);
+            continue;
+        }
+        fill(chunk);
+        chunk.ready.store(true, std::memory_order_release);
+        idx ^= 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Release the consumed chunk to the loader and switch to the other one */
+bool PlaybackReader::nextChunk() {
+    Chunk &done = m_chunks[m_cur];
+    if (done.last) {
+        return false;
+    }
+    done.ready.store(false, std::memory_order_release);
+
+    m_cur ^= 1;
+    Chunk &chunk = m_chunks[m_cur];
+    if (!chunk.ready.load(std::memory_order_acquire)) {
+        m_stalls++;
+        while (!chunk.ready.load(std::memory_order_acquire)) {
+            if (g_b_exit) {
+                return false;
             }
         }
     }
-    // printf("pv.size()=%d\n", (int)pv.size());
+    m_pItems = chunk.items;
+    m_count = chunk.count;
+    m_pos = 0;
+    return m_count > 0;
+}
+
+//------------------------------------------------------------------------------
+void PlaybackReader::fill(Chunk &chunk) {
+    size_t count = 0;
+
+    while (count < PLAYBACK_CHUNK_ITEMS && !m_eof) {
+        PlaybackItem &item = chunk.items[count];
+        bool ok = false;
+        switch (m_format) {
+        case FORMAT_TEXT:
+            ok = parseText(item);
+            break;
+        case FORMAT_BIN:
+            ok = parseBin(item);
+            break;
+        case FORMAT_PCAP:
+            ok = parsePcap(item);
+            break;
+        case FORMAT_PCAPNG:
+            ok = parsePcapng(item);
+            break;
+        }
+        if (ok) {
+            count++;
+        }
+        if (m_error || m_cursor >= m_end) {
+            m_eof = true;
+        }
+    }
+    chunk.count = count;
+    chunk.last = m_eof;
 }
 
-void loadPlaybackData(PlaybackVector &pv, const char *filename) {
-    StringVector sv;
-    readFile(sv, filename);
-    parsePlaybackData(pv, sv);
-    sv.clear();
+//------------------------------------------------------------------------------
+bool PlaybackReader::parseText(PlaybackItem &item) {
+    const char *line = (const char *)m_cursor;
+    const char *eol = (const char *)memchr(line, '\n', m_end - m_cursor);
+    if (!eol) {
+        eol = (const char *)m_end;
+    }
+    m_cursor = _min((const uint8_t *)eol + 1, m_end);
+    m_record++;
+
+    size_t len = eol - line;
+    if (!len || line[0] == '#') {
+        return false;
+    }
+
+    char buf[PLAYBACK_LINE_MAX];
+    len = _min(len, sizeof(buf) - 1);
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    double curr_time;
+    item.stream = PLAYBACK_ANY_STREAM;
+    if (2 > sscanf(buf, "%lf, %d, %d", &curr_time, &item.size, &item.stream)) {
+        log_msg("can't read time & size, at line #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    int64_t nsec = (int64_t)(curr_time * NSEC_IN_SEC);
+    if (m_prevNsec > nsec) {
+        log_msg("out-of-order timestamp at line #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    item.duration = TicksDuration(nsec - m_prevNsec);
+    if (!item.isValid() || item.stream < PLAYBACK_ANY_STREAM) {
+        log_msg("illegal time, size or stream at line #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    m_prevNsec = nsec;
+    return true;
 }
 
-void doPlayback(PlaybackVector &pv) {
-    size_t size = pv.size();
-    for (size_t i = 0; i < size; i++)
-        printf("item #%lu: duration=%" PRId64 ", size=%d\n", (long unsigned)i,
-               pv[i].duration.toNsec(), pv[i].size);
+//------------------------------------------------------------------------------
+bool PlaybackReader::parseBin(PlaybackItem &item) {
+    PlaybackBinRecord record;
+    m_record++;
+    if ((uint64_t)(m_end - m_cursor) < m_recordSize) {
+        log_msg("truncated record #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    memcpy(&record, m_cursor, sizeof(record));
+    m_cursor += m_recordSize;
+
+    int64_t nsec = (int64_t)record.time_nsec;
+    if (m_prevNsec > nsec) {
+        log_msg("out-of-order timestamp at record #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    item.duration = TicksDuration(nsec - m_prevNsec);
+    item.size = (int)_min(record.size, (uint32_t)INT32_MAX);
+    item.stream = record.stream == UINT32_MAX ? PLAYBACK_ANY_STREAM
+                                              : (int)_min(record.stream, (uint32_t)INT32_MAX);
+    if (!item.isValid()) {
+        log_msg("illegal time or size at record #%" PRIu64, m_record);
+        m_error = true;
+        return false;
+    }
+    m_prevNsec = nsec;
+    return true;
 }
 
-// unit test
-int playback_test(int argc, char *argv[]) {
-    if (argc < 2) {
-        cout << argv[0] << ": Need a filename for a parameter.\n";
-        exit(1);
+//------------------------------------------------------------------------------
+bool PlaybackReader::parsePcap(PlaybackItem &item) {
+    const uint8_t *header = m_cursor;
+    // a capture that was interrupted may end with a partial packet
+    if (m_end - header < 16 || get32(header + 8) > (uint64_t)(m_end - header - 16)) {
+        m_cursor = m_end;
+        return false;
     }
+    uint32_t capLen = get32(header + 8);
+    m_cursor = header + 16 + capLen;
+    m_record++;
 
-    PlaybackVector pv;
-    loadPlaybackData(pv, argv[1]);
-    doPlayback(pv);
-    return 0;
+    int64_t nsec = (int64_t)get32(header) * NSEC_IN_SEC +
+                   (int64_t)get32(header + 4) * (m_nsecPcap ? 1 : 1000);
+    return capturedPacket(nsec, m_linkType, header + 16, capLen, item);
+}
+
+//------------------------------------------------------------------------------
+bool PlaybackReader::parsePcapng(PlaybackItem &item) {
+    const uint8_t *block = m_cursor;
+    if (m_end - block < 12) {
+        m_cursor = m_end;
+        return false;
+    }
+    uint32_t type = get32(block);
+    if (type == PCAPNG_SHB) { // every section defines its byte order and interfaces
+        uint32_t magic = raw32(block + 8);
+        if (magic != PCAPNG_BYTE_ORDER_MAGIC && magic != swap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+            log_msg("file: %s, bad pcapng section at offset %" PRIu64 "\n", m_filename,
+                    (uint64_t)(block - m_pData));
+            m_error = true;
+            return false;
+        }
+        m_swap = (magic != PCAPNG_BYTE_ORDER_MAGIC);
+        m_interfaces.clear();
+    }
+    uint32_t blockLen = get32(block + 4);
+    if (blockLen < 12 || blockLen % 4 || blockLen > (uint64_t)(m_end - block)) {
+        m_cursor = m_end;
+        return false;
+    }
+    m_cursor = block + blockLen;
+    const uint8_t *body = block + 8;
+    const uint8_t *bodyEnd = block + blockLen - 4;
+
+    if (type == PCAPNG_IDB && bodyEnd - body >= 8) {
+        Interface iface;
+        iface.linkType = get16(body);
+        iface.tsResol = 6;
+        for (const uint8_t *opt = body + 8; bodyEnd - opt >= 4;) {
+            uint16_t code = get16(opt);
+            uint16_t len = get16(opt + 2);
+            if (!code || bodyEnd - opt - 4 < len) {
+                break;
+            }
+            if (code == PCAPNG_OPT_TSRESOL && len >= 1) {
+                iface.tsResol = opt[4];
+            }
+            opt += 4 + ((len + 3) & ~3);
+        }
+        m_interfaces.push_back(iface);
+    } else if (type == PCAPNG_EPB && bodyEnd - body >= 20) {
+        uint32_t ifId = get32(body);
+        uint32_t capLen = get32(body + 12);
+        m_record++;
+        if (ifId >= m_interfaces.size() || capLen > (uint64_t)(bodyEnd - body - 20)) {
+            m_skipped++;
+            return false;
+        }
+        const Interface &iface = m_interfaces[ifId];
+        uint64_t ts = ((uint64_t)get32(body + 4) << 32) | get32(body + 8);
+        return capturedPacket(ts2nsec(ts, iface.tsResol), iface.linkType, body + 20, capLen,
+                              item);
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/* Replay the UDP/TCP payload of a captured packet, the time passed since the previous one is
+ * the duration (captures of several interfaces may be slightly out of order) */
+bool PlaybackReader::capturedPacket(int64_t nsec, int linkType, const uint8_t *data,
+                                    uint32_t len, PlaybackItem &item) {
+    uint32_t off = 0;
+    int version = 0;
+
+    switch (linkType) {
+    case LINKTYPE_NULL:
+        if (len >= 4) {
+            uint32_t family = get32(data);
+            family = family > 0xffff ? swap32(family) : family;
+            version = family == 2 ? 4 : (family == 24 || family == 28 || family == 30) ? 6 : 0;
+            off = 4;
+        }
+        break;
+    case LINKTYPE_ETHERNET:
+        if (len >= 14) {
+            uint16_t proto = be16(data + 12);
+            off = 14;
+            while ((proto == 0x8100 || proto == 0x88a8) && len >= off + 4) { // VLAN tags
+                proto = be16(data + off + 2);
+                off += 4;
+            }
+            version = proto == 0x0800 ? 4 : proto == 0x86dd ? 6 : 0;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (len >= 16) {
+            uint16_t proto = be16(data + 14);
+            version = proto == 0x0800 ? 4 : proto == 0x86dd ? 6 : 0;
+            off = 16;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (len >= 20) {
+            uint16_t proto = be16(data);
+            version = proto == 0x0800 ? 4 : proto == 0x86dd ? 6 : 0;
+            off = 20;
+        }
+        break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        version = len ? data[0] >> 4 : 0;
+        break;
+    }
+
+    /* Find the transport header and the length of IP payload */
+    const uint8_t *ip = data + off;
+    len = len > off ? len - off : 0;
+    int l4proto = -1;
+    uint32_t l4off = 0;
+    uint32_t l4len = 0;
+    const uint8_t *dst = NULL;
+    size_t dstLen = 0;
+    if (version == 4 && len >= 20) {
+        dst = ip + 16;
+        dstLen = 4;
+        uint32_t ihl = (ip[0] & 0xf) * 4;
+        uint32_t total = be16(ip + 2);
+        if (!(be16(ip + 6) & 0x1fff) && ihl >= 20 && total >= ihl) { // not a following fragment
+            l4proto = ip[9];
+            l4off = ihl;
+            l4len = total - ihl;
+        }
+    } else if (version == 6 && len >= 40) {
+        dst = ip + 24;
+        dstLen = 16;
+        int next = ip[6];
+        uint32_t hdrEnd = 40 + be16(ip + 4);
+        l4off = 40;
+        while ((next == 0 || next == 43 || next == 60 || next == 44) && len >= l4off + 8) {
+            if (next == 44 && (be16(ip + l4off + 2) & 0xfff8)) {
+                next = -1; // following fragment
+                break;
+            }
+            uint32_t extLen = next == 44 ? 8 : (ip[l4off + 1] + 1) * 8;
+            next = ip[l4off];
+            l4off += extLen;
+        }
+        if (hdrEnd >= l4off) {
+            l4proto = next;
+            l4len = hdrEnd - l4off;
+        }
+    }
+
+    int64_t size = 0;
+    if (l4proto == IPPROTO_UDP && len >= l4off + 8) {
+        size = (int64_t)be16(ip + l4off + 4) - 8;
+    } else if (l4proto == IPPROTO_TCP && len >= l4off + 13) {
+        size = (int64_t)l4len - (ip[l4off + 12] >> 4) * 4;
+    }
+    if (size <= 0) {
+        m_skipped++;
+        return false;
+    }
+
+    if (m_firstNsec < 0) {
+        m_firstNsec = m_prevNsec = nsec; // the first packet is sent at once
+    }
+    item.duration = TicksDuration(nsec > m_prevNsec ? nsec - m_prevNsec : 0);
+    item.size = (int)_max(_min(size, (int64_t)PLAYBACK_MAX_SIZE), (int64_t)PLAYBACK_MIN_SIZE);
+    item.stream = captureStream(dst, dstLen, be16(ip + l4off + 2));
+    m_prevNsec = _max(nsec, m_prevNsec);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int PlaybackReader::captureStream(const uint8_t *addr, size_t addrLen, uint16_t port) {
+    std::string key((const char *)addr, addrLen);
+    key.append((const char *)&port, sizeof(port));
+
+    std::map<std::string, int>::const_iterator itr = m_destinations.find(key);
+    if (itr != m_destinations.end()) {
+        return itr->second;
+    }
+    int stream = (int)m_destinations.size();
+    m_destinations[key] = stream;
+    return stream;
+}
+
+//------------------------------------------------------------------------------
+uint32_t PlaybackReader::get32(const uint8_t *p) const {
+    uint32_t v = raw32(p);
+    return m_swap ? swap32(v) : v;
+}
+
+//------------------------------------------------------------------------------
+uint16_t PlaybackReader::get16(const uint8_t *p) const {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return m_swap ? (uint16_t)((v >> 8) | (v << 8)) : v;
 }
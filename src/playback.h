@@ -29,18 +29,151 @@
 #ifndef PLAYBACK_H_
 #define PLAYBACK_H_
 
+#include <stdint.h> // for uint64_t
+#include <atomic>
+#include <map>
+#include <string>
 #include <vector>
+#include "defs.h"
 #include "ticks.h"
 
+#define PLAYBACK_MIN_SIZE 14
+#define PLAYBACK_MAX_SIZE 64000
+#define PLAYBACK_ANY_STREAM (-1) // sent to the next socket in round robin
+
 struct PlaybackItem {
     TicksDuration duration;
     int size;
-    bool isValid() { return duration > TicksDuration::TICKS0 && size >= 14 && size <= 64000; }
+    int stream; // index of the destination socket in the feed file or PLAYBACK_ANY_STREAM
+    bool isValid() {
+        return duration > TicksDuration::TICKS0 && size >= PLAYBACK_MIN_SIZE &&
+               size <= PLAYBACK_MAX_SIZE;
+    }
 };
 
-typedef std::vector<PlaybackItem> PlaybackVector;
+#define PLAYBACK_CHUNK_ITEMS (64 * 1024) // items parsed ahead in each of the two chunks
+
+/*
+ * Binary playback file: a header followed by fixed size records of absolute send time, message
+ * size and stream in host byte order (see tools/playback.py).
+ */
+#define PLAYBACK_BIN_MAGIC "SPPLAYB"
+#define PLAYBACK_BIN_VERSION 1
+
+struct PlaybackBinHeader {
+    char magic[8];        // PLAYBACK_BIN_MAGIC
+    uint32_t version;     // PLAYBACK_BIN_VERSION
+    uint32_t header_size; // offset of the first record
+    uint32_t record_size; // sizeof(PlaybackBinRecord)
+    uint32_t reserved;
+};
+
+struct PlaybackBinRecord {
+    uint64_t time_nsec; // send time, relative to the start of playback
+    uint32_t size;      // message size
+    uint32_t stream;    // destination socket, UINT32_MAX - round robin
+};
+
+/*
+ * PlaybackReader streams playback items from a data file that is mapped into memory, so the
+ * number of items is not limited by memory and the test starts without reading the whole file.
+ * Items are parsed ahead by a loader thread into two chunks: the sender consumes one chunk
+ * while the loader fills the other.
+ * Supported data files are text (CSV lines of "time, size[, stream]"), binary (see
+ * PlaybackBinHeader) and pcap/pcapng captures, where the UDP/TCP payload of every packet is
+ * replayed with the original timing and every destination (address and port) of the capture
+ * is a stream of its own, numbered in order of appearance.
+ */
+class PlaybackReader {
+public:
+    PlaybackReader();
+    ~PlaybackReader();
 
-// main interface to the module
-void loadPlaybackData(PlaybackVector &pv, const char *filename);
+    // maps the file and parses the first chunk
+    int open(const char *filename);
+    int start();
+    void stop();
+
+    // upper limit of the number of items in the file
+    uint64_t maxItems() const { return m_maxItems; }
+    // data after the first chunk was broken, so playback stopped early (valid after stop())
+    bool failed() const { return m_error; }
+
+    // called by the sender for every item, returns NULL at the end of data
+    inline const PlaybackItem *next() {
+        if (unlikely(m_pos == m_count)) {
+            if (!nextChunk()) {
+                return NULL;
+            }
+        }
+        return &m_pItems[m_pos++];
+    }
+
+private:
+    enum format_t { FORMAT_TEXT, FORMAT_BIN, FORMAT_PCAP, FORMAT_PCAPNG };
+
+    struct Chunk {
+        PlaybackItem *items;
+        size_t count;
+        std::atomic<bool> ready; // filled by the loader and not consumed yet
+        bool last;
+    };
+
+    struct Interface {
+        int linkType;
+        int tsResol; // if_tsresol: power of 10, or of 2 if the high bit is set
+    };
+
+    static void *loader_thread(void *arg);
+    void run();
+    bool nextChunk();
+    void fill(Chunk &chunk);
+    bool parseText(PlaybackItem &item);
+    bool parseBin(PlaybackItem &item);
+    bool parsePcap(PlaybackItem &item);
+    bool parsePcapng(PlaybackItem &item);
+    bool capturedPacket(int64_t nsec, int linkType, const uint8_t *data, uint32_t len,
+                        PlaybackItem &item);
+    int captureStream(const uint8_t *addr, size_t addrLen, uint16_t port);
+    uint32_t get32(const uint8_t *p) const;
+    uint16_t get16(const uint8_t *p) const;
+
+    // consumed by the sender
+    const PlaybackItem *m_pItems;
+    size_t m_count;
+    size_t m_pos;
+    int m_cur;
+    uint64_t m_stalls;
+
+    // produced by the loader
+    Chunk m_chunks[2];
+    std::atomic<bool> m_stop;
+    os_thread_t m_tid;
+
+    // parser state
+    const char *m_filename;
+    const uint8_t *m_pData;
+    uint64_t m_dataSize;
+    const uint8_t *m_cursor;
+    const uint8_t *m_end;
+    format_t m_format;
+    uint32_t m_recordSize; // of binary file
+    bool m_swap;           // capture was written in other byte order
+    bool m_eof;
+    bool m_error;
+    uint64_t m_record; // line or packet number
+    int64_t m_prevNsec;
+    int64_t m_firstNsec; // of capture
+    uint64_t m_maxItems;
+    uint64_t m_skipped; // packets of capture without payload to replay
+    int m_linkType;
+    bool m_nsecPcap;
+    std::vector<Interface> m_interfaces;
+    std::map<std::string, int> m_destinations; // of capture, to stream
+#ifdef __windows__
+    HANDLE m_hFile;
+    HANDLE m_hMap;
+#endif
+};
 
 #endif /* PLAYBACK_H__ */
@@ -31,7 +31,8 @@
 #include <memory>
 
 // static members initialization
-/*static*/ seq_num_map SwitchOnCalcGaps::ms_seq_num_map;
+/*static*/ thread_local SwitchOnCalcGaps::Sessions *SwitchOnCalcGaps::ms_pSessions = NULL;
+/*static*/ std::atomic<SwitchOnCalcGaps::Sessions *> SwitchOnCalcGaps::ms_pSessionsList(NULL);
 static CRITICAL_SECTION thread_exit_lock;
 static os_thread_t *thread_pid_array = NULL;
 
@@ -58,6 +59,12 @@ int ServerBase::initBeforeLoop() {
     int rc = SOCKPERF_ERR_NONE;
 
     rc = set_affinity_list(os_getthread(), g_pApp->m_const_params.threads_affinity);
+#ifdef __linux__
+    if (rc == SOCKPERF_ERR_NONE && (g_pApp->m_const_params.mem_prep & MEM_PREP_NUMA)) {
+        // first touch places the buffers on the NUMA node of this thread
+        mem_prefault_fds(m_ioHandlerRef.m_fd_min, m_ioHandlerRef.m_fd_max);
+    }
+#endif // __linux__
 
     if (g_b_exit) return rc;
 
@@ -96,7 +103,9 @@ int ServerBase::initBeforeLoop() {
 
             std::string hostport = sockaddr_to_hostport(p_bind_addr);
             log_dbg("[fd=%d] Binding to: %s...", ifd, hostport.c_str());
-            if (bind(ifd, reinterpret_cast<const sockaddr *>(p_bind_addr), bind_addr_len) < 0) {
+            // --reuseport sockets are bound and listen in the order of threads by bringup
+            if (!g_pApp->m_const_params.reuseport &&
+                bind(ifd, reinterpret_cast<const sockaddr *>(p_bind_addr), bind_addr_len) < 0) {
                 log_err("[fd=%d] Can`t bind socket, IP to bind: %s\n", ifd,
                         hostport.c_str());
                 rc = SOCKPERF_ERR_SOCKET;
@@ -115,7 +124,8 @@ int ServerBase::initBeforeLoop() {
                 break;
             }
 
-            if ((g_fds_array[ifd]->sock_type == SOCK_STREAM) && (listen(ifd, 10) < 0)) {
+            if ((g_fds_array[ifd]->sock_type == SOCK_STREAM) && !g_pApp->m_const_params.reuseport &&
+                (listen(ifd, 10) < 0)) {
                 log_err("Failed listen() for connection\n");
                 rc = SOCKPERF_ERR_SOCKET;
                 break;
@@ -162,8 +172,9 @@ void ServerBase::cleanupAfterLoop() {
 
 //------------------------------------------------------------------------------
 template <class IoType, class SwitchCalcGaps>
-Server<IoType, SwitchCalcGaps>::Server(int _fd_min, int _fd_max, int _fd_num)
-    : ServerBase(m_ioHandler), m_ioHandler(_fd_min, _fd_max, _fd_num) {}
+Server<IoType, SwitchCalcGaps>::Server(int _fd_min, int _fd_max, int _fd_num, int _thread)
+    : ServerBase(m_ioHandler), m_ioHandler(_fd_min, _fd_max, _fd_num), m_thread(_thread),
+      m_wakeup_fd(g_balancer.enabled() ? g_balancer.wakeupFd(_thread) : -1) {}
 
 //------------------------------------------------------------------------------
 template <class IoType, class SwitchCalcGaps>
@@ -175,6 +186,10 @@ void Server<IoType, SwitchCalcGaps>::doLoop() {
     int numReady = 0;
     int actual_fd = 0;
 
+    if (m_wakeup_fd >= 0) {
+        m_ioHandler.add_fd(m_wakeup_fd);
+    }
+
     while (!g_b_exit) {
         // wait for arrival
         numReady = m_ioHandler.waitArrival();
@@ -195,12 +210,17 @@ void Server<IoType, SwitchCalcGaps>::doLoop() {
         // handle arrival and response
         int accept_fd =
             (int)INVALID_SOCKET; // TODO: use SOCKET all over the way and avoid this cast
-        bool do_update = false;
         for (int ifd = m_ioHandler.get_look_start();
              (numReady) && (ifd < m_ioHandler.get_look_end()); ifd++) {
             actual_fd = m_ioHandler.analyzeArrival(ifd);
 
             if (actual_fd) {
+                if (unlikely(actual_fd == m_wakeup_fd)) {
+                    adopt_connections();
+                    numReady--;
+                    continue;
+                }
+
                 assert(g_fds_array[actual_fd] && "invalid fd");
 
                 if (!g_fds_array[actual_fd]) {
@@ -215,27 +235,20 @@ void Server<IoType, SwitchCalcGaps>::doLoop() {
                                 m_recived--;
                             }
                             if (server_receive_then_send(actual_fd)) {
-                                do_update = true;
+                                /* socket is closed */
+                                break;
                             } else if (os_err_eagain()) {
                                 break;
                             }
                         }
-                    } else if (accept_fd != (int)INVALID_SOCKET) { // TODO: use SOCKET all over the
-                                                                   // way and avoid this cast
-                        do_update = true;
                     } else {
-                        /* do nothing */
+                        /* new connection is registered by server_accept() */
                     }
                 }
                 numReady--;
             }
         }
 
-        /* do update of active fd in case accept/close was occured */
-        if (do_update) {
-            m_ioHandler.update();
-        }
-
         assert(!numReady && "all waiting descriptors should have been processed");
     }
 }
@@ -271,6 +284,11 @@ int Server<IoType, SwitchCalcGaps>::server_accept(int ifd) {
         tmp->recv.max_size = MAX_PAYLOAD_SIZE;
         tmp->recv.cur_offset = 0;
         tmp->recv.cur_size = tmp->recv.max_size;
+#ifdef __linux__
+        if (g_pApp->m_const_params.mem_prep & MEM_PREP_PREFAULT) {
+            mem_prefault(tmp->recv.buf, 2 * (size_t)tmp->recv.max_size);
+        }
+#endif // __linux__
 
         // TODO: use SOCKET all over the way and avoid this cast
         active_ifd = get_active_ifd(ifd, (struct sockaddr *)&addr, (socklen_t *)&addr_size);
@@ -301,7 +319,7 @@ int Server<IoType, SwitchCalcGaps>::server_accept(int ifd) {
                                                                         // the way and avoid this
                                                                         // cast
                             active_fd_list[i] = active_ifd;
-                            g_fds_array[ifd]->active_fd_count++;
+                            active_fd_count_add(g_fds_array[ifd], 1);
                             g_fds_array[active_ifd] = tmp.release();
 
                             std::string hostport = sockaddr_to_hostport(get_last_src(addr));
@@ -315,6 +333,15 @@ int Server<IoType, SwitchCalcGaps>::server_accept(int ifd) {
                                 }
                             }
 #endif /* DEFINED_TLS */
+                            int thread = (m_wakeup_fd < 0 ? m_thread
+                                                          : g_balancer.pickThread(m_thread));
+                            if (thread != m_thread &&
+                                g_balancer.handOver(m_thread, thread, active_ifd)) {
+                                log_dbg("connection [%d] is handed over to thread %d",
+                                        active_ifd, thread);
+                            } else {
+                                m_ioHandler.add_fd(active_ifd);
+                            }
                             do_accept = true;
                             break;
                         }
@@ -346,20 +373,29 @@ int Server<IoType, SwitchCalcGaps>::server_accept(int ifd) {
     return active_ifd;
 }
 
+//------------------------------------------------------------------------------
+template <class IoType, class SwitchCalcGaps>
+void Server<IoType, SwitchCalcGaps>::adopt_connections() {
+    g_balancer.drainWakeup(m_thread);
+    for (int fd = g_balancer.adopt(m_thread); fd >= 0; fd = g_balancer.adopt(m_thread)) {
+        m_ioHandler.add_fd(fd);
+    }
+}
+
 //------------------------------------------------------------------------------
 template <class IoType, class SwitchCheckGaps>
-void server_handler(int _fd_min, int _fd_max, int _fd_num) {
-    Server<IoType, SwitchCheckGaps> s(_fd_min, _fd_max, _fd_num);
+void server_handler(int _fd_min, int _fd_max, int _fd_num, int _thread) {
+    Server<IoType, SwitchCheckGaps> s(_fd_min, _fd_max, _fd_num, _thread);
     s.doHandler();
 }
 
 //------------------------------------------------------------------------------
 template <class IoType>
-void server_handler(int _fd_min, int _fd_max, int _fd_num) {
+void server_handler(int _fd_min, int _fd_max, int _fd_num, int _thread) {
     if (g_pApp->m_const_params.b_server_detect_gaps)
-        server_handler<IoType, SwitchOnCalcGaps>(_fd_min, _fd_max, _fd_num);
+        server_handler<IoType, SwitchOnCalcGaps>(_fd_min, _fd_max, _fd_num, _thread);
     else
-        server_handler<IoType, SwitchOff>(_fd_min, _fd_max, _fd_num);
+        server_handler<IoType, SwitchOff>(_fd_min, _fd_max, _fd_num, _thread);
 }
 
 //------------------------------------------------------------------------------
@@ -367,31 +403,38 @@ void server_handler(handler_info *p_info) {
     if (p_info) {
         switch (g_pApp->m_const_params.fd_handler_type) {
         case RECVFROM: {
-            server_handler<IoRecvfrom>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoRecvfrom>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
             break;
         }
         case RECVFROMMUX: {
-            server_handler<IoRecvfromMUX>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoRecvfromMUX>(p_info->fd_min, p_info->fd_max, p_info->fd_num,
+                                          p_info->id);
             break;
         }
         case SELECT: {
-            server_handler<IoSelect>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoSelect>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
             break;
         }
 #ifndef __windows__
         case POLL: {
-            server_handler<IoPoll>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoPoll>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
             break;
         }
 #if !defined(__FreeBSD__) && !defined(__APPLE__)
         case EPOLL: {
-            server_handler<IoEpoll>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoEpoll>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
             break;
         }
+#ifdef USING_IOURING
+        case IOURING: {
+            server_handler<IoUring>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
+            break;
+        }
+#endif // USING_IOURING
 #endif // !defined(__FreeBSD__) && !defined(__APPLE__)
 #if defined(__FreeBSD__) || defined(__APPLE__)
         case KQUEUE: {
-            server_handler<IoKqueue>(p_info->fd_min, p_info->fd_max, p_info->fd_num);
+            server_handler<IoKqueue>(p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
             break;
         }
 #endif // defined(__FreeBSD__) || defined(__APPLE__)
@@ -400,12 +443,12 @@ void server_handler(handler_info *p_info) {
             if (g_vma_api) {
 #ifdef USING_VMA_EXTRA_API // VMA socketxtreme-extra-api Only
                 server_handler<IoSocketxtremeVMA>(
-                    p_info->fd_min, p_info->fd_max, p_info->fd_num);
+                    p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
 #endif // USING_VMA_EXTRA_API
             } else if (g_xlio_api) {
 #ifdef USING_XLIO_EXTRA_API // XLIO socketxtreme-extra-api Only
                 server_handler<IoSocketxtremeXLIO>(
-                    p_info->fd_min, p_info->fd_max, p_info->fd_num);
+                    p_info->fd_min, p_info->fd_max, p_info->fd_num, p_info->id);
 #endif // USING_XLIO_EXTRA_API
             }
             break;
@@ -423,6 +466,16 @@ void *server_handler_for_multi_threaded(void *arg) {
     handler_info *p_info = (handler_info *)arg;
 
     if (p_info) {
+#ifdef __linux__
+        if (g_pApp->m_const_params.reuseport == REUSEPORT_CPU) {
+            // the socket of this thread gets messages received on the CPU of the same index
+            char cpu[16];
+            snprintf(cpu, sizeof(cpu), "%d", p_info->id);
+            if (set_affinity_list(os_getthread(), cpu)) {
+                log_err("--reuseport=cpu requires a CPU for every thread");
+            }
+        }
+#endif // __linux__
         server_handler(p_info);
 
         /* Mark this thread as complete (the first index is reserved for main thread) */
@@ -447,6 +500,9 @@ void find_min_max_fds(int start_look_from, int len, int *p_fd_min, int *p_fd_max
     int num_of_detected_fds;
     int i;
 
+    // empty range for a thread without sockets of its own (--tcp-rebalance)
+    *p_fd_min = start_look_from;
+
     for (num_of_detected_fds = 0, i = start_look_from; num_of_detected_fds < len; i++) {
         if (g_fds_array[i]) {
             if (!num_of_detected_fds) {
@@ -466,10 +522,13 @@ void server_sig_handler(int signum) {
         return;
     }
 
+    thread_stats_t total;
+    thread_stats_total(total);
+
     // Just in case not Activity updates where logged add a '\n'
     if (g_pApp->m_const_params.packetrate_stats_print_ratio &&
         !g_pApp->m_const_params.packetrate_stats_print_details &&
-        (g_pApp->m_const_params.packetrate_stats_print_ratio < g_receiveCount))
+        (g_pApp->m_const_params.packetrate_stats_print_ratio < total.receiveCount))
         printf("\n");
 
     if (g_pApp->m_const_params.mthread_server) {
@@ -495,12 +554,13 @@ void server_sig_handler(int signum) {
         }
     }
 
-    if (!g_receiveCount) {
+    if (!total.receiveCount) {
         log_msg("No messages were received on the server.");
     } else {
         log_msg("Total %" PRIu64 " messages received and handled",
-                g_receiveCount); // TODO: print also send count
+                (uint64_t)total.receiveCount); // TODO: print also send count
     }
+    spin_wait_statistics(total);
     SwitchOnCalcGaps::print_summary();
     g_b_exit = true;
 }
@@ -537,6 +597,10 @@ void server_select_per_thread(int _fd_num) {
         }
     }
 
+    if (rc == SOCKPERF_ERR_NONE && g_pApp->m_const_params.tcp_rebalance) {
+        rc = g_balancer.init(g_pApp->m_const_params.threads_num);
+    }
+
     if (rc == SOCKPERF_ERR_NONE) {
         INIT_CRITICAL(&thread_exit_lock);
 
@@ -607,6 +671,8 @@ void server_select_per_thread(int _fd_num) {
         DELETE_CRITICAL(&thread_exit_lock);
     }
 
+    g_balancer.cleanup();
+
     /* Free thread info allocated data */
     if (handler_info_array) {
         FREE(handler_info_array);
@@ -622,19 +688,32 @@ void server_select_per_thread(int _fd_num) {
 
 // Temp location because of compilation issue (inline-unit-growth=200) with the way this method was
 // inlined
+SwitchOnCalcGaps::Sessions &SwitchOnCalcGaps::sessions() {
+    if (unlikely(!ms_pSessions)) {
+        Sessions *p = new Sessions;
+        p->next = ms_pSessionsList.load(std::memory_order_relaxed);
+        while (!ms_pSessionsList.compare_exchange_weak(p->next, p, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {
+        }
+        ms_pSessions = p;
+    }
+    return *ms_pSessions;
+}
+
 void SwitchOnCalcGaps::execute(struct sockaddr_store_t &clt_addr, socklen_t clt_len, uint64_t seq_num, bool is_warmup) {
-    seq_num_map::iterator itr = ms_seq_num_map.find(clt_addr);
+    seq_num_map &sessions_map = sessions().map;
+    seq_num_map::iterator itr = sessions_map.find(clt_addr);
     bool starting_new_session = false;
     bool print_summary = false;
 
-    if (itr == ms_seq_num_map.end()) {
+    if (itr == sessions_map.end()) {
         clt_session_info_t new_session;
         memcpy(&new_session.addr, &clt_addr, clt_len);
         new_session.seq_num = seq_num;
         new_session.total_drops = 0;
         new_session.started = false;
         std::pair<seq_num_map::iterator, bool> ret_val =
-            ms_seq_num_map.insert(seq_num_map::value_type(clt_addr, new_session));
+            sessions_map.insert(seq_num_map::value_type(clt_addr, new_session));
         if (ret_val.second)
             itr = ret_val.first;
         else {
@@ -670,14 +749,13 @@ void SwitchOnCalcGaps::execute(struct sockaddr_store_t &clt_addr, socklen_t clt_
 // Temp location because of compilation issue (inline-unit-growth=200) with the way this method was
 // inlined
 void SwitchOnActivityInfo::execute(uint64_t counter) {
-    static TicksTime s_currTicks;
-    static int s_print_header = 0;
-
     if (counter % g_pApp->m_const_params.packetrate_stats_print_ratio == 0) {
         if (g_pApp->m_const_params.packetrate_stats_print_details) {
-            TicksDuration interval = s_currTicks.setNow() - g_lastTicks;
+            TicksTime currTicks = TicksTime::now();
+            TicksDuration interval =
+                currTicks - (m_lastTicks == TicksTime::TICKS0 ? g_lastTicks : m_lastTicks);
             if (interval < TicksDuration::TICKS1HOUR) {
-                if (s_print_header++ % 20 == 0) {
+                if (m_printHeader++ % 20 == 0) {
                     printf(
                         "    -- Interval --     -- Message Rate --  -- Total Message Count --\n");
                 }
@@ -686,7 +764,7 @@ void SwitchOnActivityInfo::execute(uint64_t counter) {
                 printf(" %10" PRId64 " [usec]    %10" PRId64 " [msg/s]    %13" PRIu64 " [msg]\n",
                        interval.toUsec(), interval_packet_rate, counter);
             }
-            g_lastTicks = s_currTicks;
+            m_lastTicks = currTicks;
         } else {
             printf(".");
         }
@@ -33,6 +33,7 @@
 #include "common.h"
 #include "input_handlers.h"
 #include "switches.h"
+#include "balancer.h"
 
 #ifdef ST_TEST
 extern int prepare_socket(int fd, struct fds_data *p_data, bool stTest = false);
@@ -42,6 +43,16 @@ extern int prepare_socket(int fd, struct fds_data *p_data);
 
 class IoHandler;
 
+/* active_fd_count of a listen socket is also updated by threads that got its connections from
+ * ConnBalancer; fds_data is copied, so the counter is not std::atomic */
+static inline void active_fd_count_add(fds_data *p_data, int num) {
+#if defined(__GNUC__)
+    __atomic_fetch_add(&p_data->active_fd_count, num, __ATOMIC_RELAXED);
+#else
+    p_data->active_fd_count += num; // --tcp-rebalance is not supported there
+#endif
+}
+
 class ServerBase {
 private:
     // protected:
@@ -138,7 +149,7 @@ private:
 
  public:
     //------------------------------------------------------------------------------
-    Server(int _fd_min, int _fd_max, int _fd_num);
+    Server(int _fd_min, int _fd_max, int _fd_num, int _thread);
     virtual ~Server();
     virtual void doLoop();
 
@@ -165,10 +176,19 @@ private:
     }
 #endif
 
+#ifdef USING_IOURING
+    template <typename T = IoType>
+    inline std::enable_if_t<is_iouring_bufftype<T>::value, bool>
+    server_receive_then_send(int ifd) {
+        return server_receive_then_send_impl<UringInputHandler>(ifd);
+    }
+#endif // USING_IOURING
+
     template <typename T = IoType>
     inline std::enable_if_t<!(
         is_vma_bufftype<T>{} ||
-        is_xlio_bufftype<T>{}), bool>
+        is_xlio_bufftype<T>{} ||
+        is_iouring_bufftype<T>{}), bool>
     server_receive_then_send(int ifd) {
 #ifdef USING_VMA_EXTRA_API // VMA
         if (g_pApp->m_const_params.is_zcopyread && g_vma_api) {
@@ -180,6 +200,14 @@ private:
             return server_receive_then_send_impl<XlioZCopyReadInputHandler>(ifd);
         }
 #endif // USING_XLIO_EXTRA_API
+#ifdef __linux__
+        if (g_fds_array[ifd] && g_fds_array[ifd]->recv.mmsg_num) {
+            return server_receive_then_send_impl<RecvMmsgInputHandler>(ifd);
+        }
+        if (g_fds_array[ifd] && g_fds_array[ifd]->recv.gro) {
+            return server_receive_then_send_impl<RecvGroInputHandler>(ifd);
+        }
+#endif // __linux__
         return server_receive_then_send_impl<RecvFromInputHandler>(ifd);
     }
 
@@ -188,10 +216,15 @@ private:
 
     //------------------------------------------------------------------------------
     int server_accept(int ifd);
+    void close_ifd(int fd, int ifd, fds_data *l_fds_ifd);
 
 private:
+    void adopt_connections();
+
     SwitchOnActivityInfo m_switchActivityInfo;
     SwitchCalcGaps m_switchCalcGaps;
+    const int m_thread;    // index of the server thread
+    const int m_wakeup_fd; // --tcp-rebalance: connections were handed over to this thread
 };
 
 void print_log(const char *error, const fds_data *fds) {
@@ -209,7 +242,8 @@ void print_log(const char *error, int fds) {
 ** when ret == RET_SOCKET_SHUTDOWN
 ** close ifd
 */
-void close_ifd(int fd, int ifd, fds_data *l_fds_ifd) {
+template <class IoType, class SwitchCalcGaps>
+void Server<IoType, SwitchCalcGaps>::close_ifd(int fd, int ifd, fds_data *l_fds_ifd) {
     fds_data *l_next_fd = g_fds_array[fd];
 
 #ifdef USING_VMA_EXTRA_API // VMA
@@ -240,8 +274,9 @@ void close_ifd(int fd, int ifd, fds_data *l_fds_ifd) {
     for (int i = 0; i < MAX_ACTIVE_FD_NUM; i++) {
         if (l_next_fd->active_fd_list[i] == ifd) {
             print_log_dbg(reinterpret_cast<sockaddr *>(&l_fds_ifd->server_addr), ifd);
-            close(ifd);
-            l_next_fd->active_fd_count--;
+            m_ioHandler.remove_fd(ifd);
+            /* the listen socket can belong to another thread (see ConnBalancer) */
+            active_fd_count_add(l_next_fd, -1);
             l_next_fd->active_fd_list[i] =
                 (int)INVALID_SOCKET; // TODO: use SOCKET all over the way and avoid this cast
             if (g_fds_array[ifd]->active_fd_list) {
@@ -252,6 +287,11 @@ void close_ifd(int fd, int ifd, fds_data *l_fds_ifd) {
             }
             free(g_fds_array[ifd]);
             g_fds_array[ifd] = NULL;
+            if (g_balancer.enabled()) {
+                g_balancer.connectionClosed(m_thread);
+            }
+            /* the same fd can be accepted right after close() so it goes last */
+            close(ifd);
             break;
         }
     }
@@ -311,6 +351,7 @@ inline bool Server<IoType, SwitchCalcGaps>::handle_message(int ifd,
 {
     static const bool is_exec_activity_info =
         (g_pApp->m_const_params.packetrate_stats_print_ratio > 0);
+    static const bool is_tcp_rebalance = g_pApp->m_const_params.tcp_rebalance;
 
     struct sockaddr_store_t sendto_addr;
     socklen_t sendto_addr_len = 0;
@@ -335,7 +376,10 @@ inline bool Server<IoType, SwitchCalcGaps>::handle_message(int ifd,
         return true;
     }
 
-    g_receiveCount++; //// should move to setRxTime (once we use it in server side)
+    uint64_t receiveCount = ++thread_stats().receiveCount;
+    if (unlikely(is_tcp_rebalance)) {
+        g_balancer.countMessage(m_thread);
+    }
 
     if (m_pMsgReply->getHeader()->isPongRequest()) {
         /* if server in a no reply mode - shift to start of cycle buffer*/
@@ -375,7 +419,7 @@ inline bool Server<IoType, SwitchCalcGaps>::handle_message(int ifd,
 
     m_switchCalcGaps.execute(recvfrom_addr, recvfrom_len, m_pMsgReply->getSequenceCounter(), false);
     if (unlikely(is_exec_activity_info)) {
-        m_switchActivityInfo.execute(g_receiveCount);
+        m_switchActivityInfo.execute(receiveCount);
     }
 
     return true;
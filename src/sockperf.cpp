@@ -95,6 +95,8 @@
 #include "message.h"
 #include "message_parser.h"
 #include "packet.h"
+#include "interval_report.h"
+#include "playback.h"
 #include "port_descriptor.h"
 #include "aopt.h"
 #include <stdio.h>
@@ -103,6 +105,10 @@
 #ifndef __windows__
 #include <dlfcn.h>
 #endif
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sys/mman.h>
+#endif
 
 // forward declarations from Client.cpp & Server.cpp
 extern void client_sig_handler(int signum);
@@ -191,6 +197,9 @@ static const AOPT_DESC common_opt_desc[] = {
       "Type of multiple file descriptors handle [s|select|r|recvfrom](default select)."
 #elif defined(__FreeBSD__) || defined(__APPLE__)
       "Type of multiple file descriptors handle [s|select|p|poll|r|recvfrom|k|kqueue](default kqueue)."
+#elif defined(USING_IOURING)
+      "Type of multiple file descriptors handle "
+      "[s|select|p|poll|e|epoll|u|io_uring|r|recvfrom|x|socketxtreme](default epoll)."
 #else
       "Type of multiple file descriptors handle "
       "[s|select|p|poll|e|epoll|r|recvfrom|x|socketxtreme](default epoll)."
@@ -208,6 +217,9 @@ static const AOPT_DESC common_opt_desc[] = {
       "Set select/poll/epoll timeout to <msec>, -1 for infinite (default is 10 msec)."
 #endif
     },
+    { OPT_SPIN_WAIT, AOPT_ARG, aopt_set_literal(0), aopt_set_string("spin-wait"),
+      "Check the iomux without blocking for up to <usec> before a blocking wait and report "
+      "the share of messages caught while spinning (default 0 - block right away)." },
     { 'a',
       AOPT_ARG,
       aopt_set_literal('a'),
@@ -260,6 +272,15 @@ static const AOPT_DESC common_opt_desc[] = {
     { OPT_RECV_LOOPING, AOPT_ARG, aopt_set_literal(0), aopt_set_string("recv_looping_num"),
       "Set sockperf to loop over recvfrom() until EAGAIN or <N> good received packets, -1 for "
       "infinite, must be used with --nonblocked (default 1). " },
+#ifdef __linux__
+    { OPT_RECVMMSG, AOPT_ARG, aopt_set_literal(0), aopt_set_string("recvmmsg"),
+      "Receive up to <N> UDP messages with a single recvmmsg() call "
+      "(every receiving thread reserves <N> message buffers)." },
+    { OPT_MEM_PREP, AOPT_ARG, aopt_set_literal(0), aopt_set_string("mem-prep"),
+      "Prepare memory before the test, comma separated list of: prefault (touch receive "
+      "buffers), hugepages (map timestamp arrays with huge pages), mlock (lock memory of the "
+      "process), numa (pre-fault buffers of a socket from the pinned thread that serves it)." },
+#endif // __linux__
     { OPT_DONTWARMUP,                AOPT_NOARG,                             aopt_set_literal(0),
       aopt_set_string("dontwarmup"), "Don't send warm up messages on start." },
     { OPT_PREWARMUPWAIT,                                        AOPT_ARG,
@@ -319,6 +340,14 @@ static const AOPT_DESC client_opt_desc[] = {
       aopt_set_literal(0),
       aopt_set_string("full-log"),
       "Dump full log of all messages send/receive time to the given file in CSV format." },
+#ifndef __windows__
+    { OPT_FULL_LOG_BIN,
+      AOPT_ARG,
+      aopt_set_literal(0),
+      aopt_set_string("full-log-bin"),
+      "Write full log of all messages send/receive time to the given file in binary format while "
+      "the test runs (see tools/fulllog.py)." },
+#endif // __windows__
     { OPT_FULL_RTT,                                         AOPT_NOARG,
       aopt_set_literal(0),                                  aopt_set_string("full-rtt"),
       "Show results in round-trip-time instead of latency." },
@@ -336,6 +365,33 @@ static const AOPT_DESC client_opt_desc[] = {
       "Use VMA's dummy send API instead of busy wait, must be higher than regular msg rate. "
       "\n\t\t\t\t optional: set dummy-send rate per second (default 10,000), usage: --dummy-send "
       "[<rate>|max]" },
+    { OPT_INTERVAL_REPORT,         AOPT_ARG,                  aopt_set_literal(0),
+      aopt_set_string("interval-report"),
+      "Print latency percentiles and loss of every <msec> interval while the test runs." },
+    { OPT_PACING,                  AOPT_ARG,                  aopt_set_literal(0),
+      aopt_set_string("pacing"),
+      "Set distribution of gaps between sends keeping mean rate of --mps, usage: --pacing "
+      "fixed|poisson|uniform[:<jitter%>]|onoff:<on_msec>:<off_msec> (default fixed; jitter "
+      "default 50)." },
+#ifndef __windows__
+    { OPT_SLEEP_PACING,            AOPT_ARG,                  aopt_set_literal(0),
+      aopt_set_string("sleep-pacing"),
+      "Sleep between sends and busy wait only for the last <usec> before every send, to lower "
+      "CPU use of low rate tests; pacing error percentiles are reported." },
+#endif // __windows__
+#ifdef __linux__
+    { OPT_SENDMMSG,                AOPT_NOARG,                aopt_set_literal(0),
+      aopt_set_string("sendmmsg"), "Send every burst of UDP messages using a single sendmmsg() call." },
+    { OPT_ZCOPY_SEND,              AOPT_NOARG,                aopt_set_literal(0),
+      aopt_set_string("zcopy-send"),
+      "Send messages using MSG_ZEROCOPY, completions are reaped from the socket error queue." },
+    { OPT_TIMESTAMPING,            AOPT_OPTARG,               aopt_set_literal(0),
+      aopt_set_string("timestamping"),
+      "Take kernel RX/TX timestamps (SO_TIMESTAMPING) and report wire-to-user and user-to-wire "
+      "latency.\n\t\t\t\t optional: set timestamps source, usage: --timestamping [sw|hw] "
+      "(default sw; hw enables NIC timestamping of the interface (SIOCSHWTSTAMP, needs "
+      "CAP_NET_ADMIN) and requires NIC clock synchronized with system clock, e.g. by phc2sys)" },
+#endif // __linux__
     { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
 };
 
@@ -482,6 +538,18 @@ static int proc_mode_under_load(int id, int argc, const char **argv) {
           aopt_set_literal(0),
           aopt_set_string("histogram"),
           "Build histogram of latencies. Histogram arguments formated as binsize:lowerrange:upperrange " },
+        { OPT_EXACT_STATS,
+          AOPT_NOARG,
+          aopt_set_literal(0),
+          aopt_set_string("exact-stats"),
+          "Keep every observation and calculate statistics by sorting them instead of using "
+          "streaming histogram (needs memory per observation)." },
+        { OPT_INTENDED_TIME,
+          AOPT_NOARG,
+          aopt_set_literal(0),
+          aopt_set_string("intended-time"),
+          "Also report latency measured from the intended send time of every message according "
+          "to --mps (includes queueing delay when the sender falls behind)." },
         { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
     };
 
@@ -659,6 +727,19 @@ static int proc_mode_under_load(int id, int argc, const char **argv) {
             }
         }
 
+        if (!rc && aopt_check(self_obj, OPT_EXACT_STATS)) {
+            s_user_params.b_exact_stats = true;
+        }
+
+        if (!rc && aopt_check(self_obj, OPT_INTENDED_TIME)) {
+            if (s_user_params.mps == UINT32_MAX) {
+                log_msg("--intended-time requires limited --mps");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else {
+                s_user_params.b_intended_time = true;
+            }
+        }
+
         if (!rc && aopt_check(self_obj, OPT_HISTOGRAM)) {
             s_user_params.b_histogram = true;
             const char *optarg = aopt_value(self_obj, OPT_HISTOGRAM);
@@ -765,6 +846,11 @@ static int proc_mode_ping_pong(int id, int argc, const char **argv) {
         { 'b',                                                             AOPT_ARG,
           aopt_set_literal('b'),                                           aopt_set_string("burst"),
           "Control the client's number of a messages sent in every burst." },
+        { OPT_OUTSTANDING,                  AOPT_ARG,                      aopt_set_literal(0),
+          aopt_set_string("outstanding"),
+          "Keep <N> requests in flight on every connection (max 4096), every reply triggers the "
+          "next request (pipelined request/response). UDP request without reply for 100 msec is "
+          "lost and replaced." },
         { OPT_MPS, AOPT_ARG, aopt_set_literal(0), aopt_set_string("mps"),
           "Set number of messages-per-second (default = 10000 - for under-load mode, or max - for "
           "ping-pong and throughput modes; for maximum use --mps=max; \n\t\t\t\t support --pps for "
@@ -791,6 +877,12 @@ static int proc_mode_ping_pong(int id, int argc, const char **argv) {
           aopt_set_literal(0),
           aopt_set_string("histogram"),
           "Build histogram of latencies. Histogram arguments formated as binsize:lowerrange:upperrange " },
+        { OPT_EXACT_STATS,
+          AOPT_NOARG,
+          aopt_set_literal(0),
+          aopt_set_string("exact-stats"),
+          "Keep every observation and calculate statistics by sorting them instead of using "
+          "streaming histogram (needs memory per observation)." },
         { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
     };
 
@@ -963,6 +1055,30 @@ static int proc_mode_ping_pong(int id, int argc, const char **argv) {
             }
         }
 
+        if (!rc && aopt_check(self_obj, OPT_OUTSTANDING)) {
+            if (!aopt_check(self_obj, 'b') && !aopt_check(self_obj, 'n') &&
+                !aopt_check(self_obj, OPT_MPS) && !aopt_check(self_obj, OPT_DATA_INTEGRITY)) {
+                const char *optarg = aopt_value(self_obj, OPT_OUTSTANDING);
+                if (optarg) {
+                    errno = 0;
+                    int value = strtol(optarg, NULL, 0);
+                    if (errno != 0 || value < 1 || value > MAX_OUTSTANDING) {
+                        log_msg("'-%d' Invalid number of outstanding requests (1..%d): %s",
+                                OPT_OUTSTANDING, MAX_OUTSTANDING, optarg);
+                        rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                    } else {
+                        s_user_params.outstanding = value;
+                    }
+                } else {
+                    log_msg("'-%d' Invalid value", OPT_OUTSTANDING);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                }
+            } else {
+                log_msg("--outstanding conflicts with -b,-n,--mps,--data-integrity options");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+
         if (!rc && aopt_check(self_obj, OPT_DATA_INTEGRITY)) {
             if (!aopt_check(self_obj, 'b')) {
                 s_user_params.data_integrity = true;
@@ -991,6 +1107,10 @@ static int proc_mode_ping_pong(int id, int argc, const char **argv) {
             }
         }
 
+        if (!rc && aopt_check(self_obj, OPT_EXACT_STATS)) {
+            s_user_params.b_exact_stats = true;
+        }
+
         if (!rc && aopt_check(self_obj, OPT_HISTOGRAM)) {
             s_user_params.b_histogram = true;
             const char *optarg = aopt_value(self_obj, OPT_HISTOGRAM);
@@ -1065,7 +1185,7 @@ static int proc_mode_ping_pong(int id, int argc, const char **argv) {
 
     /* It is set to reduce memory needed for PacketTime buffer */
     if (s_user_params.mps == UINT32_MAX) { // MAX MPS mode
-        MPS_MAX = MPS_MAX_PP * s_user_params.burst_size;
+        MPS_MAX = MPS_MAX_PP * _max(s_user_params.burst_size, s_user_params.outstanding);
         if (MPS_MAX > MPS_MAX_UL) MPS_MAX = MPS_MAX_UL;
     }
 
@@ -1112,6 +1232,12 @@ static int proc_mode_throughput(int id, int argc, const char **argv) {
           aopt_set_literal('r'),
           aopt_set_string("range"),
           "comes with -m <size>, randomly change the messages size in range: <size> +- <N>." },
+#ifdef __linux__
+        { OPT_UDP_GSO,                                                     AOPT_NOARG,
+          aopt_set_literal(0),                                             aopt_set_string("udp-gso"),
+          "Send every burst of UDP messages as a single UDP_SEGMENT (GSO) buffer that is split "
+          "by the kernel into datagrams of <msg-size> bytes." },
+#endif // __linux__
         { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
     };
 
@@ -1253,6 +1379,30 @@ static int proc_mode_throughput(int id, int argc, const char **argv) {
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
+
+#ifdef __linux__
+        if (!rc && aopt_check(self_obj, OPT_UDP_GSO)) {
+            if (s_user_params.sock_type == SOCK_STREAM) {
+                log_msg("--udp-gso conflicts with --tcp option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.msg_size_range) {
+                log_msg("--udp-gso conflicts with -r option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.is_sendmmsg || s_user_params.is_zcopy_send) {
+                log_msg("--udp-gso conflicts with --sendmmsg and --zcopy-send options");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.burst_size > UDP_GSO_MAX_SEGMENTS) {
+                log_msg("--udp-gso supports burst of up to %d messages", UDP_GSO_MAX_SEGMENTS);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if ((int)s_user_params.burst_size * s_user_params.msg_size > MAX_UDP_SIZE) {
+                log_msg("--udp-gso requires burst * msg-size to fit a single UDP datagram "
+                        "(max: %d)", MAX_UDP_SIZE);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else {
+                s_user_params.is_udp_gso = true;
+            }
+        }
+#endif // __linux__
     }
 
     if (!rc) {
@@ -1322,7 +1472,8 @@ static int proc_mode_playback(int id, int argc, const char **argv) {
           "Set number of send messages between reply messages (default = 100)." },
         { OPT_PLAYBACK_DATA,                                         AOPT_ARG,
           aopt_set_literal(0),                                       aopt_set_string("data-file"),
-          "Pre-prepared CSV file with timestamps and message sizes." },
+          "Pre-prepared file with timestamps, message sizes and optional streams (feed file "
+          "sockets): CSV, binary (see playback.py) or pcap/pcapng capture." },
         { OPT_CI_SIG_LVL,
           AOPT_OPTARG,
           aopt_set_literal(0),
@@ -1334,6 +1485,12 @@ static int proc_mode_playback(int id, int argc, const char **argv) {
           aopt_set_literal(0),
           aopt_set_string("histogram"),
           "Build histogram of latencies. Histogram arguments formated as binsize:lowerrange:upperrange " },
+        { OPT_EXACT_STATS,
+          AOPT_NOARG,
+          aopt_set_literal(0),
+          aopt_set_string("exact-stats"),
+          "Keep every observation and calculate statistics by sorting them instead of using "
+          "streaming histogram (needs memory per observation)." },
         { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
     };
 
@@ -1380,9 +1537,12 @@ static int proc_mode_playback(int id, int argc, const char **argv) {
         if (!rc && aopt_check(self_obj, OPT_PLAYBACK_DATA)) {
             const char *optarg = aopt_value(self_obj, OPT_PLAYBACK_DATA);
             if (optarg) {
-                static PlaybackVector pv;
-                loadPlaybackData(pv, optarg);
-                s_user_params.pPlaybackVector = &pv;
+                static PlaybackReader reader;
+                int ret = reader.open(optarg);
+                if (ret != SOCKPERF_ERR_NONE) {
+                    exit(ret);
+                }
+                s_user_params.pPlaybackReader = &reader;
             } else {
                 log_msg("'-%d' Invalid value", OPT_PLAYBACK_DATA);
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
@@ -1425,6 +1585,10 @@ static int proc_mode_playback(int id, int argc, const char **argv) {
             }
         }
 
+        if (!rc && aopt_check(self_obj, OPT_EXACT_STATS)) {
+            s_user_params.b_exact_stats = true;
+        }
+
         if (!rc && aopt_check(self_obj, OPT_HISTOGRAM)) {
             s_user_params.b_histogram = true;
             const char *optarg = aopt_value(self_obj, OPT_HISTOGRAM);
@@ -1516,13 +1680,27 @@ static int proc_mode_server(int id, int argc, const char **argv) {
         */
         { OPT_THREADS_NUM,                                         AOPT_ARG,
           aopt_set_literal(0),                                     aopt_set_string("threads-num"),
-          "Run <N> threads on server side (requires '-f' option)." },
+          "Run <N> threads on server side (requires '-f', --reuseport or --tcp-rebalance option)." },
         { OPT_THREADS_AFFINITY,
           AOPT_ARG,
           aopt_set_literal(0),
           aopt_set_string("cpu-affinity"),
           "Set threads affinity to the given core ids in list format (see: cat /proc/cpuinfo)." },
 #ifndef __windows__
+        { OPT_REUSEPORT,
+          AOPT_OPTARG,
+          aopt_set_literal(0),
+          aopt_set_string("reuseport"),
+          "Every thread of --threads-num opens its own socket of every address with SO_REUSEPORT "
+          "(-f is not required). With 'cpu' a message goes to the thread that runs on the CPU "
+          "it was received on, thread N is bound to CPU N (Linux only)." },
+        { OPT_TCP_REBALANCE,
+          AOPT_NOARG,
+          aopt_set_literal(0),
+          aopt_set_string("tcp-rebalance"),
+          "Hand accepted TCP connections over to the server thread with the lowest recent "
+          "message rate (requires --threads-num, -f is not required and threads may outnumber "
+          "sockets)." },
         { OPT_RXFILTERCB,
           AOPT_NOARG,
           aopt_set_literal(0),
@@ -1542,6 +1720,11 @@ static int proc_mode_server(int id, int argc, const char **argv) {
           "Set maximum message size that the server can receive <size> bytes (default 65507)." },
         { 'g',                              AOPT_NOARG,             aopt_set_literal('g'),
           aopt_set_string("gap-detection"), "Enable gap-detection." },
+#ifdef __linux__
+        { OPT_UDP_GRO,                      AOPT_NOARG,             aopt_set_literal(0),
+          aopt_set_string("udp-gro"),
+          "Enable UDP_GRO on UDP sockets, coalesced datagrams are split into messages by gso_size." },
+#endif // __linux__
         { 0, AOPT_NOARG, aopt_set_literal(0), aopt_set_string(NULL), NULL }
     };
 
@@ -1586,7 +1769,8 @@ static int proc_mode_server(int id, int argc, const char **argv) {
         }
 
         if (!rc && aopt_check(server_obj, OPT_THREADS_NUM)) {
-            if (aopt_check(common_obj, 'f')) {
+            if (aopt_check(common_obj, 'f') || aopt_check(server_obj, OPT_REUSEPORT) ||
+                aopt_check(server_obj, OPT_TCP_REBALANCE)) {
                 const char *optarg = aopt_value(server_obj, OPT_THREADS_NUM);
                 if (optarg) {
                     s_user_params.mthread_server = 1;
@@ -1606,7 +1790,8 @@ static int proc_mode_server(int id, int argc, const char **argv) {
                     rc = SOCKPERF_ERR_BAD_ARGUMENT;
                 }
             } else {
-                log_msg("--threads-num must be used with feed file (option '-f')");
+                log_msg("--threads-num must be used with feed file (option '-f'), --reuseport or "
+                        "--tcp-rebalance");
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
@@ -1620,6 +1805,47 @@ static int proc_mode_server(int id, int argc, const char **argv) {
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
+#ifndef __windows__
+        if (!rc && aopt_check(server_obj, OPT_REUSEPORT)) {
+            const char *optarg = aopt_value(server_obj, OPT_REUSEPORT);
+            if (!optarg || !optarg[0]) {
+                s_user_params.reuseport = REUSEPORT_HASH;
+#ifdef __linux__
+            } else if (!strcmp(optarg, "cpu")) {
+                s_user_params.reuseport = REUSEPORT_CPU;
+#endif // __linux__
+            } else {
+                log_msg("'--%s' Invalid value: %s",
+                        aopt_get_long_name(server_opt_desc, OPT_REUSEPORT), optarg);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+            if (!rc && !s_user_params.mthread_server) {
+                log_msg("--reuseport must be used with --threads-num");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+            if (!rc && s_user_params.reuseport == REUSEPORT_CPU &&
+                s_user_params.threads_affinity[0]) {
+                log_msg("--reuseport=cpu conflicts with --cpu-affinity option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+        if (!rc && aopt_check(server_obj, OPT_TCP_REBALANCE)) {
+            if (s_user_params.mthread_server) {
+                s_user_params.tcp_rebalance = true;
+                if (s_user_params.fd_handler_type == RECVFROM) {
+                    // socket of -i/-p is watched with connections and wakeups of the thread
+#if defined(__FreeBSD__) || defined(__APPLE__)
+                    s_user_params.fd_handler_type = KQUEUE;
+#else
+                    s_user_params.fd_handler_type = EPOLL;
+#endif
+                }
+            } else {
+                log_msg("--tcp-rebalance must be used with --threads-num");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#endif // __windows__
 #ifndef __windows__
         if (!rc && aopt_check(server_obj, OPT_RXFILTERCB)) {
             s_user_params.is_rxfiltercb = true;
@@ -1653,6 +1879,18 @@ static int proc_mode_server(int id, int argc, const char **argv) {
         if (!rc && aopt_check(server_obj, 'g')) {
             s_user_params.b_server_detect_gaps = true;
         }
+#ifdef __linux__
+        if (!rc && aopt_check(server_obj, OPT_UDP_GRO)) {
+            if (s_user_params.recvmmsg_num) {
+                log_msg("--udp-gro conflicts with --recvmmsg option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else {
+                s_user_params.is_udp_gro = true;
+                /* receive buffer must fit whole coalesced buffer */
+                MAX_PAYLOAD_SIZE = _max(MAX_PAYLOAD_SIZE, UDP_GRO_MAX_SIZE);
+            }
+        }
+#endif // __linux__
     }
 
     if (rc) {
@@ -1853,6 +2091,11 @@ static int parse_common_opt(const AOPT_OBJECT *common_obj) {
                     if (!strcmp(fd_handle_type, "epoll") || !strcmp(fd_handle_type, "e")) {
                         s_user_params.fd_handler_type = EPOLL;
                     } else
+#ifdef USING_IOURING
+                    if (!strcmp(fd_handle_type, "io_uring") || !strcmp(fd_handle_type, "u")) {
+                        s_user_params.fd_handler_type = IOURING;
+                    } else
+#endif // USING_IOURING
 #endif
 #if defined(__FreeBSD__) || defined(__APPLE__)
                     if (!strcmp(fd_handle_type, "kqueue") || !strcmp(fd_handle_type, "k")) {
@@ -1993,6 +2236,23 @@ static int parse_common_opt(const AOPT_OBJECT *common_obj) {
             }
         }
 
+        if (!rc && aopt_check(common_obj, OPT_SPIN_WAIT)) {
+            const char *optarg = aopt_value(common_obj, OPT_SPIN_WAIT);
+            if (optarg) {
+                errno = 0;
+                long value = strtol(optarg, NULL, 0);
+                if (errno != 0 || value < 0 || value > MAX_DURATION) {
+                    log_msg("'-%d' Invalid spin wait budget: %s", OPT_SPIN_WAIT, optarg);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else {
+                    s_user_params.spin_wait_usec = (uint32_t)value;
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_SPIN_WAIT);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+
         if (!rc && aopt_check(common_obj, OPT_MC_LOOPBACK_ENABLE)) {
             s_user_params.mc_loop_disable = false;
         }
@@ -2090,6 +2350,56 @@ static int parse_common_opt(const AOPT_OBJECT *common_obj) {
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
+#ifdef __linux__
+        if (!rc && aopt_check(common_obj, OPT_RECVMMSG)) {
+            const char *optarg = aopt_value(common_obj, OPT_RECVMMSG);
+            if (optarg) {
+                errno = 0;
+                int value = strtol(optarg, NULL, 0);
+                if (errno != 0 || value <= 0 || value > MAX_RECVMMSG_NUM) {
+                    log_msg("'-%d' Invalid number of messages per recvmmsg() call: %s "
+                            "(must be 1..%d)", OPT_RECVMMSG, optarg, MAX_RECVMMSG_NUM);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else if (aopt_check(common_obj, OPT_ZCOPYREAD)) {
+                    log_msg("--recvmmsg conflicts with --zcopyread option");
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else {
+                    s_user_params.recvmmsg_num = value;
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_RECVMMSG);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+
+        if (!rc && aopt_check(common_obj, OPT_MEM_PREP)) {
+            const char *optarg = aopt_value(common_obj, OPT_MEM_PREP);
+            if (optarg && optarg[0]) {
+                char steps[MAX_ARGV_SIZE];
+                char *saveptr = NULL;
+                snprintf(steps, sizeof(steps), "%s", optarg);
+                for (char *step = strtok_r(steps, ",", &saveptr); step && !rc;
+                     step = strtok_r(NULL, ",", &saveptr)) {
+                    if (!strcmp(step, "prefault")) {
+                        s_user_params.mem_prep |= MEM_PREP_PREFAULT;
+                    } else if (!strcmp(step, "hugepages")) {
+                        s_user_params.mem_prep |= MEM_PREP_HUGEPAGES;
+                    } else if (!strcmp(step, "mlock")) {
+                        s_user_params.mem_prep |= MEM_PREP_MLOCK;
+                    } else if (!strcmp(step, "numa")) {
+                        s_user_params.mem_prep |= MEM_PREP_PREFAULT | MEM_PREP_NUMA;
+                    } else {
+                        log_msg("'-%d' Invalid memory preparation step: %s", OPT_MEM_PREP, step);
+                        rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                    }
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_MEM_PREP);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#endif // __linux__
+
         if (!rc && aopt_check(common_obj, OPT_DONTWARMUP)) {
             s_user_params.do_warmup = false;
         }
@@ -2293,6 +2603,25 @@ static int parse_client_opt(const AOPT_OBJECT *client_obj) {
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
+#ifndef __windows__
+        if (!rc && aopt_check(client_obj, OPT_FULL_LOG_BIN)) {
+            const char *optarg = aopt_value(client_obj, OPT_FULL_LOG_BIN);
+            if (s_user_params.b_stream) {
+                log_msg("--full-log-bin is not supported in throughput mode");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (optarg) {
+                s_user_params.full_log_bin_fd = open(optarg, O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if (s_user_params.full_log_bin_fd < 0) {
+                    log_msg("Invalid %d val. Can't open file %s for writing: %s",
+                            OPT_FULL_LOG_BIN, optarg, strerror(errno));
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_FULL_LOG_BIN);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#endif // __windows__
         if (!rc && aopt_check(client_obj, OPT_FULL_RTT)) {
             s_user_params.full_rtt = true;
         }
@@ -2343,6 +2672,134 @@ static int parse_client_opt(const AOPT_OBJECT *client_obj) {
                 rc = SOCKPERF_ERR_BAD_ARGUMENT;
             }
         }
+        if (!rc && aopt_check(client_obj, OPT_INTERVAL_REPORT)) {
+            const char *optarg = aopt_value(client_obj, OPT_INTERVAL_REPORT);
+            if (s_user_params.b_stream) {
+                log_msg("--interval-report is not supported in throughput mode");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (optarg) {
+                errno = 0;
+                long value = strtol(optarg, NULL, 0);
+                if (errno != 0 || value <= 0 || value > MAX_DURATION) {
+                    log_msg("'-%d' Invalid interval: %s", OPT_INTERVAL_REPORT, optarg);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else {
+                    s_user_params.interval_report_msec = (uint32_t)value;
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_INTERVAL_REPORT);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+        if (!rc && aopt_check(client_obj, OPT_PACING)) {
+            const char *optarg = aopt_value(client_obj, OPT_PACING);
+            char suffix; //< needed to check for garbage at the end
+            if (!optarg) {
+                log_msg("'-%d' Invalid value", OPT_PACING);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (!strcmp(optarg, "fixed")) {
+                s_user_params.pacing = PACING_FIXED;
+            } else if (!strcmp(optarg, "poisson")) {
+                s_user_params.pacing = PACING_POISSON;
+            } else if (!strcmp(optarg, "uniform")) {
+                s_user_params.pacing = PACING_UNIFORM;
+            } else if (!strncmp(optarg, "uniform:", 8) &&
+                       sscanf(optarg + 8, "%" PRIu32 "%c", &s_user_params.pacing_jitter,
+                              &suffix) == 1 &&
+                       s_user_params.pacing_jitter <= 100) {
+                s_user_params.pacing = PACING_UNIFORM;
+            } else if (!strncmp(optarg, "onoff:", 6) &&
+                       sscanf(optarg + 6, "%" PRIu32 ":%" PRIu32 "%c",
+                              &s_user_params.pacing_on_msec, &s_user_params.pacing_off_msec,
+                              &suffix) == 2 &&
+                       s_user_params.pacing_on_msec > 0) {
+                s_user_params.pacing = PACING_ONOFF;
+            } else {
+                log_msg("'-%d' Invalid pacing: %s", OPT_PACING, optarg);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#ifndef __windows__
+        if (!rc && aopt_check(client_obj, OPT_SLEEP_PACING)) {
+            const char *optarg = aopt_value(client_obj, OPT_SLEEP_PACING);
+            if (optarg) {
+                errno = 0;
+                long value = strtol(optarg, NULL, 0);
+                if (errno != 0 || value < 0 || value > MAX_DURATION) {
+                    log_msg("'-%d' Invalid spin time before send: %s", OPT_SLEEP_PACING, optarg);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else {
+                    s_user_params.b_sleep_pacing = true;
+                    s_user_params.pacing_spin_usec = (uint32_t)value;
+                }
+            } else {
+                log_msg("'-%d' Invalid value", OPT_SLEEP_PACING);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#endif // __windows__
+#ifdef __linux__
+        if (!rc && aopt_check(client_obj, OPT_SENDMMSG)) {
+            if (s_user_params.sock_type == SOCK_STREAM) {
+                log_msg("--sendmmsg conflicts with --tcp option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else {
+                s_user_params.is_sendmmsg = true;
+            }
+        }
+        if (!rc && aopt_check(client_obj, OPT_ZCOPY_SEND)) {
+            if (s_user_params.is_sendmmsg) {
+                log_msg("--zcopy-send conflicts with --sendmmsg option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+#if defined(DEFINED_TLS)
+            else if (s_user_params.tls) {
+                log_msg("--zcopy-send conflicts with --tls option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+#endif /* DEFINED_TLS */
+            else {
+                s_user_params.is_zcopy_send = true;
+            }
+        }
+        if (!rc && aopt_check(client_obj, OPT_TIMESTAMPING)) {
+            const char *optarg = aopt_value(client_obj, OPT_TIMESTAMPING);
+            if (s_user_params.b_stream) {
+                log_msg("--timestamping is not supported in throughput mode");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.is_sendmmsg || s_user_params.is_zcopy_send ||
+                       s_user_params.dummy_mps) {
+                log_msg("--timestamping conflicts with --sendmmsg, --zcopy-send and --dummy-send "
+                        "options");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.recvmmsg_num || s_user_params.is_zcopyread) {
+                log_msg("--timestamping conflicts with --recvmmsg and --zcopyread options");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.fd_handler_type == SOCKETXTREME
+#ifdef USING_IOURING
+                       || s_user_params.fd_handler_type == IOURING
+#endif // USING_IOURING
+                       ) {
+                log_msg("--timestamping is not supported with %s",
+                        handler2str(s_user_params.fd_handler_type));
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+#if defined(DEFINED_TLS)
+            else if (s_user_params.tls) {
+                log_msg("--timestamping conflicts with --tls option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+#endif /* DEFINED_TLS */
+            else if (!optarg || !strcmp(optarg, "sw")) {
+                s_user_params.tstamp_mode = TSTAMP_SOFTWARE;
+            } else if (!strcmp(optarg, "hw")) {
+                s_user_params.tstamp_mode = TSTAMP_HARDWARE;
+            } else {
+                log_msg("'-%d' Invalid value of timestamps source: %s", OPT_TIMESTAMPING, optarg);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+#endif // __linux__
     }
 
     return rc;
@@ -2403,6 +2860,11 @@ void cleanup() {
                 if (g_fds_array[ifd]->recv.buf) {
                     FREE(g_fds_array[ifd]->recv.buf);
                 }
+#ifdef __linux__
+                recvmmsg_slots_free(g_fds_array[ifd]->recv);
+                zcopy_slots_free(g_fds_array[ifd]->zcopy);
+                tstamp_slots_free(g_fds_array[ifd]->tstamp);
+#endif // __linux__
                 if (g_fds_array[ifd]->is_multicast) {
                     FREE(g_fds_array[ifd]->memberships_addr);
                 }
@@ -2440,6 +2902,11 @@ void cleanup() {
         FREE(g_fds_array);
     }
 
+    if (NULL != g_pIntervalReport) {
+        delete g_pIntervalReport;
+        g_pIntervalReport = NULL;
+    }
+
     if (NULL != g_pPacketTimes) {
         delete g_pPacketTimes;
         g_pPacketTimes = NULL;
@@ -2636,7 +3103,7 @@ inline bool CallbackMessageHandler<T>::handle_message()
         return true;
     }
 
-    g_receiveCount++;
+    thread_stats().receiveCount++;
 
     if (msgReply->getHeader()->isPongRequest()) {
         /* if server in a no reply mode - shift to start of cycle buffer*/
@@ -2698,6 +3165,18 @@ int sock_set_reuseaddr(int fd) {
     return rc;
 }
 
+#ifndef __windows__
+int sock_set_reuseport(int fd) {
+    int rc = SOCKPERF_ERR_NONE;
+    int reuseport_true = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuseport_true, sizeof(reuseport_true)) < 0) {
+        log_err("setsockopt(SO_REUSEPORT) failed");
+        rc = SOCKPERF_ERR_SOCKET;
+    }
+    return rc;
+}
+#endif // __windows__
+
 #ifndef SO_LL
 #define SO_LL 46
 #endif
@@ -2776,6 +3255,34 @@ int sock_set_tcp_nodelay(int fd) {
     return rc;
 }
 
+#ifdef __linux__
+int sock_set_zcopy(int fd, struct fds_data *p_data) {
+    int rc = SOCKPERF_ERR_NONE;
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) < 0) {
+        log_err("setsockopt(SO_ZEROCOPY) failed. It could be that this option is not supported "
+                "in your system or by the socket type");
+        rc = SOCKPERF_ERR_SOCKET;
+    } else if (!p_data->zcopy.hdrs) {
+        rc = zcopy_slots_alloc(p_data->zcopy, ZCOPY_SEND_SLOTS);
+    }
+    return rc;
+}
+
+int sock_set_udp_gro(int fd, struct fds_data *p_data) {
+    int rc = SOCKPERF_ERR_NONE;
+    int opt = 1;
+    if (setsockopt(fd, SOL_UDP, UDP_GRO, &opt, sizeof(opt)) < 0) {
+        log_err("setsockopt(UDP_GRO) failed. It could be that this option is not supported "
+                "in your system");
+        rc = SOCKPERF_ERR_SOCKET;
+    } else {
+        p_data->recv.gro = true;
+    }
+    return rc;
+}
+#endif // __linux__
+
 int sock_set_tos(int fd) {
     int rc = SOCKPERF_ERR_NONE;
     if (s_user_params.tos) {
@@ -3037,6 +3544,12 @@ int prepare_socket(int fd, struct fds_data *p_data)
         }
     }
 
+#ifndef __windows__
+    if (!rc && s_user_params.reuseport && s_user_params.mode == MODE_SERVER) {
+        rc = sock_set_reuseport(fd);
+    }
+#endif // __windows__
+
     if (!rc && (s_user_params.lls_is_set == true)) {
         rc = sock_set_lls(fd);
     }
@@ -3069,6 +3582,16 @@ int prepare_socket(int fd, struct fds_data *p_data)
         rc = sock_set_tos(fd);
     }
 
+#ifdef __linux__
+    if (!rc && s_user_params.is_zcopy_send) {
+        rc = sock_set_zcopy(fd, p_data);
+    }
+
+    if (!rc && s_user_params.is_udp_gro && (p_data->sock_type == SOCK_DGRAM)) {
+        rc = sock_set_udp_gro(fd, p_data);
+    }
+#endif // __linux__
+
 #ifdef USING_EXTRA_API
 #ifdef ST_TEST
     if (!stTest)
@@ -3402,8 +3925,14 @@ static int set_sockets_from_feedfile(const char *feedfile_name) {
                         tmp->recv.max_size = MAX_PAYLOAD_SIZE;
                         tmp->recv.cur_offset = 0;
                         tmp->recv.cur_size = tmp->recv.max_size;
+#ifdef __linux__
+                        if (new_socket_flag && s_user_params.recvmmsg_num &&
+                            tmp->sock_type == SOCK_DGRAM) {
+                            rc = recvmmsg_slots_alloc(tmp->recv, s_user_params.recvmmsg_num);
+                        }
+#endif // __linux__
 
-                        if (new_socket_flag) {
+                        if (!rc && new_socket_flag) {
                             if (s_fd_num == 1) { /*it is the first fd*/
                                 s_fd_min = curr_fd;
                                 s_fd_max = curr_fd;
@@ -3428,6 +3957,11 @@ static int set_sockets_from_feedfile(const char *feedfile_name) {
             if (tmp->recv.buf) {
                 FREE(tmp->recv.buf);
             }
+#ifdef __linux__
+            recvmmsg_slots_free(tmp->recv);
+            zcopy_slots_free(tmp->zcopy);
+            tstamp_slots_free(tmp->tstamp);
+#endif // __linux__
         }
     }
 #ifdef NEED_REGEX_WORKAROUND
@@ -3517,6 +4051,174 @@ static bool fds_array_is_valid() {
     return ((fd == s_fd_max) && ((i + 1) == s_fd_num) && (g_fds_array[fd]->next_fd == s_fd_min));
 }
 
+#ifndef __windows__
+#ifdef __linux__
+//------------------------------------------------------------------------------
+/* Steer every message to the socket of the group with the index of the receiving CPU */
+static int sock_attach_reuseport_cpu(int fd, int threads_num) {
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU)),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)threads_num),
+        BPF_STMT(BPF_RET | BPF_A, 0)
+    };
+    struct sock_fprog prog = { (unsigned short)(sizeof(code) / sizeof(code[0])), code };
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        log_err("setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed");
+        return SOCKPERF_ERR_SOCKET;
+    }
+    return SOCKPERF_ERR_NONE;
+}
+#endif // __linux__
+
+//------------------------------------------------------------------------------
+/* --reuseport: open a socket of every address for every thread of the server.
+ * Copies are placed above all existing descriptors, so splitting the fd range between threads
+ * gives every thread one socket of every address. All sockets are bound (and TCP sockets
+ * listen, that is when they join the group) here in the order of threads, that is the index
+ * of the socket in its SO_REUSEPORT group.
+ */
+static int reuseport_sockets() {
+    int rc = SOCKPERF_ERR_NONE;
+    const int base_fd_min = s_fd_min;
+    const int base_fd_max = s_fd_max;
+    const int threads_num = s_user_params.threads_num;
+    int last_fd = s_fd_max;
+
+    for (int ifd = base_fd_min; ifd <= base_fd_max; ifd++) {
+        if (g_fds_array[ifd] && (g_fds_array[ifd]->is_multicast ||
+                                 g_fds_array[ifd]->server_addr.addr.sa_family == AF_UNIX)) {
+            log_msg("--reuseport supports unicast IP addresses only");
+            return SOCKPERF_ERR_BAD_ARGUMENT;
+        }
+    }
+
+    for (int copy = 1; !rc && copy < threads_num; copy++) {
+        for (int ifd = base_fd_min; !rc && ifd <= base_fd_max; ifd++) {
+            if (!g_fds_array[ifd]) {
+                continue;
+            }
+            std::unique_ptr<fds_data> tmp{ new fds_data };
+            tmp->server_addr = g_fds_array[ifd]->server_addr;
+            tmp->server_addr_len = g_fds_array[ifd]->server_addr_len;
+            tmp->sock_type = g_fds_array[ifd]->sock_type;
+            tmp->active_fd_list = (int *)MALLOC(MAX_ACTIVE_FD_NUM * sizeof(int));
+            tmp->recv.buf = (uint8_t *)MALLOC(sizeof(uint8_t) * 2 * MAX_PAYLOAD_SIZE);
+            if (!tmp->active_fd_list || !tmp->recv.buf) {
+                log_err("Failed to allocate memory with malloc()");
+                rc = SOCKPERF_ERR_NO_MEMORY;
+            } else {
+                for (int i = 0; i < MAX_ACTIVE_FD_NUM; i++) {
+                    tmp->active_fd_list[i] = (int)INVALID_SOCKET;
+                }
+                tmp->recv.cur_addr = tmp->recv.buf;
+                tmp->recv.max_size = MAX_PAYLOAD_SIZE;
+                tmp->recv.cur_offset = 0;
+                tmp->recv.cur_size = tmp->recv.max_size;
+#ifdef __linux__
+                if (s_user_params.recvmmsg_num && tmp->sock_type == SOCK_DGRAM) {
+                    rc = recvmmsg_slots_alloc(tmp->recv, s_user_params.recvmmsg_num);
+                }
+#endif // __linux__
+            }
+
+            int curr_fd = (int)INVALID_SOCKET;
+            if (!rc) {
+                int fd = (int)socket(tmp->server_addr.addr.sa_family, tmp->sock_type, 0);
+                if (fd >= 0) {
+                    curr_fd = fcntl(fd, F_DUPFD, s_fd_max + 1);
+                    close(fd);
+                }
+                if (curr_fd < 0) {
+                    log_err("socket(AF_INET4/6, SOCK_x)");
+                    rc = SOCKPERF_ERR_SOCKET;
+                } else if ((curr_fd >= max_fds_num) ||
+                           (prepare_socket(curr_fd, tmp.get()) == (int)INVALID_SOCKET)) {
+                    log_err("Invalid socket");
+                    close(curr_fd);
+                    rc = SOCKPERF_ERR_SOCKET;
+                }
+            }
+
+            if (rc) {
+                if (tmp->active_fd_list) {
+                    FREE(tmp->active_fd_list);
+                }
+                if (tmp->recv.buf) {
+                    FREE(tmp->recv.buf);
+                }
+#ifdef __linux__
+                recvmmsg_slots_free(tmp->recv);
+#endif // __linux__
+                break;
+            }
+            g_fds_array[last_fd]->next_fd = curr_fd;
+            last_fd = s_fd_max = curr_fd;
+            s_fd_num++;
+            g_fds_array[curr_fd] = tmp.release();
+        }
+    }
+    g_fds_array[last_fd]->next_fd = s_fd_min;
+
+    for (int ifd = s_fd_min; !rc && ifd <= s_fd_max; ifd++) {
+        if (!g_fds_array[ifd]) {
+            continue;
+        }
+        if (bind(ifd, reinterpret_cast<const sockaddr *>(&g_fds_array[ifd]->server_addr),
+                 g_fds_array[ifd]->server_addr_len) < 0) {
+            log_err("[fd=%d] Can`t bind socket, IP to bind: %s\n", ifd,
+                    sockaddr_to_hostport(g_fds_array[ifd]->server_addr).c_str());
+            rc = SOCKPERF_ERR_SOCKET;
+        }
+    }
+
+    for (int ifd = s_fd_min; !rc && ifd <= s_fd_max; ifd++) {
+        if (g_fds_array[ifd] && (g_fds_array[ifd]->sock_type == SOCK_STREAM) &&
+            (listen(ifd, 10) < 0)) {
+            log_err("[fd=%d] Failed listen() for connection", ifd);
+            rc = SOCKPERF_ERR_SOCKET;
+        }
+    }
+
+#ifdef __linux__
+    /* the program indexes the group, so it is attached when all sockets have joined it */
+    for (int ifd = base_fd_min; !rc && ifd <= base_fd_max; ifd++) {
+        if (g_fds_array[ifd] && s_user_params.reuseport == REUSEPORT_CPU) {
+            rc = sock_attach_reuseport_cpu(ifd, threads_num);
+        }
+    }
+#endif // __linux__
+
+    return rc;
+}
+#endif // __windows__
+
+#ifdef __linux__
+//------------------------------------------------------------------------------
+/* --mem-prep: take page faults of measurement buffers before the test instead of during it.
+ * Timestamp arrays are touched when PacketTimes is created; _start is taken before that.
+ */
+static int prepare_memory(const TicksTime &_start) {
+    if ((s_user_params.mem_prep & MEM_PREP_PREFAULT) && !(s_user_params.mem_prep & MEM_PREP_NUMA)) {
+        mem_prefault_fds(0, max_fds_num - 1);
+    }
+    if (s_user_params.mem_prep & MEM_PREP_MLOCK) {
+        int flags = MCL_CURRENT | MCL_FUTURE;
+        if (s_user_params.mem_prep & MEM_PREP_NUMA) {
+            flags |= MCL_ONFAULT; // do not fault buffers in before their threads are pinned
+        }
+        if (mlockall(flags)) {
+            log_err("mlockall() failed, check RLIMIT_MEMLOCK (ulimit -l)");
+            return SOCKPERF_ERR_FATAL;
+        }
+    }
+    log_msg("Memory preparation took %.3lf msec",
+            (TicksTime::now() - _start).toDecimalUsec() / 1000);
+
+    return SOCKPERF_ERR_NONE;
+}
+#endif // __linux__
+
 //------------------------------------------------------------------------------
 int bringup(const int *p_daemonize) {
     int rc = SOCKPERF_ERR_NONE;
@@ -3657,7 +4359,13 @@ int bringup(const int *p_daemonize) {
                             tmp->recv.max_size = MAX_PAYLOAD_SIZE;
                             tmp->recv.cur_offset = 0;
                             tmp->recv.cur_size = tmp->recv.max_size;
-
+#ifdef __linux__
+                            if (s_user_params.recvmmsg_num && tmp->sock_type == SOCK_DGRAM) {
+                                rc = recvmmsg_slots_alloc(tmp->recv, s_user_params.recvmmsg_num);
+                            }
+#endif // __linux__
+                        }
+                        if (!rc) {
                             s_fd_min = s_fd_max = curr_fd;
                             g_fds_array[s_fd_min] = tmp.release();
                             g_fds_array[s_fd_min]->next_fd = s_fd_min;
@@ -3674,24 +4382,128 @@ int bringup(const int *p_daemonize) {
                 if (tmp->recv.buf) {
                     FREE(tmp->recv.buf);
                 }
+#ifdef __linux__
+                recvmmsg_slots_free(tmp->recv);
+                zcopy_slots_free(tmp->zcopy);
+                tstamp_slots_free(tmp->tstamp);
+#endif // __linux__
             }
         }
 
+#ifndef __windows__
+        if (!rc && s_user_params.reuseport) {
+            rc = reuseport_sockets();
+        }
+#endif // __windows__
+
         if (!rc && !fds_array_is_valid()) {
             log_err("Sanity check failed for sockets list");
             rc = SOCKPERF_ERR_FATAL;
         }
 
-        if (!rc && (s_user_params.threads_num > s_fd_num || s_user_params.threads_num == 0)) {
+        // with --tcp-rebalance threads without sockets get connections from the accepting ones
+        if (!rc && ((s_user_params.threads_num > s_fd_num && !s_user_params.tcp_rebalance) ||
+                    s_user_params.threads_num == 0)) {
             log_msg("Number of threads should be less than sockets count");
             rc = SOCKPERF_ERR_BAD_ARGUMENT;
         }
 
+        if (!rc && s_user_params.tcp_rebalance &&
+            (s_user_params.fd_handler_type == RECVFROM ||
+             s_user_params.fd_handler_type == RECVFROMMUX ||
+#ifdef USING_IOURING
+             s_user_params.fd_handler_type == IOURING ||
+#endif // USING_IOURING
+             s_user_params.fd_handler_type == SOCKETXTREME)) {
+            log_msg("--tcp-rebalance is not supported with %s",
+                    handler2str(s_user_params.fd_handler_type));
+            rc = SOCKPERF_ERR_BAD_ARGUMENT;
+        }
+
+        if (!rc && s_user_params.spin_wait_usec &&
+            (s_user_params.fd_handler_type == RECVFROM ||
+             s_user_params.fd_handler_type == RECVFROMMUX ||
+#ifdef USING_IOURING
+             s_user_params.fd_handler_type == IOURING ||
+#endif // USING_IOURING
+             s_user_params.fd_handler_type == SOCKETXTREME)) {
+            log_msg("--spin-wait is not supported with %s (use --nonblocked to spin on receive)",
+                    handler2str(s_user_params.fd_handler_type));
+            rc = SOCKPERF_ERR_BAD_ARGUMENT;
+        }
+
         if (!rc && s_user_params.dummy_mps && s_user_params.mps >= s_user_params.dummy_mps) {
             log_err(
                 "Dummy send is allowed only if dummy-send rate is higher than regular msg rate");
             rc = SOCKPERF_ERR_BAD_ARGUMENT;
         }
+
+        if (!rc && s_user_params.b_sleep_pacing) {
+            if (s_user_params.mps == UINT32_MAX && !s_user_params.pPlaybackReader) {
+                log_err("--sleep-pacing requires limited --mps");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.dummy_mps) {
+                log_err("--sleep-pacing conflicts with --dummy-send option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            }
+        }
+
+        if (!rc && s_user_params.outstanding) {
+            if (s_user_params.pPlaybackReader) {
+                log_err("--outstanding conflicts with --playback option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.is_sendmmsg) {
+                log_err("--outstanding conflicts with --sendmmsg option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.client_work_with_srv_num > 1) {
+                // replies of every server would trigger a request and open the window
+                log_err("--outstanding supports a single server only");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if ((uint64_t)s_user_params.outstanding * s_fd_num >
+                       MAX_PACKET_TIMES_WINDOW / 2) {
+                // requests in flight must not be retired by the ring of packet times
+                log_err("--outstanding %u is too large for %d connections (max %d in total)",
+                        s_user_params.outstanding, s_fd_num, MAX_PACKET_TIMES_WINDOW / 2);
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else {
+                bool is_udp = false;
+                for (int ifd = s_fd_min; ifd <= s_fd_max; ifd++) {
+                    is_udp |= (g_fds_array[ifd] && g_fds_array[ifd]->sock_type == SOCK_DGRAM);
+                }
+                bool is_recvfrom = (s_user_params.fd_handler_type == RECVFROM ||
+                                    s_user_params.fd_handler_type == RECVFROMMUX);
+                // lost requests are found between receives, so receive must not block forever
+                if (is_udp && is_recvfrom && s_user_params.is_blocked) {
+                    log_err("--outstanding over UDP requires --nonblocked with %s",
+                            handler2str(s_user_params.fd_handler_type));
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                } else if (is_udp && !is_recvfrom && !s_user_params.select_timeout) {
+                    log_err("--outstanding over UDP requires finite --timeout");
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                }
+            }
+        }
+
+        if (!rc && s_user_params.pacing != PACING_FIXED) {
+            if (s_user_params.mps == UINT32_MAX) {
+                log_err("--pacing requires limited --mps");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.dummy_mps) {
+                log_err("--pacing conflicts with --dummy-send option");
+                rc = SOCKPERF_ERR_BAD_ARGUMENT;
+            } else if (s_user_params.pacing == PACING_ONOFF) {
+                int64_t cycleDurationNsec =
+                    NSEC_IN_SEC * s_user_params.burst_size / s_user_params.mps;
+                int64_t periodNsec = NSEC_IN_MSEC * ((int64_t)s_user_params.pacing_on_msec +
+                                                     s_user_params.pacing_off_msec);
+                if (periodNsec / cycleDurationNsec < 1 ||
+                    periodNsec / cycleDurationNsec > PACING_MAX_GAPS) {
+                    log_err("--pacing onoff period should contain 1..%d send cycles",
+                            PACING_MAX_GAPS);
+                    rc = SOCKPERF_ERR_BAD_ARGUMENT;
+                }
+            }
+        }
     }
 
     /* Setup internal data */
@@ -3742,8 +4554,8 @@ int bringup(const int *p_daemonize) {
             _maxSequenceNo = TEST_START_WARMUP_NUM + MAX_PACKET_NUMBER + TEST_END_COOLDOWN_NUM;
         }
 
-        if (s_user_params.pPlaybackVector) {
-            _maxSequenceNo = s_user_params.pPlaybackVector->size();
+        if (s_user_params.pPlaybackReader) {
+            _maxSequenceNo = s_user_params.pPlaybackReader->maxItems();
         }
 
         /* SERVER does not have info about max number of expected packets */
@@ -3753,11 +4565,29 @@ int bringup(const int *p_daemonize) {
 
         Message::initMaxSeqNo(_maxSequenceNo);
 
+        TicksTime memPrepStart = TicksTime::now();
         if (!s_user_params.b_stream && s_user_params.mode == MODE_CLIENT) {
             g_pPacketTimes = new PacketTimes(_maxSequenceNo, s_user_params.reply_every,
-                                             s_user_params.client_work_with_srv_num);
+                                             s_user_params.client_work_with_srv_num,
+                                             s_user_params.tstamp_mode != TSTAMP_NONE,
+                                             s_user_params.b_intended_time,
+                                             s_user_params.pPlaybackReader != NULL,
+                                             (s_user_params.mem_prep & MEM_PREP_HUGEPAGES) != 0);
+            if (s_user_params.interval_report_msec) {
+                g_pIntervalReport = new IntervalReport(s_user_params.interval_report_msec,
+                                                       s_user_params.reply_every,
+                                                       s_user_params.client_work_with_srv_num);
+            }
         }
 
+#ifdef __linux__
+        if (s_user_params.mem_prep) {
+            rc = prepare_memory(memPrepStart);
+        }
+#else
+        (void)memPrepStart;
+#endif // __linux__
+
         os_set_signal_action(SIGINT, s_user_params.mode ? server_sig_handler : client_sig_handler);
     }
 
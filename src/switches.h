@@ -79,6 +79,33 @@ private:
     int m_range_msg_size;
 };
 
+//==============================================================================
+/* --sleep-pacing: a send cycle sleeps till the spin margin before its deadline and busy waits
+ * only for the rest of the gap, so low rate tests do not take a whole core. Lateness of every
+ * wakeup against its deadline is collected for the pacing error report.
+ */
+class PacingSleep {
+public:
+    static uint64_t wait(const TicksTime &_deadline); // returns number of sleeps and time takings
+    static void print_summary();
+};
+
+//------------------------------------------------------------------------------
+// wait till _deadline of the next cycle, returns number of time takings (and sleeps)
+static inline uint64_t cycle_wait(const TicksTime &_deadline) {
+    if (unlikely(g_pApp->m_const_params.b_sleep_pacing)) {
+        return PacingSleep::wait(_deadline);
+    }
+    uint64_t loops = 0;
+    while (!g_b_exit) {
+        if (TicksTime::now() >= _deadline) {
+            break;
+        }
+        loops++; // count delta between time takings vs. num of cycles
+    }
+    return loops;
+}
+
 //==============================================================================
 class SwitchOnCycleDuration {
 public:
@@ -86,14 +113,31 @@ public:
     inline void execute(Message *, int) {
 
         TicksTime nextCycleStartTime = g_cycleStartTime + g_pApp->m_const_params.cycleDuration;
-        while (!g_b_exit) {
-            if (TicksTime::now() >= nextCycleStartTime) {
-                break;
-            }
-            g_cycle_wait_loop_counter++; // count delta between time takings vs. num of cycles
+        thread_stats().cycleWaitLoopCounter += cycle_wait(nextCycleStartTime);
+        g_cycleStartTime = nextCycleStartTime;
+    }
+};
+
+//==============================================================================
+class SwitchOnCyclePattern {
+public:
+    SwitchOnCyclePattern(); // builds gaps table according to --pacing
+
+    // busy wait till next cycle starting point; cycles follow precomputed table of gaps
+    // which has the same mean as cycleDuration
+    inline void execute(Message *, int) {
+        TicksTime nextCycleStartTime = g_cycleStartTime + m_gaps[m_next];
+        if (++m_next == m_gapsNum) {
+            m_next = 0;
         }
+        thread_stats().cycleWaitLoopCounter += cycle_wait(nextCycleStartTime);
         g_cycleStartTime = nextCycleStartTime;
     }
+
+private:
+    std::vector<TicksDuration> m_gaps;
+    size_t m_gapsNum;
+    size_t m_next;
 };
 
 //=============================================================================
@@ -117,6 +161,7 @@ public:
             sendto_addr = NULL;
             addrlen = 0;
         }
+        uint64_t loops = 0;
         while (!g_b_exit) {
             now = TicksTime::now();
             if (now >= nextCycleStartTime) {
@@ -131,8 +176,9 @@ public:
                 nextDummySendTime += g_pApp->m_const_params.dummySendCycleDuration;
             }
 
-            g_cycle_wait_loop_counter++; // count delta between time takings vs. num of cycles
+            loops++; // count delta between time takings vs. num of cycles
         }
+        thread_stats().cycleWaitLoopCounter += loops;
 
         g_cycleStartTime = nextCycleStartTime;
     }
@@ -153,6 +199,10 @@ public:
         if (m_pMsgRequest->getSequenceCounter() % g_pApp->m_const_params.reply_every == 0) {
             m_pMsgRequest->getHeader()->setPongRequest();
             g_pPacketTimes->setTxTime(m_pMsgRequest->getSequenceCounter());
+#ifdef __linux__
+            bool is_tstamp = (unlikely(g_fds_array[ifd]->tstamp.keys) &&
+                              tstamp_tx_push(ifd, m_pMsgRequest->getSequenceCounter(), length));
+#endif // __linux__
             m_pMsgRequest->setHeaderToNetwork();
             int ret = ::msg_sendto(ifd, m_pMsgRequest->getBuf(), length,
                     &reinterpret_cast<sockaddr &>(g_fds_array[ifd]->server_addr), g_fds_array[ifd]->server_addr_len);
@@ -161,6 +211,11 @@ public:
             if (ret == RET_SOCKET_SKIPPED) {
                 g_pPacketTimes->clearTxTime(m_pMsgRequest->getSequenceCounter());
             }
+#ifdef __linux__
+            if (is_tstamp && ret <= 0) {
+                tstamp_tx_cancel(ifd);
+            }
+#endif // __linux__
             m_pMsgRequest->getHeader()->resetPongRequest();
             return ret;
         } else {
@@ -172,6 +227,23 @@ public:
         }
     }
 
+    // copy network ordered header of the current message into batch slot,
+    // returns true in case tx time was taken for this message
+    inline bool msg_header_copy(uint8_t *dst) {
+        bool is_pong = (m_pMsgRequest->getSequenceCounter() % g_pApp->m_const_params.reply_every == 0);
+        if (is_pong) {
+            m_pMsgRequest->getHeader()->setPongRequest();
+            g_pPacketTimes->setTxTime(m_pMsgRequest->getSequenceCounter());
+        }
+        m_pMsgRequest->setHeaderToNetwork();
+        memcpy(dst, m_pMsgRequest->getBuf(), MsgHeader::EFFECTIVE_SIZE);
+        m_pMsgRequest->setHeaderToHost();
+        if (is_pong) {
+            m_pMsgRequest->getHeader()->resetPongRequest();
+        }
+        return is_pong;
+    }
+
 private:
     Message *m_pMsgRequest;
 };
@@ -188,6 +260,10 @@ public:
     inline int msg_sendto(int ifd) {
         int length = m_pMsgRequest->getLength();
         g_pPacketTimes->setTxTime(m_pMsgRequest->getSequenceCounter());
+#ifdef __linux__
+        bool is_tstamp = (unlikely(g_fds_array[ifd]->tstamp.keys) &&
+                          tstamp_tx_push(ifd, m_pMsgRequest->getSequenceCounter(), length));
+#endif // __linux__
         m_pMsgRequest->setHeaderToNetwork();
         int ret = ::msg_sendto(ifd, m_pMsgRequest->getBuf(), length,
                 &reinterpret_cast<sockaddr &>(g_fds_array[ifd]->server_addr), g_fds_array[ifd]->server_addr_len);
@@ -196,9 +272,22 @@ public:
         if (ret == RET_SOCKET_SKIPPED) {
             g_pPacketTimes->clearTxTime(m_pMsgRequest->getSequenceCounter());
         }
+#ifdef __linux__
+        if (is_tstamp && ret <= 0) {
+            tstamp_tx_cancel(ifd);
+        }
+#endif // __linux__
         return ret;
     }
 
+    inline bool msg_header_copy(uint8_t *dst) {
+        g_pPacketTimes->setTxTime(m_pMsgRequest->getSequenceCounter());
+        m_pMsgRequest->setHeaderToNetwork();
+        memcpy(dst, m_pMsgRequest->getBuf(), MsgHeader::EFFECTIVE_SIZE);
+        m_pMsgRequest->setHeaderToHost();
+        return true;
+    }
+
 private:
     Message *m_pMsgRequest;
 };
@@ -221,6 +310,13 @@ public:
         return ret;
     }
 
+    inline bool msg_header_copy(uint8_t *dst) {
+        m_pMsgRequest->setHeaderToNetwork();
+        memcpy(dst, m_pMsgRequest->getBuf(), MsgHeader::EFFECTIVE_SIZE);
+        m_pMsgRequest->setHeaderToHost();
+        return false;
+    }
+
 private:
     Message *m_pMsgRequest;
 };
@@ -229,7 +325,13 @@ private:
 //==============================================================================
 class SwitchOnActivityInfo {
 public:
+    SwitchOnActivityInfo() : m_printHeader(0) {}
     /*inline*/ void execute(uint64_t counter);
+
+private:
+    // every thread of the server reports rate of its own messages
+    TicksTime m_lastTicks; // TICKS0 - the interval starts at g_lastTicks
+    int m_printHeader;
 };
 
 //==============================================================================
@@ -265,11 +367,11 @@ public:
 
     static void print_summary() {
         seq_num_map::iterator itr;
-        seq_num_map *p_seq_num_map = &ms_seq_num_map;
 
-        if (!p_seq_num_map) return;
-        for (itr = p_seq_num_map->begin(); itr != p_seq_num_map->end(); itr++) {
-            print_session_summary(&(itr->second));
+        for (Sessions *p = ms_pSessionsList.load(std::memory_order_acquire); p; p = p->next) {
+            for (itr = p->map.begin(); itr != p->map.end(); itr++) {
+                print_session_summary(&(itr->second));
+            }
         }
     }
 
@@ -316,7 +418,16 @@ private:
         }
     }
 
-    static seq_num_map ms_seq_num_map;
+    // sessions of a thread of the server (messages of a client are handled by one thread),
+    // allocated on first use and never freed, like thread_stats_t
+    struct Sessions {
+        seq_num_map map;
+        Sessions *next;
+    };
+    static Sessions &sessions();
+
+    static thread_local Sessions *ms_pSessions;
+    static std::atomic<Sessions *> ms_pSessionsList;
 };
 
 #endif /* SWITCHES_H_ */
@@ -107,6 +107,7 @@ with simple integral values. The following describes these calculations:
 // usefull constants
 static const int64_t USEC_IN_SEC = 1000 * 1000;
 static const int64_t NSEC_IN_MSEC = 1000 * 1000;
+static const int64_t NSEC_IN_USEC = 1000;
 
 //------------------------------------------------------------------------------
 // utility functions
@@ -211,6 +212,11 @@ public:
     // (in addition clock accuracy is 1usec)
     static bool init(Mode _mode = RDTSC);
 
+    // rate of raw ticks (see TicksTime::toTicks())
+    inline static int64_t getTicksPerSec() {
+        return ms_mode == RDTSC ? TicksImplRdtsc::TICKS_PER_SEC : NSEC_IN_SEC;
+    }
+
     //------------------------------------------------------------------------------
 protected:
     static Mode ms_mode;
@@ -384,6 +390,22 @@ public:
     }
     TicksTime &setNowNonInline(); // provide non inline function for reducing code size outside fast
                                   // path
+#ifdef __linux__
+    // convert recent CLOCK_REALTIME based timestamp (such as kernel SO_TIMESTAMPING time) by
+    // its distance from now, so drift between the clocks does not matter
+    inline static TicksTime fromRealtime(const struct timespec &_val) {
+        struct timespec before, after;
+        TicksTime ticks;
+        // retry in case the thread was interrupted between the readings
+        for (int i = 0; i < 3; i++) {
+            clock_gettime(CLOCK_REALTIME, &before);
+            ticks.setNow();
+            clock_gettime(CLOCK_REALTIME, &after);
+            if (timespec2nsec(after) - timespec2nsec(before) < NSEC_IN_USEC) break;
+        }
+        return ticks - TicksDuration(timespec2nsec(after) - timespec2nsec(_val));
+    }
+#endif // __linux__
     inline TicksDuration durationTillNow() {
         return TicksDuration(getCurrentTicks() - m_ticks, true);
     }
@@ -419,6 +441,7 @@ public:
     // time
     // and consider it as duration since some base point!!
     inline int64_t debugToNsec() const { return ticks2nsec(m_ticks); }
+    inline ticks_t toTicks() const { return m_ticks; } // raw value, see getTicksPerSec()
 
     //------------------------------------------------------------------------------
 private:
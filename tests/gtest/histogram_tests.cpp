@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+
+#include "histogram.h"
+
+// worst relative error of a value reported from a histogram bucket
+static const double HISTOGRAM_PRECISION = 1.0 / (1 << HISTOGRAM_SUB_BUCKET_BITS);
+
+static void expectNear(double expected, double actual)
+{
+    EXPECT_NEAR(expected, actual, expected * HISTOGRAM_PRECISION + 1);
+}
+
+TEST(LatencyHistogramTest, empty)
+{
+    LatencyHistogram hist;
+
+    EXPECT_EQ(0u, hist.count());
+    EXPECT_EQ(0u, hist.valueAtRank(0));
+    EXPECT_EQ(0, hist.stdDev());
+    EXPECT_EQ(0, hist.medianad());
+}
+
+TEST(LatencyHistogramTest, exactForSmallValues)
+{
+    LatencyHistogram hist;
+
+    for (uint64_t value = 0; value < 1000; value++) {
+        hist.record(value);
+    }
+    for (uint64_t rank = 0; rank < 1000; rank++) {
+        EXPECT_EQ(rank, hist.valueAtRank(rank));
+    }
+    EXPECT_EQ(499500u, hist.sum());
+    EXPECT_EQ(249u, hist.percentile(0.25));
+}
+
+TEST(LatencyHistogramTest, matchesSortedSamples)
+{
+    LatencyHistogram hist;
+    std::vector<uint64_t> samples;
+    uint64_t seed = 12345;
+
+    // long tailed distribution from 1 usec up to few seconds
+    for (int i = 0; i < 100000; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        double uniform = (double)(seed >> 11) / (double)(1ULL << 53);
+        uint64_t value = 1000 + (uint64_t)(1000 * std::pow(10.0, 6 * uniform * uniform * uniform));
+        samples.push_back(value);
+        hist.record(value);
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t size = samples.size();
+
+    EXPECT_EQ(size, hist.count());
+    EXPECT_EQ(samples.front(), hist.min());
+    EXPECT_EQ(samples.back(), hist.max());
+
+    const double percentile[] = { 0.99999, 0.9999, 0.999, 0.99, 0.90, 0.75, 0.50, 0.25 };
+    for (size_t i = 0; i < sizeof(percentile) / sizeof(percentile[0]); i++) {
+        size_t index = (size_t)(0.5 + percentile[i] * size) - 1;
+        expectNear((double)samples[index], (double)hist.percentile(percentile[i]));
+    }
+
+    double mean = 0;
+    for (size_t i = 0; i < size; i++) mean += samples[i];
+    mean /= size;
+    double sumSqr = 0;
+    double sumAbs = 0;
+    for (size_t i = 0; i < size; i++) {
+        sumSqr += (samples[i] - mean) * (samples[i] - mean);
+        sumAbs += std::fabs(samples[i] - mean);
+    }
+    EXPECT_NEAR(std::sqrt(sumSqr / (size - 1)), hist.stdDev(), 1e-6 * hist.stdDev());
+    expectNear(sumAbs / size, hist.mad());
+
+    double median = (samples[size / 2 - 1] + samples[size / 2]) / 2.0;
+    std::vector<double> deviations;
+    for (size_t i = 0; i < size; i++) {
+        deviations.push_back(std::fabs(samples[i] - median));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    double medianad = (deviations[size / 2 - 1] + deviations[size / 2]) / 2 * 1.48260221851;
+    EXPECT_NEAR(medianad, hist.medianad(), 2 * median * HISTOGRAM_PRECISION * 1.48260221851 + 2);
+
+    size_t p75 = (size_t)(0.5 + .75 * size) - 1;
+    size_t p25 = (size_t)(0.5 + .25 * size) - 1;
+    expectNear(((double)samples[p75] - (double)samples[p25]) / 2, hist.siqr());
+}
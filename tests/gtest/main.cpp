@@ -37,6 +37,10 @@ GTEST_API_ int main(int argc, char **argv)
   testing::InitGoogleTest(&argc, argv);
   Message::initMaxSize(MAX_PAYLOAD_SIZE);
   Message::initMaxSeqNo(65535);
+#if !defined(__windows__) && !defined(__FreeBSD__) && !defined(__APPLE__)
+  // libc functions for the file access of the tested code
+  vma_xlio_try_set_func_pointers();
+#endif
 
   char *str = getenv("GTEST_TAP");
   // Append TAP Listener
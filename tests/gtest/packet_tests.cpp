@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+
+#include "packet.h"
+
+// packet.cpp is linked without common.cpp, tests do not use huge pages
+void *mem_alloc_huge(size_t size) {
+    (void)size;
+    return NULL;
+}
+
+void mem_free_huge(void *addr, size_t size) {
+    (void)addr;
+    (void)size;
+}
+
+struct RetiredBlock {
+    uint64_t seqNo;
+    TicksTime txTime;
+    TicksTime rxTime;
+};
+
+static std::vector<RetiredBlock> s_retired;
+
+static void collect(uint64_t _seqNo, const TicksTime *_times, const TicksTime *_kernelTimes,
+                    const TicksTime *_intendedTime, int _stream) {
+    (void)_kernelTimes;
+    (void)_intendedTime;
+    (void)_stream;
+    RetiredBlock block = { _seqNo, _times[0], _times[1] };
+    s_retired.push_back(block);
+}
+
+class PacketTimesTest : public testing::Test {
+protected:
+    virtual void SetUp() { s_retired.clear(); }
+};
+
+TEST_F(PacketTimesTest, publishAndDrain)
+{
+    // 8 blocks in the ring
+    PacketTimes times(7, 1, 1);
+    times.setConsumer(collect);
+    ASSERT_EQ(8u, times.m_windowSize);
+
+    std::map<uint64_t, TicksTime> rxTimes;
+    for (uint64_t seq = 1; seq <= 5; seq++) {
+        times.setTxTime(seq);
+        EXPECT_TRUE(times.isInWindow(seq));
+        EXPECT_NE(TicksTime::TICKS0, times.getTxTime(seq));
+    }
+    for (uint64_t seq = 1; seq <= 5; seq += 2) {
+        rxTimes[seq] = TicksTime().setNow();
+        EXPECT_TRUE(times.setRxTime(seq, rxTimes[seq]));
+    }
+    // duplicate reply is counted and not stored
+    EXPECT_FALSE(times.setRxTime(3));
+    EXPECT_EQ(1u, times.getDupCount(0));
+    EXPECT_EQ(rxTimes[3], times.getRxTimeArray(3)[0]);
+    EXPECT_EQ(5u, times.getLastSeqNo());
+    EXPECT_TRUE(s_retired.empty());
+
+    times.flush();
+    ASSERT_EQ(5u, s_retired.size());
+    for (uint64_t i = 0; i < 5; i++) {
+        const RetiredBlock &block = s_retired[i];
+        EXPECT_EQ(i + 1, block.seqNo);
+        EXPECT_NE(TicksTime::TICKS0, block.txTime);
+        if (block.seqNo % 2) {
+            EXPECT_EQ(rxTimes[block.seqNo], block.rxTime);
+        } else {
+            EXPECT_EQ(TicksTime::TICKS0, block.rxTime);
+        }
+        EXPECT_FALSE(times.isInWindow(block.seqNo));
+    }
+}
+
+TEST_F(PacketTimesTest, wraparound)
+{
+    PacketTimes times(7, 1, 1);
+    times.setConsumer(collect);
+
+    for (uint64_t seq = 1; seq <= 8; seq++) {
+        times.setTxTime(seq);
+    }
+    EXPECT_TRUE(times.setRxTime(1));
+    EXPECT_TRUE(s_retired.empty());
+
+    // 9 takes the block of 1 that is retired with its reply
+    times.setTxTime(9);
+    ASSERT_EQ(1u, s_retired.size());
+    EXPECT_EQ(1u, s_retired[0].seqNo);
+    EXPECT_NE(TicksTime::TICKS0, s_retired[0].rxTime);
+    EXPECT_FALSE(times.isInWindow(1));
+    EXPECT_TRUE(times.isInWindow(9));
+    EXPECT_EQ(TicksTime::TICKS0, times.getRxTimeArray(9)[0]);
+
+    // late reply of a retired block is ignored
+    EXPECT_FALSE(times.setRxTime(1));
+    EXPECT_EQ(TicksTime::TICKS0, times.getRxTimeArray(9)[0]);
+    EXPECT_EQ(TicksTime::TICKS0, times.getTxTime(1));
+
+    // flush retires the rest from the oldest one
+    times.flush();
+    ASSERT_EQ(9u, s_retired.size());
+    for (uint64_t i = 0; i < s_retired.size(); i++) {
+        EXPECT_EQ(i + 1, s_retired[i].seqNo);
+    }
+}
+
+TEST_F(PacketTimesTest, replyEvery)
+{
+    // every 4th message is a pong request, 4 blocks in the ring
+    PacketTimes times(12, 4, 1);
+    times.setConsumer(collect);
+    ASSERT_EQ(4u, times.m_windowSize);
+
+    for (uint64_t seq = 4; seq <= 20; seq += 4) {
+        times.setTxTime(seq);
+    }
+    ASSERT_EQ(1u, s_retired.size());
+    EXPECT_EQ(4u, s_retired[0].seqNo);
+    EXPECT_EQ(times.seq2slot(4), times.seq2slot(20));
+}
+
+TEST_F(PacketTimesTest, concurrentRetire)
+{
+    // receiver stores replies while the sender wraps the ring around: every stored reply
+    // must reach the consumer and no withdrawn one may
+    const uint64_t num = 200000;
+    PacketTimes times(63, 1, 1);
+    times.setConsumer(collect);
+    s_retired.reserve(num);
+
+    std::atomic<uint64_t> sent(0);
+    std::vector<char> stored(num + 1, 0);
+    std::thread receiver([&]() {
+        uint64_t seq = 1;
+        while (seq <= num) {
+            uint64_t last = sent.load(std::memory_order_acquire);
+            for (; seq <= last; seq++) {
+                stored[seq] = times.setRxTime(seq);
+            }
+        }
+    });
+    for (uint64_t seq = 1; seq <= num; seq++) {
+        times.setTxTime(seq);
+        sent.store(seq, std::memory_order_release);
+    }
+    receiver.join();
+    times.flush();
+
+    ASSERT_EQ(num, s_retired.size());
+    for (uint64_t i = 0; i < num; i++) {
+        const RetiredBlock &block = s_retired[i];
+        ASSERT_EQ(i + 1, block.seqNo);
+        EXPECT_EQ((bool)stored[block.seqNo], block.rxTime != TicksTime::TICKS0) << block.seqNo;
+    }
+}
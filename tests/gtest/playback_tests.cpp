@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Mellanox Technologies Ltd nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+
+#include "playback.h"
+
+/*
+ * Builders of small data files in every supported format
+ */
+class DataFile {
+public:
+    explicit DataFile(bool swap = false) : m_swap(swap) {}
+
+    void raw(const void *data, size_t len) {
+        m_data.insert(m_data.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+    }
+    void text(const char *str) { raw(str, strlen(str)); }
+    void u16(uint16_t v) {
+        if (m_swap) {
+            v = (uint16_t)((v >> 8) | (v << 8));
+        }
+        raw(&v, sizeof(v));
+    }
+    void u32(uint32_t v) {
+        if (m_swap) {
+            v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+        }
+        raw(&v, sizeof(v));
+    }
+    void pad4() {
+        while (m_data.size() % 4) {
+            m_data.push_back(0);
+        }
+    }
+    size_t size() const { return m_data.size(); }
+    void truncate(size_t len) { m_data.resize(len); }
+
+    // returns name of a temporary file with the data
+    std::string write() {
+        char name[] = "/tmp/sockperf_playback_XXXXXX";
+        int fd = mkstemp(name);
+        EXPECT_LE(0, fd);
+        if (fd >= 0) {
+            EXPECT_EQ((ssize_t)m_data.size(), ::write(fd, m_data.data(), m_data.size()));
+            close(fd);
+        }
+        s_files.push_back(name);
+        return name;
+    }
+
+    static std::vector<std::string> s_files;
+
+private:
+    bool m_swap;
+    std::vector<uint8_t> m_data;
+};
+
+std::vector<std::string> DataFile::s_files;
+
+// binary playback file of records { time_nsec, size, stream }
+static void binHeader(DataFile &file) {
+    PlaybackBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PLAYBACK_BIN_MAGIC, sizeof(PLAYBACK_BIN_MAGIC));
+    header.version = PLAYBACK_BIN_VERSION;
+    header.header_size = sizeof(header);
+    header.record_size = sizeof(PlaybackBinRecord);
+    file.raw(&header, sizeof(header));
+}
+
+static void binRecord(DataFile &file, uint64_t nsec, uint32_t size, uint32_t stream) {
+    PlaybackBinRecord record = { nsec, size, stream };
+    file.raw(&record, sizeof(record));
+}
+
+// IPv4 packet with UDP or TCP payload of the given size
+static std::vector<uint8_t> ipv4Packet(int proto, uint8_t dstHost, uint16_t dstPort,
+                                       uint16_t payload) {
+    uint16_t l4len = (proto == IPPROTO_UDP ? 8 : 20) + payload;
+    std::vector<uint8_t> pkt(20 + l4len, 0);
+    pkt[0] = 0x45;
+    pkt[2] = (uint8_t)((20 + l4len) >> 8);
+    pkt[3] = (uint8_t)(20 + l4len);
+    pkt[8] = 64;
+    pkt[9] = (uint8_t)proto;
+    pkt[12] = 10;
+    pkt[15] = 1;
+    pkt[16] = 10;
+    pkt[19] = dstHost;
+    pkt[22] = (uint8_t)(dstPort >> 8);
+    pkt[23] = (uint8_t)dstPort;
+    if (proto == IPPROTO_UDP) {
+        pkt[24] = (uint8_t)(l4len >> 8);
+        pkt[25] = (uint8_t)l4len;
+    } else {
+        pkt[32] = 5 << 4; // data offset
+    }
+    return pkt;
+}
+
+// IPv6 packet with UDP payload of the given size
+static std::vector<uint8_t> ipv6Packet(uint16_t dstPort, uint16_t payload) {
+    uint16_t l4len = 8 + payload;
+    std::vector<uint8_t> pkt(40 + l4len, 0);
+    pkt[0] = 0x60;
+    pkt[4] = (uint8_t)(l4len >> 8);
+    pkt[5] = (uint8_t)l4len;
+    pkt[6] = IPPROTO_UDP;
+    pkt[7] = 64;
+    pkt[39] = 1;
+    pkt[42] = (uint8_t)(dstPort >> 8);
+    pkt[43] = (uint8_t)dstPort;
+    pkt[44] = (uint8_t)(l4len >> 8);
+    pkt[45] = (uint8_t)l4len;
+    return pkt;
+}
+
+static std::vector<uint8_t> ethernet(const std::vector<uint8_t> &ip, uint16_t proto) {
+    std::vector<uint8_t> frame(14 + ip.size(), 0);
+    frame[12] = (uint8_t)(proto >> 8);
+    frame[13] = (uint8_t)proto;
+    memcpy(&frame[14], ip.data(), ip.size());
+    return frame;
+}
+
+static void pcapHeader(DataFile &file, uint32_t magic, uint32_t linkType) {
+    file.u32(magic);
+    file.u16(2);
+    file.u16(4);
+    file.u32(0);
+    file.u32(0);
+    file.u32(65535);
+    file.u32(linkType);
+}
+
+static void pcapRecord(DataFile &file, uint32_t sec, uint32_t frac,
+                       const std::vector<uint8_t> &pkt) {
+    file.u32(sec);
+    file.u32(frac);
+    file.u32((uint32_t)pkt.size());
+    file.u32((uint32_t)pkt.size());
+    file.raw(pkt.data(), pkt.size());
+}
+
+static void pcapngSection(DataFile &file) {
+    file.u32(0x0A0D0D0A);
+    file.u32(28);
+    file.u32(0x1A2B3C4D);
+    file.u16(1);
+    file.u16(0);
+    file.u32(0xffffffff); // section length is not specified
+    file.u32(0xffffffff);
+    file.u32(28);
+}
+
+static void pcapngInterface(DataFile &file, uint16_t linkType, uint8_t tsResol) {
+    file.u32(1);
+    file.u32(32);
+    file.u16(linkType);
+    file.u16(0);
+    file.u32(65535);
+    file.u16(9); // if_tsresol
+    file.u16(1);
+    uint8_t opt[4] = { tsResol, 0, 0, 0 };
+    file.raw(opt, sizeof(opt));
+    file.u32(0); // opt_endofopt
+    file.u32(32);
+}
+
+static void pcapngPacket(DataFile &file, uint32_t ifId, uint64_t ts,
+                         const std::vector<uint8_t> &pkt) {
+    uint32_t len = 32 + (uint32_t)((pkt.size() + 3) & ~3);
+    file.u32(6);
+    file.u32(len);
+    file.u32(ifId);
+    file.u32((uint32_t)(ts >> 32));
+    file.u32((uint32_t)ts);
+    file.u32((uint32_t)pkt.size());
+    file.u32((uint32_t)pkt.size());
+    file.raw(pkt.data(), pkt.size());
+    file.pad4();
+    file.u32(len);
+}
+
+struct Expected {
+    int64_t nsec; // absolute time
+    int size;
+    int stream;
+};
+
+class PlaybackTest : public testing::Test {
+protected:
+    virtual void SetUp() { TicksBase::init(TicksBase::CLOCK); }
+    virtual void TearDown() {
+        for (size_t i = 0; i < DataFile::s_files.size(); i++) {
+            unlink(DataFile::s_files[i].c_str());
+        }
+        DataFile::s_files.clear();
+    }
+
+    // reads all items through the loader thread and compares them with the expected ones
+    void check(PlaybackReader &reader, const std::vector<Expected> &expected, int64_t firstNsec) {
+        ASSERT_EQ(SOCKPERF_ERR_NONE, reader.start());
+        std::vector<PlaybackItem> items;
+        for (const PlaybackItem *item = reader.next(); item; item = reader.next()) {
+            items.push_back(*item);
+        }
+        reader.stop();
+
+        ASSERT_EQ(expected.size(), items.size());
+        int64_t prev = firstNsec;
+        for (size_t i = 0; i < items.size(); i++) {
+            ASSERT_EQ(TicksDuration(expected[i].nsec - prev), items[i].duration) << i;
+            ASSERT_EQ(expected[i].size, items[i].size) << i;
+            ASSERT_EQ(expected[i].stream, items[i].stream) << i;
+            prev = expected[i].nsec;
+        }
+    }
+};
+
+TEST_F(PlaybackTest, text)
+{
+    DataFile file;
+    file.text("# time, size, stream\n"
+              "0.5, 100\n"
+              "\n"
+              "1.25, 200, 1\n"
+              "2, 14, 0"); // no new line at the end of file
+    PlaybackReader reader;
+    ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+    EXPECT_LE(3u, reader.maxItems());
+
+    std::vector<Expected> expected = { { 500000000, 100, PLAYBACK_ANY_STREAM },
+                                       { 1250000000, 200, 1 },
+                                       { 2000000000, 14, 0 } };
+    check(reader, expected, 0);
+    EXPECT_FALSE(reader.failed());
+}
+
+TEST_F(PlaybackTest, textErrors)
+{
+    const char *broken[] = { "1, 100\n0.5, 100\n", // out of order
+                             "1, 13\n",            // too small
+                             "1, 100, -2\n",       // bad stream
+                             "1\n",                // no size
+                             "0, 100\n" };         // no time to wait
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        DataFile file;
+        file.text(broken[i]);
+        PlaybackReader reader;
+        EXPECT_EQ(SOCKPERF_ERR_INCORRECT, reader.open(file.write().c_str())) << broken[i];
+    }
+
+    DataFile empty;
+    empty.text("# nothing\n");
+    PlaybackReader reader;
+    EXPECT_EQ(SOCKPERF_ERR_INCORRECT, reader.open(empty.write().c_str()));
+
+    PlaybackReader missing;
+    EXPECT_EQ(SOCKPERF_ERR_NOT_EXIST, missing.open("/tmp/sockperf_playback_missing"));
+}
+
+// error after the first chunk stops playback after the items that were read
+TEST_F(PlaybackTest, textErrorInLaterChunk)
+{
+    DataFile file;
+    std::vector<Expected> expected;
+    char line[64];
+    for (int i = 1; i <= PLAYBACK_CHUNK_ITEMS + 10; i++) {
+        snprintf(line, sizeof(line), "%d.5, %d\n", i, 100 + i % 1000);
+        file.text(line);
+        expected.push_back({ i * (int64_t)NSEC_IN_SEC + NSEC_IN_SEC / 2, 100 + i % 1000,
+                             PLAYBACK_ANY_STREAM });
+    }
+    file.text("garbage\n");
+    file.text("99999.5, 100\n");
+
+    PlaybackReader reader;
+    ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+    check(reader, expected, 0);
+    EXPECT_TRUE(reader.failed());
+}
+
+// records are split across both chunks more than once
+TEST_F(PlaybackTest, binChunks)
+{
+    const int num = 2 * PLAYBACK_CHUNK_ITEMS + 7;
+    DataFile file;
+    binHeader(file);
+    std::vector<Expected> expected;
+    for (int i = 0; i < num; i++) {
+        int64_t nsec = 1000 * (int64_t)(i + 1);
+        int size = PLAYBACK_MIN_SIZE + i % (PLAYBACK_MAX_SIZE - PLAYBACK_MIN_SIZE);
+        uint32_t stream = i % 3 ? (uint32_t)(i % 3) : UINT32_MAX;
+        binRecord(file, (uint64_t)nsec, (uint32_t)size, stream);
+        expected.push_back({ nsec, size, i % 3 ? i % 3 : PLAYBACK_ANY_STREAM });
+    }
+
+    PlaybackReader reader;
+    ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+    EXPECT_EQ((uint64_t)num, reader.maxItems());
+    check(reader, expected, 0);
+    EXPECT_FALSE(reader.failed());
+}
+
+TEST_F(PlaybackTest, binTruncated)
+{
+    // partial record in the first chunk
+    DataFile file;
+    binHeader(file);
+    binRecord(file, 1000, 100, 0);
+    binRecord(file, 2000, 100, 0);
+    file.truncate(file.size() - 1);
+    PlaybackReader reader;
+    EXPECT_EQ(SOCKPERF_ERR_INCORRECT, reader.open(file.write().c_str()));
+
+    // partial record after the first chunk
+    DataFile later;
+    binHeader(later);
+    std::vector<Expected> expected;
+    for (int i = 1; i <= PLAYBACK_CHUNK_ITEMS + 1; i++) {
+        binRecord(later, 1000 * (uint64_t)i, 100, 0);
+        expected.push_back({ 1000 * (int64_t)i, 100, 0 });
+    }
+    binRecord(later, 1000 * (uint64_t)(PLAYBACK_CHUNK_ITEMS + 2), 100, 0);
+    later.truncate(later.size() - sizeof(PlaybackBinRecord) / 2);
+    PlaybackReader laterReader;
+    ASSERT_EQ(SOCKPERF_ERR_NONE, laterReader.open(later.write().c_str()));
+    check(laterReader, expected, 0);
+    EXPECT_TRUE(laterReader.failed());
+
+    // unsupported version
+    DataFile version;
+    binHeader(version);
+    binRecord(version, 1000, 100, 0);
+    uint32_t bad = PLAYBACK_BIN_VERSION + 1;
+    std::string name = version.write();
+    FILE *f = fopen(name.c_str(), "r+b");
+    ASSERT_TRUE(f);
+    fseek(f, offsetof(PlaybackBinHeader, version), SEEK_SET);
+    fwrite(&bad, sizeof(bad), 1, f);
+    fclose(f);
+    PlaybackReader versionReader;
+    EXPECT_EQ(SOCKPERF_ERR_INCORRECT, versionReader.open(name.c_str()));
+}
+
+TEST_F(PlaybackTest, pcap)
+{
+    for (int swap = 0; swap < 2; swap++) {
+        DataFile file(swap);
+        pcapHeader(file, 0xa1b2c3d4, 1); // usec, ethernet
+        pcapRecord(file, 10, 500000, ethernet(ipv4Packet(IPPROTO_UDP, 1, 5001, 100), 0x0800));
+        pcapRecord(file, 10, 500100, ethernet(ipv4Packet(IPPROTO_UDP, 2, 5001, 200), 0x0800));
+        std::vector<uint8_t> arp(42, 0);
+        arp[12] = 0x08;
+        arp[13] = 0x06;
+        pcapRecord(file, 10, 500200, arp); // no payload, skipped
+        pcapRecord(file, 10, 500300, ethernet(ipv4Packet(IPPROTO_TCP, 1, 5001, 1000), 0x0800));
+        pcapRecord(file, 10, 500400, ethernet(ipv4Packet(IPPROTO_UDP, 1, 5001, 5), 0x0800));
+        pcapRecord(file, 10, 500500, ethernet(ipv6Packet(5002, 300), 0x86dd));
+        // interrupted capture ends with a partial packet that is ignored
+        pcapRecord(file, 11, 0, ethernet(ipv4Packet(IPPROTO_UDP, 1, 5001, 100), 0x0800));
+        file.truncate(file.size() - 50);
+
+        PlaybackReader reader;
+        ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+        int64_t first = 10500000000;
+        std::vector<Expected> expected = { { first, 100, 0 },
+                                           { first + 100000, 200, 1 },
+                                           { first + 300000, 1000, 0 },
+                                           { first + 400000, PLAYBACK_MIN_SIZE, 0 },
+                                           { first + 500000, 300, 2 } };
+        check(reader, expected, first);
+        EXPECT_FALSE(reader.failed());
+    }
+}
+
+TEST_F(PlaybackTest, pcapNsecRaw)
+{
+    DataFile file;
+    pcapHeader(file, 0xa1b23c4d, 101); // nsec, raw IP
+    pcapRecord(file, 1, 5, ipv4Packet(IPPROTO_UDP, 1, 5001, 100));
+    pcapRecord(file, 1, 12, ipv6Packet(5001, 100));
+    pcapRecord(file, 1, 12, ipv4Packet(IPPROTO_UDP, 1, 5001, 100));
+
+    PlaybackReader reader;
+    ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+    std::vector<Expected> expected = { { 1000000005, 100, 0 },
+                                       { 1000000012, 100, 1 },
+                                       { 1000000012, 100, 0 } };
+    check(reader, expected, 1000000005);
+}
+
+TEST_F(PlaybackTest, pcapng)
+{
+    for (int swap = 0; swap < 2; swap++) {
+        DataFile file(swap);
+        pcapngSection(file);
+        pcapngInterface(file, 1, 6);   // usec, ethernet
+        pcapngInterface(file, 101, 9); // nsec, raw IP
+        pcapngPacket(file, 0, 2000000, ethernet(ipv4Packet(IPPROTO_UDP, 1, 5001, 100), 0x0800));
+        pcapngPacket(file, 1, 2000000500, ipv6Packet(5001, 200));
+        pcapngPacket(file, 5, 2000000600, ipv6Packet(5001, 200)); // no such interface
+        // packets of interfaces may be slightly out of order
+        pcapngPacket(file, 0, 2000000, ethernet(ipv4Packet(IPPROTO_TCP, 2, 80, 300), 0x0800));
+        pcapngPacket(file, 1, 2000001000, ipv4Packet(IPPROTO_UDP, 1, 5001, 50));
+        // truncated block at the end of file is ignored
+        pcapngPacket(file, 1, 2000002000, ipv4Packet(IPPROTO_UDP, 1, 5001, 100));
+        file.truncate(file.size() - 8);
+
+        PlaybackReader reader;
+        ASSERT_EQ(SOCKPERF_ERR_NONE, reader.open(file.write().c_str()));
+        int64_t first = 2000000000;
+        std::vector<Expected> expected = { { first, 100, 0 },
+                                           { first + 500, 200, 1 },
+                                           { first + 500, 300, 2 },
+                                           { first + 1000, 50, 0 } };
+        check(reader, expected, first);
+        EXPECT_FALSE(reader.failed());
+    }
+}
+
+TEST_F(PlaybackTest, pcapngBadSection)
+{
+    DataFile file;
+    pcapngSection(file);
+    pcapngInterface(file, 101, 9);
+    pcapngPacket(file, 0, 1000, ipv4Packet(IPPROTO_UDP, 1, 5001, 100));
+    size_t section = file.size();
+    pcapngSection(file);
+    file.truncate(section + 8);
+    file.u32(0x01020304); // broken byte order magic
+    file.u32(0);
+    file.u32(0);
+    file.u32(0);
+    file.u32(28);
+
+    PlaybackReader reader;
+    EXPECT_EQ(SOCKPERF_ERR_INCORRECT, reader.open(file.write().c_str()));
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# Reader of sockperf binary full log (--full-log-bin).
+#
+# Prints statistics of every server and optionally converts records to CSV
+# in the same columns as --full-log:
+#   fulllog.py [-c <file.csv>|-] <file>
+#
+import argparse
+import math
+import struct
+import sys
+
+HEADER = struct.Struct('=8sIIIIqIIII16x')
+MAGIC = b'SPFLOG'
+VERSION = 1
+RECORD = struct.Struct('=QqqII')
+READ_RECORDS = 64 * 1024
+PERCENTILES = (0.99999, 0.9999, 0.999, 0.99, 0.90, 0.75, 0.50, 0.25)
+
+# log-linear histogram with the same precision as sockperf (see src/histogram.h)
+SUB_BUCKET_BITS = 10
+
+
+def bucket_of(nsec):
+    if nsec < (1 << SUB_BUCKET_BITS):
+        return nsec
+    shift = nsec.bit_length() - SUB_BUCKET_BITS
+    return (shift << (SUB_BUCKET_BITS - 1)) + (nsec >> shift)
+
+
+def bucket_value(bucket):
+    if bucket < (1 << SUB_BUCKET_BITS):
+        return bucket
+    shift = (bucket >> (SUB_BUCKET_BITS - 1)) - 1
+    lowest = (bucket - (shift << (SUB_BUCKET_BITS - 1))) << shift
+    return lowest + ((1 << shift) >> 1)
+
+
+class ServerStats:
+    def __init__(self):
+        self.count = 0
+        self.dropped = 0
+        self.total = 0
+        self.total_sqr = 0
+        self.min = None
+        self.max = None
+        self.buckets = {}
+
+    def add(self, nsec):
+        nsec = max(nsec, 0)
+        self.count += 1
+        self.total += nsec
+        self.total_sqr += nsec * nsec
+        self.min = nsec if self.min is None else min(self.min, nsec)
+        self.max = nsec if self.max is None else max(self.max, nsec)
+        bucket = bucket_of(nsec)
+        self.buckets[bucket] = self.buckets.get(bucket, 0) + 1
+
+    def value_at_rank(self, rank):
+        if rank <= 0:
+            return self.min
+        if rank >= self.count - 1:
+            return self.max
+        seen = 0
+        for bucket in sorted(self.buckets):
+            seen += self.buckets[bucket]
+            if seen > rank:
+                return min(max(bucket_value(bucket), self.min), self.max)
+        return self.max
+
+    def report(self, server_no, name):
+        print('========= Server No: %d' % server_no)
+        print('# observations = %d; # dropped messages = %d' % (self.count, self.dropped))
+        if not self.count:
+            return
+        avg = self.total / self.count
+        std_dev = 0.0
+        if self.count > 1:
+            variance = (self.total_sqr - self.count * avg * avg) / (self.count - 1)
+            std_dev = math.sqrt(max(variance, 0))
+        print('====> avg-%s=%.3f (std-dev=%.3f)' % (name, avg / 1000, std_dev / 1000))
+        print('---> <MAX> observation = %8.3f' % (self.max / 1000))
+        for p in PERCENTILES:
+            index = int(0.5 + p * self.count) - 1
+            if index >= 0:
+                print('---> percentile %6.3f = %8.3f' %
+                      (100 * p, self.value_at_rank(index) / 1000))
+        print('---> <MIN> observation = %8.3f' % (self.min / 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='sockperf binary full log reader')
+    parser.add_argument('-c', '--csv', help='write records to the given CSV file (- for stdout)')
+    parser.add_argument('file', help='file written by --full-log-bin')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        raw = f.read(HEADER.size)
+        if len(raw) < HEADER.size:
+            sys.exit('%s: file is too short' % args.file)
+        (magic, version, header_size, record_size, reply_every, ticks_per_sec,
+         msg_size, mps, server_num, full_rtt) = HEADER.unpack(raw)
+        if magic.rstrip(b'\0') != MAGIC or version != VERSION or record_size != RECORD.size:
+            sys.exit('%s: not a sockperf binary full log' % args.file)
+        f.seek(header_size)
+
+        name = 'rtt' if full_rtt else 'latency'
+        denominator = 1 if full_rtt else 2
+        stats = [ServerStats() for _ in range(server_num)]
+        csv = None
+        if args.csv:
+            csv = sys.stdout if args.csv == '-' else open(args.csv, 'w')
+            csv.write('packet, txTime(sec), rxTime(sec), %s(usec)\n' % name)
+
+        packet = 0
+        while True:
+            raw = f.read(READ_RECORDS * RECORD.size)
+            raw = raw[:len(raw) - len(raw) % RECORD.size]
+            if not raw:
+                break
+            for seq_no, tx_time, rx_time, server_no, _ in RECORD.iter_unpack(raw):
+                if not rx_time:
+                    stats[server_no].dropped += 1
+                    continue
+                nsec = (rx_time - tx_time) * 1000000000 // ticks_per_sec // denominator
+                stats[server_no].add(nsec)
+                if csv:
+                    csv.write('%d, %.9f, %.9f, %.3f\n' %
+                              (packet, tx_time / ticks_per_sec, rx_time / ticks_per_sec,
+                               nsec / 1000))
+                packet += 1
+
+        if csv and csv is not sys.stdout:
+            csv.close()
+
+    out = sys.stderr if args.csv == '-' else sys.stdout
+    sys.stdout, saved = out, sys.stdout
+    print('reply-every=%d msg-size=%d mps=%s' % (reply_every, msg_size, mps if mps else 'max'))
+    for server_no, server in enumerate(stats):
+        server.report(server_no, name)
+    sys.stdout = saved
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+#
+# Converter of sockperf text playback file (lines of "time, size[, stream]", see
+# gen1.awk) to the binary playback format, that is read without parsing:
+#   playback.py <file.csv>|- <file.bin>
+#
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct('=8sIIII')
+MAGIC = b'SPPLAYB'
+VERSION = 1
+RECORD = struct.Struct('=QII')
+ANY_STREAM = 0xffffffff
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert sockperf playback file to binary format')
+    parser.add_argument('input', help='text playback file or - for stdin')
+    parser.add_argument('output', help='binary playback file')
+    args = parser.parse_args()
+
+    src = sys.stdin if args.input == '-' else open(args.input)
+    count = 0
+    prev_nsec = 0
+    with open(args.output, 'wb') as dst:
+        dst.write(HEADER.pack(MAGIC, VERSION, HEADER.size, RECORD.size, 0))
+        for num, line in enumerate(src, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            try:
+                fields = line.split(',')
+                nsec = int(round(float(fields[0]) * 1e9))
+                size = int(fields[1])
+                stream = int(fields[2]) if len(fields) > 2 else ANY_STREAM
+            except ValueError:
+                sys.exit("can't read time & size, at line #%d" % num)
+            if nsec < prev_nsec:
+                sys.exit('out-of-order timestamp at line #%d' % num)
+            dst.write(RECORD.pack(nsec, size, stream))
+            prev_nsec = nsec
+            count += 1
+    print('%d records were written to %s' % (count, args.output))
+
+
+if __name__ == '__main__':
+    main()